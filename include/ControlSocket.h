@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+
+// Local command interface for the headless agent: a UNIX-domain stream socket that takes
+// one text command per line and answers each with one line. Only the owning user can
+// connect (the socket is created mode 0600). Single-threaded: the daemon's loop calls
+// poll(), which also returns early on wake() so background work can be picked up.
+// POSIX only.
+class ControlSocket {
+public:
+    // Called once per complete line; answer with reply(), now or once the work is done
+    using CommandHandler = std::function<void(int client, const std::string& line)>;
+
+    ControlSocket();
+    ~ControlSocket();
+
+    ControlSocket(const ControlSocket&) = delete;
+    ControlSocket& operator=(const ControlSocket&) = delete;
+
+    // Fails if another process is already listening on the path; a stale socket file is replaced
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    // Wait up to timeoutMs (-1 = until something happens) for connections, commands or a wake
+    void poll(int timeoutMs, const CommandHandler& handler);
+
+    // Any thread, and async-signal-safe: make a pending poll() return
+    void wake();
+
+    // Send one line; false if the client has gone away
+    bool reply(int client, const std::string& line);
+
+private:
+    struct Client {
+        int id;
+        int fd;
+        std::string buffer; // Bytes received after the last newline
+    };
+
+    void acceptClients();
+    bool readClient(Client& client, const CommandHandler& handler);
+    Client* findClient(int id);
+
+    std::string path;
+    int listenFd;
+    int wakeRead;
+    int wakeWrite;
+    int nextClientId;
+    std::vector<Client> clients;
+};
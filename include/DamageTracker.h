@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <functional>
+
+// Rectangle in root-window coordinates
+struct DamageRect {
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// Tracks which parts of the X11 root window changed, using the XDamage extension
+// (only when built with HAVE_XDAMAGE; otherwise open() fails and callers keep polling).
+// A background thread collects damage on its own connection into a tile map. Capture
+// takes the damaged tiles since its last grab, and listeners are told once the damage
+// they haven't seen yet covers a given fraction of the screen.
+class DamageTracker {
+public:
+    DamageTracker();
+    ~DamageTracker();
+
+    bool open(const char* displayName = nullptr);
+    void close();
+    bool isOpen() const;
+
+    // Damage since the last call as tile-aligned rectangles, merged along rows; clears it
+    std::vector<DamageRect> takeDamage();
+
+    // Call `callback` on the tracker thread, with the damaged fraction of the screen, each time
+    // damage since its previous call covers at least `threshold` (0 = any change).
+    // Returns an id for removeListener().
+    int addListener(double threshold, std::function<void(double)> callback);
+    void removeListener(int id);
+
+    static const int kTileSize = 64;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
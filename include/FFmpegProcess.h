@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#include "Frame.h"
+
+// An ffmpeg child process that reads raw frames from a pipe on its stdin
+// (POSIX only). Used for recording when the binary is built without libav*:
+// captured BGRA frames are converted to I420 and written straight to the
+// encoder, and the only file written is ffmpeg's own output.
+class FFmpegProcess {
+public:
+    FFmpegProcess();
+    ~FFmpegProcess();
+
+    // Spawn `ffmpeg` from PATH reading width x height yuv420p frames (-f rawvideo) from stdin
+    // at a constant frameRate. outputArgs are appended after the input,
+    // e.g. {"-c:v", "libx264", "out.mkv"}.
+    bool start(int width, int height, int frameRate, const std::vector<std::string>& outputArgs);
+
+    // Write the frame captured at timestampMs, blocking while the pipe is full. Raw video has
+    // no timestamps, so the frame goes into its slot on the constant-rate timeline: the previous
+    // frame is repeated to fill a gap before it, and it is dropped if its slot is already filled.
+    // Fails once ffmpeg has gone away.
+    bool writeFrame(const Frame& frame, int64_t timestampMs);
+
+    // Longest gap filled with repeats (default 2 s, the recorder's keepalive). A longer gap, such
+    // as a locked screen or the idle frame rate, is cut to this length, so the output timeline is
+    // compressed there and plays faster than wall time; later frames keep their spacing.
+    void setMaxGap(std::chrono::milliseconds gap);
+
+    // Close stdin so ffmpeg drains and finalizes its output. If it hasn't exited within
+    // timeout, send SIGINT (ffmpeg still writes the trailer), then SIGKILL after another
+    // timeout. Returns ffmpeg's exit code, or -1 if it was killed by a signal or never started.
+    int stop(std::chrono::milliseconds timeout = std::chrono::seconds(5));
+
+    // False once the child has exited (it is reaped here)
+    bool isRunning();
+
+    uint64_t getBytesWritten() const;
+
+    // Frames written so far, repeats included
+    uint64_t getFramesWritten() const;
+
+    // Slots cut from the timeline because a gap was longer than the max gap
+    uint64_t getSlotsCollapsed() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
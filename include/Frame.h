@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+
+// Pixel layouts produced by the capture backends
+enum class PixelFormat {
+    BGRA, // 4 bytes per pixel, alpha ignored (X11 ZPixmap / GDI 32bpp)
+    BGR,  // 3 bytes per pixel (GDI 24bpp)
+    RGB   // 3 bytes per pixel
+};
+
+// Non-owning view of a captured frame, rows stored top-down
+struct Frame {
+    const uint8_t* data = nullptr;
+    int width = 0;
+    int height = 0;
+    int stride = 0; // bytes per row
+    PixelFormat format = PixelFormat::BGRA;
+};
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+#include "Frame.h"
+
+class QueueCounters;
+
+class FrameBufferPool;
+
+// One preallocated buffer owned by a FrameBufferPool
+struct PooledBuffer {
+    uint8_t* data = nullptr;
+    size_t capacity = 0;
+    std::atomic<int> refCount{0};
+    FrameBufferPool* owner = nullptr;
+    Frame frame; // View of the pixels currently held, filled in by the producer
+};
+
+// Reference-counted handle to a pooled buffer. Copies share the buffer;
+// it goes back to the pool when the last handle is destroyed or reset.
+class PooledFrame {
+public:
+    PooledFrame() = default;
+    PooledFrame(const PooledFrame& other);
+    PooledFrame(PooledFrame&& other) noexcept;
+    PooledFrame& operator=(const PooledFrame& other);
+    PooledFrame& operator=(PooledFrame&& other) noexcept;
+    ~PooledFrame();
+
+    explicit operator bool() const { return buffer != nullptr; }
+
+    uint8_t* data() const { return buffer->data; }
+    size_t capacity() const { return buffer->capacity; }
+
+    Frame& frame() { return buffer->frame; }
+    const Frame& frame() const { return buffer->frame; }
+
+    void reset();
+
+private:
+    friend class FrameBufferPool;
+    explicit PooledFrame(PooledBuffer* buffer) : buffer(buffer) {}
+
+    PooledBuffer* buffer = nullptr;
+};
+
+// Fixed set of cache-line aligned frame buffers recycled between the capture
+// and encode stages. The pool never grows: when every buffer is in flight,
+// acquire() waits and then gives up, so a slow consumer throttles the producer
+// instead of driving up memory use.
+class FrameBufferPool {
+public:
+    FrameBufferPool();
+    ~FrameBufferPool();
+
+    // (Re)allocate bufferCount buffers of bufferSize bytes. Fails while any buffer is in use.
+    bool allocate(size_t bufferCount, size_t bufferSize);
+    void release();
+
+    // Take a free buffer, waiting up to timeout. Returns an empty handle if none became free.
+    PooledFrame acquire(std::chrono::milliseconds timeout);
+
+    size_t getBufferCount() const;
+    size_t getBufferSize() const;
+    size_t getFreeCount() const;
+
+    // Number of acquire() calls that timed out because the pool was exhausted
+    uint64_t getExhaustedCount() const;
+
+private:
+    friend class PooledFrame;
+    void recycle(PooledBuffer* buffer);
+
+    mutable std::mutex mutex;
+    std::condition_variable bufferFreed;
+    std::vector<std::unique_ptr<PooledBuffer>> buffers;
+    std::vector<PooledBuffer*> freeList;
+    size_t bufferSize;
+    std::atomic<uint64_t> exhaustedCount;
+};
+
+// Bounded FIFO of pooled frames handed from one thread to another.
+// Storage is reserved up front, so pushing and popping never allocate.
+// Depth, drops and wait time go to counters when given.
+class FrameQueue {
+public:
+    struct Entry {
+        PooledFrame buffer;
+        int64_t timestampMs = 0;
+        std::chrono::steady_clock::time_point queuedAt; // Set by push()
+    };
+
+    explicit FrameQueue(size_t capacity, QueueCounters* counters = nullptr);
+
+    // Returns false if the queue is full or closed
+    bool push(Entry entry);
+
+    // Blocks until an entry is available; returns false once closed and drained
+    bool pop(Entry& entry);
+
+    // Wake the consumer and refuse further pushes
+    void close();
+
+    size_t size() const;
+
+private:
+    mutable std::mutex mutex;
+    std::condition_variable entryAdded;
+    std::vector<Entry> ring;
+    size_t head;
+    size_t count;
+    bool closed;
+    QueueCounters* counters;
+};
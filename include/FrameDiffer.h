@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+#include "Frame.h"
+
+// Which fixed-size tiles changed between two consecutive frames
+struct DirtyTileMap {
+    int tileSize = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    int dirtyCount = 0;
+    std::vector<uint8_t> dirty; // tilesX * tilesY entries, 1 = changed
+
+    bool isDirty(int tileX, int tileY) const { return dirty[tileY * tilesX + tileX] != 0; }
+};
+
+// Detects changed screen regions by hashing fixed-size tiles and comparing
+// the hashes against the previous frame.
+class FrameDiffer {
+public:
+    explicit FrameDiffer(int tileSize = 64);
+
+    // Hash the frame and return the number of tiles that changed.
+    // The first frame (or a resolution change) marks every tile dirty.
+    int update(const Frame& frame);
+
+    const DirtyTileMap& getDirtyTiles() const;
+
+    // Forget the previous frame
+    void reset();
+
+private:
+    int tileSize;
+    int frameWidth;
+    int frameHeight;
+    bool hasPrevious;
+    std::vector<uint64_t> tileHashes;
+    DirtyTileMap dirtyMap;
+
+    static uint64_t hashTile(const uint8_t* data, int stride, int rowBytes, int rows);
+};
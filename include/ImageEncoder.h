@@ -0,0 +1,74 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Frame.h"
+
+enum class ImageFormat {
+    BMP,
+    PNG,
+    QOI, // Fast lossless screen-content format, see QoiCodec
+    JPEG // Lossy, only available when built WITH_JPEG
+};
+
+// 8-bit 4:2:0 layouts fed to video encoders
+enum class YuvLayout {
+    I420, // Y plane, then U, then V
+    NV12  // Y plane, then interleaved UV
+};
+
+struct PngOptions {
+    int compressionLevel = 6; // zlib level 0-9
+    int threads = 0;          // Row bands deflated in parallel; 0 = one per hardware thread
+};
+
+// Platform-independent image output shared by every capture backend.
+// Pixel swizzling and YUV conversion use SSSE3/AVX2 kernels selected at runtime, with a scalar fallback;
+// files are assembled in memory and written with a single write.
+class ImageEncoder {
+public:
+    // Convert a run of pixels between layouts (dst must not overlap src).
+    // Supported: any format to itself, BGRA->BGR, BGRA->RGB, BGR<->RGB.
+    static bool convertPixels(const uint8_t* src, PixelFormat srcFormat,
+                              uint8_t* dst, PixelFormat dstFormat, size_t pixelCount);
+
+    // Box-filter a frame down by an integer factor (1-16), e.g. 4 or 8 for thumbnails.
+    // The result keeps the source pixel format; `scaled` points into `pixels`.
+    static bool downscale(const Frame& frame, int factor, std::vector<uint8_t>& pixels, Frame& scaled);
+    static const int kMaxDownscaleFactor = 16;
+
+    // Convert a BGRA frame to limited-range BT.601 YUV 4:2:0 (libswscale's default for BGRA->yuv420p).
+    // Chroma planes are (width+1)/2 x (height+1)/2; for NV12 the interleaved UV plane goes to u and v is unused.
+    static bool convertToYuv420(const Frame& frame, YuvLayout layout, uint8_t* y, int yStride,
+                                uint8_t* u, int uStride, uint8_t* v, int vStride);
+    // Same, packed into one contiguous buffer as raw video streams expect
+    static bool convertToYuv420(const Frame& frame, YuvLayout layout, std::vector<uint8_t>& output);
+
+    // Encode a frame into an in-memory file
+    static bool encodeBmp(const Frame& frame, std::vector<uint8_t>& output);
+    static bool encodePng(const Frame& frame, std::vector<uint8_t>& output,
+                          const PngOptions& options = PngOptions());
+    static bool encodeJpeg(const Frame& frame, std::vector<uint8_t>& output, int quality = 85);
+
+    // Encode in any supported format
+    static bool encode(const Frame& frame, ImageFormat format, std::vector<uint8_t>& output,
+                       const PngOptions& pngOptions = PngOptions(), int jpegQuality = 85);
+
+    // Encode and write to disk in one call
+    static bool saveImage(const std::string& filePath, const Frame& frame, ImageFormat format,
+                          const PngOptions& pngOptions = PngOptions(), int jpegQuality = 85);
+
+    // Whether lossy JPEG output was compiled in
+    static bool isJpegAvailable();
+
+    static bool writeFile(const std::string& filePath, const std::vector<uint8_t>& data);
+
+    static const char* extensionFor(ImageFormat format);
+
+    // Name of the SIMD path picked at runtime ("avx2", "ssse3" or "scalar").
+    // Setting REMOTE_WORKER_SIMD to "scalar" or "ssse3" caps it (used by the tests).
+    static const char* simdLevel();
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <type_traits>
+#include <chrono>
+#include <cstddef>
+
+class QueueCounters;
+
+// Runs blocking work (screen grabs, uploads, database calls) on a few worker threads so
+// the UI thread never waits on it. Each job returns a future; a completion callback, if
+// given, is queued when the job finishes and runs on whichever thread calls
+// runCompletions() - the UI thread, at the start of every frame (queuing one requests a
+// redraw through UiNotifier). Callbacks may therefore touch UI state without locking.
+// Jobs themselves should not capture UI objects.
+class JobQueue {
+public:
+    // Depth and queue wait go to counters when given
+    explicit JobQueue(size_t threadCount = 2, QueueCounters* counters = nullptr);
+    ~JobQueue();
+
+    JobQueue(const JobQueue&) = delete;
+    JobQueue& operator=(const JobQueue&) = delete;
+
+    // Process-wide instance used by the screens
+    static JobQueue& shared();
+
+    template <typename Job>
+    std::shared_future<typename std::invoke_result<Job>::type> submit(Job job) {
+        using Result = typename std::invoke_result<Job>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+        std::shared_future<Result> future = task->get_future().share();
+        enqueue([task]() { (*task)(); });
+        return future;
+    }
+
+    // onComplete takes the job's result (nothing for void jobs)
+    template <typename Job, typename Callback>
+    std::shared_future<typename std::invoke_result<Job>::type> submit(Job job, Callback onComplete) {
+        using Result = typename std::invoke_result<Job>::type;
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::move(job));
+        std::shared_future<Result> future = task->get_future().share();
+        enqueue([this, task, future, onComplete]() {
+            (*task)();
+            postCompletion([future, onComplete]() {
+                if constexpr (std::is_void<Result>::value) {
+                    future.get();
+                    onComplete();
+                } else {
+                    onComplete(future.get());
+                }
+            });
+        });
+        return future;
+    }
+
+    // Run the callbacks of jobs that finished since the last call; returns how many ran
+    size_t runCompletions();
+
+    // Jobs queued or running
+    size_t getPendingCount() const;
+
+private:
+    void enqueue(std::function<void()> job);
+    void postCompletion(std::function<void()> callback);
+    void workerLoop();
+
+    struct QueuedJob {
+        std::function<void()> function;
+        std::chrono::steady_clock::time_point queuedAt;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable jobAvailable;
+    std::deque<QueuedJob> jobs;
+    size_t running;
+    bool stopping;
+    std::vector<std::thread> workers;
+    QueueCounters* counters;
+
+    std::mutex completionMutex;
+    std::vector<std::function<void()>> completions;
+};
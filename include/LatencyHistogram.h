@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+struct LatencySummary {
+    uint64_t count = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p90Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+};
+
+// Log-linear (HDR-style) histogram of durations in nanoseconds. Each power of two is
+// split into 32 linear buckets, so percentiles are within ~3% of the recorded values;
+// anything above ~18 minutes lands in the last bucket. Recording is a relaxed atomic
+// bucket increment plus a running sum and max: lock-free and cheap from any thread.
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    void recordSince(std::chrono::steady_clock::time_point start) {
+        record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count()));
+    }
+
+    // Snapshot of count, mean and percentiles. Readers don't block writers, so a
+    // summary taken while samples arrive may be off by the samples in flight.
+    LatencySummary summary() const;
+
+    void reset();
+
+    static const int kSubBucketBits = 5;
+    static const int kMaxValueBits = 40;
+    static const int kBucketCount = (kMaxValueBits - kSubBucketBits + 1) << kSubBucketBits;
+
+private:
+    std::atomic<uint64_t> buckets[kBucketCount];
+    std::atomic<uint64_t> totalNs;
+    std::atomic<uint64_t> maxNs;
+};
+
+// Stages of the screenshot and recording pipelines that are timed in production
+enum class PipelineStage {
+    Grab,      // Screen grab (all monitors)
+    Stitch,    // Copying monitors into one canvas
+    Diff,      // Tile change detection while recording
+    Hash,      // Perceptual hash for duplicate screenshots
+    Thumbnail, // Downscale + encode of all thumbnails
+    Encode,    // Screenshot image encoding (including pixel conversion)
+    Write,     // Writing a screenshot file
+    Convert,   // BGRA -> YUV for the video encoder
+    VideoEncode, // Conversion + encode of one video frame
+    Upload,    // Uploading a screenshot and its thumbnails
+    Database,  // One database call (connect, query or insert)
+    Count
+};
+
+// Process-wide histograms, one per pipeline stage
+class PipelineLatency {
+public:
+    static LatencyHistogram& stage(PipelineStage stage);
+    static const char* stageName(PipelineStage stage);
+
+    // Write one line per stage (count, mean, p50/p90/p99, max in ms) to a text file
+    static bool dumpToFile(const std::string& filePath);
+
+    static void resetAll();
+};
+
+// Records the lifetime of the object into a histogram
+class ScopedLatency {
+public:
+    explicit ScopedLatency(PipelineStage stage)
+        : histogram(PipelineLatency::stage(stage)), start(std::chrono::steady_clock::now()) {}
+    ~ScopedLatency() { histogram.recordSince(start); }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+private:
+    LatencyHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
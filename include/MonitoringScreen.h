@@ -1,13 +1,13 @@
 #pragma once
 
 #include <string>
-#include <thread>
-#include <atomic>
-#include "AppState.h"  // Include to get MonitoringState definition
+#include <vector>
+#include <memory>
 
-// Forward declaration to avoid circular dependencies
-class ScreenCapture;
+class MonitoringSession;
 
+// Dashboard for a MonitoringSession: controls, status and telemetry. All monitoring
+// work lives in the session, so the headless daemon shares it.
 class MonitoringScreen {
 public:
     MonitoringScreen();
@@ -15,6 +15,10 @@ public:
 
     void render();
 
+    // Take the session's pending status events into the dashboard state without drawing;
+    // render() does this itself, the app calls it while the window is minimized
+    void applyStatusEvents();
+
     void setUserId(const std::string& userId);
 
     // Public methods to control monitoring externally (for system tray)
@@ -22,23 +26,19 @@ public:
     void triggerStopMonitoring();
 
 private:
-    std::string userId;
-    std::string statusMessage;
-    MonitoringState currentState;
-    bool isRecording;
+    std::unique_ptr<MonitoringSession> session;
 
-    // For the random screenshot timer
-    std::thread screenshotTimerThread;
-    std::atomic<bool> timerRunning;
-
-    // For screen recording functionality
-    ScreenCapture* screenCapture;
+    // Status shown on the dashboard; owned by the UI thread. Background work reports
+    // through the session's status channel, drained once per frame or wakeup.
+    std::string statusMessage;
+    bool statusIsError;
+    std::string progressText;
+    float progress; // Negative while nothing is in progress
 
-    void startMonitoring();
-    void stopMonitoring();
-    void pauseMonitoring();
-    void resumeMonitoring();
+    // Throughput charts; buffers are reused across frames
+    bool chartShowDay;
+    std::vector<float> chartAverage;
+    std::vector<float> chartPeak;
 
-    void startRandomScreenshotTimer();
-    void stopRandomScreenshotTimer();
-};
\ No newline at end of file
+    void setStatus(const std::string& message, bool isError = false);
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <future>
+#include <memory>
+#include <mutex>
+
+#include "AppState.h"
+#include "Scheduler.h"
+#include "StatusChannel.h"
+#include "ScreenCapture.h"
+
+class TelemetrySampler;
+
+// The monitoring pipeline without any UI: the random periodic screenshot, manual
+// screenshots, recording with segment upload, and telemetry. MonitoringScreen draws it;
+// the headless daemon drives it from socket commands. All methods belong to one control
+// thread, which must also call JobQueue::shared().runCompletions() and drain
+// getStatusChannel(), where every result of background work is reported.
+class MonitoringSession {
+public:
+    MonitoringSession();
+    ~MonitoringSession();
+
+    MonitoringSession(const MonitoringSession&) = delete;
+    MonitoringSession& operator=(const MonitoringSession&) = delete;
+
+    void setUserId(const std::string& userId);
+    const std::string& getUserId() const;
+
+    // Each returns false when the state doesn't allow it (e.g. pause while stopped)
+    bool start();
+    bool stop();
+    bool pause();
+    bool resume();
+    MonitoringState getState() const;
+
+    // Grab, upload and log a full-quality screenshot on a worker; false if one is under way
+    bool takeScreenshot();
+    bool isScreenshotPending() const;
+
+    bool startRecording();
+    // Drains the encoder on a worker; the outcome arrives as a status event
+    bool stopRecording();
+    bool isRecording() const;
+    bool isRecordingStopPending() const;
+    EncoderStats getRecordingStats() const;
+
+    ScreenshotStats getPeriodicScreenshotStats() const;
+
+    TelemetrySampler& getTelemetry();
+    // Shared, so jobs that may outlive the session can report through it
+    const std::shared_ptr<StatusChannel>& getStatusChannel() const;
+
+private:
+    void startRandomScreenshotTimer();
+    void stopRandomScreenshotTimer();
+
+    // The captures open their X connections on first use rather than at construction
+    void ensureStillCapture();
+    void ensureRecordingCapture();
+
+    std::string userId;
+    MonitoringState currentState;
+
+    // Shared with jobs that may outlive the session
+    std::shared_ptr<StatusChannel> statusChannel;
+
+    // Random screenshot task on the shared scheduler (0 = none)
+    Scheduler::TaskId screenshotTask;
+
+    // Recording capture; the stop job keeps it alive while it drains the encoder
+    std::shared_ptr<ScreenCapture> screenCapture;
+
+    // Periodic and manual screenshots share one capture, kept across ticks so a periodic screenshot
+    // of an unchanged screen is recognized; manual ones are always written and uploaded. A job
+    // holds the mutex from the grab until it has read the results.
+    struct StillCapture {
+        std::mutex mutex;
+        ScreenCapture capture;
+    };
+    std::shared_ptr<StillCapture> stillCapture;
+
+    // The last periodic screenshot job, submitted from the scheduler thread
+    struct PeriodicJob {
+        std::mutex mutex;
+        std::shared_future<void> running;
+    };
+    std::shared_ptr<PeriodicJob> periodicJob;
+
+    // Updated by JobQueue completions, which hold their own reference so one that runs after
+    // the session is gone is harmless
+    struct JobState {
+        bool recording = false;
+        bool screenshotPending = false;
+        bool recordingStopPending = false;
+    };
+    std::shared_ptr<JobState> jobs;
+    std::shared_future<bool> recordingStop;
+
+    std::unique_ptr<TelemetrySampler> telemetry;
+};
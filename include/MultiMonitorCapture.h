@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include "Frame.h"
+#include "DamageTracker.h"
+
+// One monitor in root-window coordinates
+struct MonitorInfo {
+    std::string name;
+    int x = 0;
+    int y = 0;
+    int width = 0;
+    int height = 0;
+    bool primary = false;
+};
+
+// Captures every monitor of an X11 display in parallel. Monitors are enumerated
+// with XRandR (when built with HAVE_XRANDR; otherwise the root window counts as one
+// monitor). Each monitor gets its own X connection, MIT-SHM buffer and worker thread,
+// so a multi-head grab costs roughly one monitor's latency instead of the sum.
+class MultiMonitorCapture {
+public:
+    MultiMonitorCapture();
+    ~MultiMonitorCapture();
+
+    bool open(const char* displayName = nullptr);
+    void close();
+    bool isOpen() const;
+
+    // Re-enumerate monitors if outputs were plugged, unplugged or resized since the last call.
+    // Returns true when the layout changed.
+    bool refreshIfChanged();
+
+    std::vector<MonitorInfo> getMonitors() const;
+
+    // Size of the root window, which contains every monitor
+    int getWidth() const;
+    int getHeight() const;
+
+    // Grab all monitors at once. frames[i] belongs to getMonitors()[i] and stays valid until the next grab.
+    bool grabAll(std::vector<Frame>& frames);
+
+    // Like grabAll, but only re-read the rows of each monitor that intersect `damage`
+    // (root coordinates, e.g. from DamageTracker::takeDamage); the rest of each frame keeps
+    // the previous grab. Monitors without damage aren't touched, and a monitor that has
+    // never been grabbed is grabbed in full.
+    bool grabDamaged(const std::vector<DamageRect>& damage, std::vector<Frame>& frames);
+
+    // Copy per-monitor frames into one BGRA canvas at their root positions.
+    // Parts outside the canvas are clipped; areas no monitor covers are black.
+    void stitch(const std::vector<Frame>& frames, uint8_t* canvas, int canvasWidth, int canvasHeight, int canvasStride) const;
+
+    bool isUsingSharedMemory() const;
+
+    // Wall time of the last grabAll and running average, in milliseconds
+    double getLastGrabLatencyMs() const;
+    double getAverageGrabLatencyMs() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
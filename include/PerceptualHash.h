@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Frame.h"
+
+// Difference hash (dHash) of a frame's luma: the frame is reduced to a 9x8 grid of
+// block averages and each bit records whether a cell is brighter than its right-hand
+// neighbour. Small edits (a clock, a cursor, a blinking caret) flip few bits, so the
+// Hamming distance between two hashes measures how different two screens look.
+class PerceptualHash {
+public:
+    static uint64_t dHash(const Frame& frame);
+
+    // Number of differing bits (0 = visually identical, 64 = unrelated)
+    static int distance(uint64_t a, uint64_t b);
+};
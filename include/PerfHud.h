@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <map>
+#include <cstdint>
+
+#include "Scheduler.h"
+
+struct ImDrawData;
+
+// Diagnostics window for slowdowns on users' machines, toggled with F12: frame and swap
+// times, ImGui geometry, CPU per agent thread, heap usage, and depth and wait time of
+// the background queues. Queue and pipeline figures come from the always-on lock-free
+// counters (QueueMetrics, PipelineLatency). Everything else is collected only while the
+// window is open: frames are timed by the caller, and threads and heap are sampled once
+// a second on the shared Scheduler, so a hidden HUD costs nothing.
+class PerfHud {
+public:
+    PerfHud();
+    ~PerfHud();
+
+    void toggle();
+    bool isVisible() const;
+
+    // UI thread, after each swap while visible
+    void recordFrame(double cpuMs, double swapMs, const ImDrawData* drawData);
+
+    // UI thread, inside the ImGui frame
+    void render();
+
+private:
+    struct ThreadUsage {
+        int id;
+        std::string name;
+        double cpuPercent;
+    };
+
+    // One background sample; immutable once published
+    struct ProcessSample {
+        std::vector<ThreadUsage> threads;
+        bool heapKnown = false;
+        uint64_t heapBytes = 0;   // Obtained from the system (arenas + mmap)
+        uint64_t heapInUse = 0;
+        uint64_t heapFree = 0;
+        uint64_t mappedBytes = 0; // Large blocks served by mmap
+    };
+
+    void sampleProcess();
+
+    bool visible;
+    Scheduler::TaskId firstSampleTask;
+    Scheduler::TaskId samplerTask;
+    std::shared_ptr<const ProcessSample> sample; // Only accessed with std::atomic_load/store
+
+    // Sampler thread only: per-thread CPU ticks at the previous sample
+    std::map<int, uint64_t> lastThreadTicks;
+    int64_t lastSampleNs;
+
+    // UI thread only: recent frames for the plots, oldest first from frameIndex
+    static const int kFrameHistory = 120;
+    float frameMs[kFrameHistory];
+    float swapMs[kFrameHistory];
+    int frameIndex;
+    int framesRecorded;
+    int vertexCount;
+    int indexCount;
+    int drawListCount;
+};
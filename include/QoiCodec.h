@@ -0,0 +1,19 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "Frame.h"
+
+// Lossless "Quite OK Image" codec. Screen content (flat UI colours, text) is
+// mostly runs and small colour deltas, which QOI encodes in a single pass at
+// close to memory bandwidth, far faster than deflate and far smaller than BMP.
+class QoiCodec {
+public:
+    // Encode as a 3-channel QOI file (alpha is dropped)
+    static bool encode(const Frame& frame, std::vector<uint8_t>& output);
+
+    // Decode a QOI file into tightly packed RGB pixels
+    static bool decode(const uint8_t* data, size_t size, std::vector<uint8_t>& rgbPixels, int& width, int& height);
+};
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "LatencyHistogram.h"
+
+// Depth and wait time of one background queue. Producers and consumers update relaxed
+// atomics only, so the counters are always on and cost a few nanoseconds per item;
+// the performance HUD reads them whenever it is open.
+class QueueCounters {
+public:
+    QueueCounters();
+
+    void pushed();
+    // queuedAt is when the item was pushed; the gap until now is its wait
+    void popped(std::chrono::steady_clock::time_point queuedAt);
+    // Refused because the queue was full
+    void dropped();
+
+    int64_t getDepth() const;
+    int64_t getPeakDepth() const;
+    uint64_t getDroppedCount() const;
+    const LatencyHistogram& getWait() const;
+
+    void reset();
+
+private:
+    std::atomic<int64_t> depth;
+    std::atomic<int64_t> peakDepth;
+    std::atomic<uint64_t> droppedCount;
+    LatencyHistogram wait;
+};
+
+// Background queues that are instrumented in production
+enum class BackgroundQueue {
+    Frames,   // Grabbed frames waiting for the video encoder
+    Segments, // Finished recording segments waiting for upload
+    Jobs,     // JobQueue::shared(): screenshots, uploads, database calls
+    Count
+};
+
+// Process-wide counters, one per queue
+class QueueMetrics {
+public:
+    static QueueCounters& queue(BackgroundQueue queue);
+    static const char* queueName(BackgroundQueue queue);
+};
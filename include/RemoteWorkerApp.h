@@ -13,6 +13,7 @@ enum class AppState {
 // Forward declarations for screen classes
 class LoginScreen;
 class MonitoringScreen;
+class PerfHud;
 
 // Forward declaration for tray library (if using C library)
 #ifdef USE_TRAY_LIBRARY
@@ -36,6 +37,7 @@ private:
 
     std::unique_ptr<LoginScreen> loginScreen;
     std::unique_ptr<MonitoringScreen> monitoringScreen;
+    std::unique_ptr<PerfHud> perfHud;
 
 #ifdef USE_TRAY_LIBRARY
     // System tray functionality
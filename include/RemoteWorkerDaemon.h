@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+#include "ControlSocket.h"
+
+class MonitoringSession;
+
+// Headless counterpart of RemoteWorkerApp for terminal servers and kiosks: the same
+// monitoring pipeline with no window, GL context or ImGui, driven by text commands on a
+// local UNIX socket (send "help" for the list). The session is only created once a user
+// has logged in, so an idle daemon is little more than the listening socket.
+class RemoteWorkerDaemon {
+public:
+    struct Options {
+        std::string socketPath;
+        std::string userId;           // Log in at startup when set
+        bool startMonitoring = false; // Start monitoring right after that login
+    };
+
+    explicit RemoteWorkerDaemon(const Options& options);
+    ~RemoteWorkerDaemon();
+
+    // Blocks until "quit", SIGINT or SIGTERM; returns the process exit code
+    int run();
+
+private:
+    void handleCommand(int client, const std::string& line);
+    void login(int client, const std::string& userId);
+    void applyStatusEvents();
+    std::string describeStatus() const;
+
+    Options options;
+    ControlSocket control;
+    std::unique_ptr<MonitoringSession> session; // Null until login succeeds
+    bool loginPending;
+    bool quitRequested;
+
+    // Latest final status from the session, reported by "status"
+    std::string lastStatus;
+    bool lastStatusIsError;
+};
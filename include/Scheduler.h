@@ -0,0 +1,83 @@
+#pragma once
+
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <map>
+#include <set>
+#include <random>
+#include <cstdint>
+
+// Runs delayed and recurring tasks on one background thread. The thread sleeps on a
+// condition variable until the earliest task is due, so cancelling, pausing or shutting
+// down wakes it right away instead of waiting out a long interval.
+// Tasks run one at a time; anything slow (uploads, DB writes) delays the tasks behind it.
+class Scheduler {
+public:
+    using TaskId = uint64_t; // 0 is never a valid id
+
+    Scheduler();
+    ~Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Process-wide instance for monitoring tasks
+    static Scheduler& shared();
+
+    // Run once after delay
+    TaskId scheduleOnce(std::chrono::milliseconds delay, std::function<void()> task);
+
+    // Run every interval, first after one interval. A run that overshoots its slot
+    // delays the next one rather than causing a burst.
+    TaskId schedulePeriodic(std::chrono::milliseconds interval, std::function<void()> task);
+
+    // Run repeatedly, each time after a fresh random delay in [minInterval, maxInterval]
+    TaskId scheduleJittered(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval,
+                            std::function<void()> task);
+
+    // Drop a task. Never blocks: a run already in progress finishes on the scheduler thread.
+    // With waitIfRunning, wait for that run too (unless called from the task itself).
+    bool cancel(TaskId id, bool waitIfRunning = false);
+
+    // Suspend a task, keeping the time left until its next run; resume() restarts the countdown
+    bool pause(TaskId id);
+    bool resume(TaskId id);
+
+    // True while the task exists (scheduled or paused)
+    bool isScheduled(TaskId id) const;
+    bool isPaused(TaskId id) const;
+
+    // Cancel everything and stop the thread, waiting only for a run in progress
+    void shutdown();
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Task {
+        std::function<void()> function;
+        std::chrono::milliseconds minInterval{0};
+        std::chrono::milliseconds maxInterval{0};
+        bool repeat = false;
+        bool paused = false;
+        Clock::time_point due;
+        Clock::duration remaining{0}; // Time left when paused
+    };
+
+    TaskId add(Task task, std::chrono::milliseconds firstDelay);
+    std::chrono::milliseconds nextInterval(const Task& task);
+    void run();
+
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable runFinished;
+    std::map<TaskId, Task> tasks;
+    std::set<std::pair<Clock::time_point, TaskId>> queue; // Due times of the tasks that aren't paused
+    TaskId nextId;
+    TaskId runningId;
+    bool stopping;
+    std::mt19937 random;
+    std::thread thread;
+};
@@ -5,21 +5,72 @@
 #include <thread>
 #include <atomic>
 #include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#include "Frame.h"
+#include "VideoEncoder.h"
+#include "FrameDiffer.h"
+#include "ImageEncoder.h"
+#include "FrameBufferPool.h"
 
 #ifdef _WIN32
 #include <windows.h>
-// Forward declaration for CLSID
-struct _GUID;
-typedef _GUID CLSID;
 #endif
 
+#ifdef __linux__
+class MultiMonitorCapture;
+class DamageTracker;
+#endif
+
+class UserActivity;
+
+// Screenshot quality tiers. Lossless uses the configured screenshot format;
+// High and Low are lossy JPEG (falling back to lossless without JPEG support).
+enum class ScreenshotQuality {
+    Lossless,
+    High,
+    Low
+};
+
+// How screenshots of a multi-monitor desktop are written
+enum class MonitorOutputMode {
+    Stitched,  // One image covering every monitor
+    PerMonitor // One image per monitor (Linux/XRandR only)
+};
+
+// Frame-rate tiers for adaptive recording. The full rate is the recording frame rate.
+// Through an ffmpeg child (no libav*), gaps longer than 2 s are cut to 2 s of repeats, so idle
+// and locked stretches take less time in the video than they did on the clock.
+struct AdaptiveFrameRateSettings {
+    int activeInputWindowMs = 3000; // Input this recent means someone is working: full rate
+    double changeThreshold = 0.02;  // Dirty-tile fraction that also counts as activity (video, scrolling)
+    double quietFrameRate = 2.0;    // No recent input and a mostly static screen
+    int idleAfterSeconds = 60;      // No input for this long counts as idle
+    double idleFrameRate = 0.2;     // One frame every five seconds; nothing at all while locked
+};
+
+struct ScreenshotStats {
+    uint64_t count = 0;
+    uint64_t totalBytes = 0;
+    double totalEncodeMs = 0.0;
+    size_t lastBytes = 0;
+    double lastEncodeMs = 0.0;
+    double lastThumbnailMs = 0.0; // Downscale + encode of all thumbnails for the last screenshot
+    uint64_t duplicatesSkipped = 0; // Screenshots not written because they matched a recent one
+    uint64_t bytesSaved = 0;        // Encoded size of the matched screenshots that were not written again
+};
+
 class ScreenCapture {
 public:
     ScreenCapture();
     ~ScreenCapture();
 
-    // Take a single screenshot
-    std::string captureScreen();
+    // Take a single screenshot. With skipDuplicates false it is written even when duplicate
+    // detection is on, and kept out of the history later screenshots are matched against.
+    std::string captureScreen(ScreenshotQuality quality = ScreenshotQuality::Lossless, bool skipDuplicates = true);
 
     // Start/stop screen recording
     bool startRecording(const std::string& outputFilePath);
@@ -28,23 +79,144 @@ public:
     // Set callback for when a screenshot is taken
     void setScreenshotCallback(std::function<void(const std::string&)> callback);
 
+    // File format for screenshots (PNG by default; QOI is much faster for screen content)
+    void setScreenshotFormat(ImageFormat format);
+
+    // JPEG quality (1-100) used for a lossy tier
+    void setQualityTier(ScreenshotQuality tier, int jpegQuality);
+
+    // Stitched (default) or one file per monitor
+    void setMonitorOutputMode(MonitorOutputMode mode);
+
+    // Every screenshot file written by the last captureScreen (one per monitor in PerMonitor mode)
+    std::vector<std::string> getLastScreenshotPaths() const;
+
+    // Also write a thumbnail per factor (e.g. {4, 8} for 1/4 and 1/8 size) with every screenshot.
+    // Thumbnails are written before the full image; empty (the default) disables them.
+    void setThumbnailFactors(const std::vector<int>& factors);
+
+    // Thumbnail files written with the most recent screenshot, smallest first
+    std::vector<std::string> getLastThumbnailPaths() const;
+
+    // Skip screenshots that look the same as one of the last `historySize` ones: their
+    // perceptual hashes differ in at most `maxDistance` of 64 bits (0 = pixel-level match).
+    // A skipped screenshot makes captureScreen return "" with getLastDuplicateOf() set.
+    void setDuplicateDetection(bool enabled, int maxDistance = 5, size_t historySize = 8);
+
+    // Path of the earlier screenshot the last capture duplicated, or "" if it was written
+    std::string getLastDuplicateOf() const;
+
+    // Encode time and size of the screenshots taken by this object
+    ScreenshotStats getScreenshotStats() const;
+
+    // PNG compression level (0-9) and number of worker threads (0 = one per core) for screenshots
+    void setPngOptions(int compressionLevel, int threads);
+
+    // Latency of the most recent screen grab in milliseconds (0 if unavailable)
+    double getLastGrabLatencyMs() const;
+
+    // Recording settings for the in-process encoder (take effect on the next startRecording)
+    void setRecordingCodec(VideoCodec codec);
+    void setRecordingFrameRate(int framesPerSecond);
+
+    // Adapt the recording rate to user input, on-screen change and screen lock (off by default).
+    // Timestamps are variable-rate, so playback timing stays correct.
+    void setAdaptiveFrameRate(bool enabled, const AdaptiveFrameRateSettings& settings = AdaptiveFrameRateSettings());
+
+    // Split recordings into self-contained files of about this many seconds
+    // (<output>_000.mkv, <output>_001.mkv, ...); 0 (the default) writes a single file.
+    void setRecordingSegmentDuration(int seconds);
+
+    // Called with each finished segment while recording continues, and with the last one after stop.
+    // Runs on a dedicated thread, so it may block (e.g. to upload the file).
+    void setSegmentCallback(std::function<void(const std::string&)> callback);
+
+    // Per-frame encode time and CPU cost of the current/last recording
+    EncoderStats getRecordingStats() const;
+
+    // Drop recording frames whose tiles are all unchanged since the previous frame (default on)
+    void setSkipUnchangedFrames(bool enabled);
+
+    // Called from the recording thread for every grabbed frame with its dirty-tile map.
+    // Set before startRecording; the frame is only valid during the call.
+    void setFrameCallback(std::function<void(const Frame&, const DirtyTileMap&)> callback);
+
+    // Grab recording frames when the screen reports damage instead of on every tick: once a
+    // frame is due, wait until changes since the last grab cover `threshold` of the screen
+    // (0 = any change), or the 2 s keepalive. Only damaged rows are re-read.
+    // Linux with XDamage only; elsewhere recording keeps polling at the frame rate.
+    void setChangeDrivenCapture(bool enabled, double threshold = 0.0);
+
+    // Call `callback` (on a background thread, with the changed fraction of the screen) whenever
+    // changes since its previous call cover `threshold` of the screen, e.g. to take a screenshot.
+    // Returns an id for removeScreenChangeListener, or -1 if change events aren't available.
+    int addScreenChangeListener(double threshold, std::function<void(double)> callback);
+    void removeScreenChangeListener(int id);
+
 private:
     std::atomic<bool> isRecording;
     std::thread recordingThread;
+
+    // Wakes the capture loop out of a long frame interval when recording stops
+    std::mutex recordingWakeMutex;
+    std::condition_variable recordingWake;
     std::function<void(const std::string&)> screenshotCallback;
 
     // Screen dimensions (to be captured during initialization)
     int screenWidth;
     int screenHeight;
 
-    // For external FFmpeg recording
+    // Recording output path (first segment name is derived from it in segmented mode)
     std::string outputFile;
-    std::string tempFrameDir;
-    int frameCounter;
-    std::vector<std::string> capturedFrameFiles;
 
-    // GDI+ variables
-    ULONG_PTR gdiplusToken;
+    // Screenshot encoding settings
+    ImageFormat screenshotFormat;
+    PngOptions pngOptions;
+    int highJpegQuality;
+    int lowJpegQuality;
+    ScreenshotStats screenshotStats;
+    std::vector<int> thumbnailFactors;
+    std::vector<std::string> lastThumbnailPaths;
+    std::vector<std::string> lastScreenshotPaths;
+    MonitorOutputMode monitorOutputMode;
+
+    // Perceptual hashes of recent screenshots for duplicate detection
+    struct ScreenshotFingerprint {
+        uint64_t hash;
+        int width;
+        int height;
+        size_t bytes;
+        std::string path;
+    };
+    bool duplicateDetection;
+    int duplicateMaxDistance;
+    size_t duplicateHistorySize;
+    std::deque<ScreenshotFingerprint> recentScreenshots;
+    std::string lastDuplicateOf;
+
+    // In-process encoder settings and statistics
+    VideoCodec recordingCodec;
+    int recordingFrameRate;
+    int recordingSegmentSeconds;
+    std::atomic<bool> adaptiveFrameRate;
+    AdaptiveFrameRateSettings adaptiveSettings;
+    std::function<void(const std::string&)> segmentCallback;
+    EncoderStats recordingStats;
+    mutable std::mutex statsMutex;
+
+    // Serializes use of the platform grabber between screenshots and recording
+    std::mutex captureMutex;
+
+    // Serializes screenshots, which encode from a shared copy after releasing captureMutex
+    std::mutex screenshotMutex;
+
+    // Preallocated buffers cycled through grab -> diff -> encode
+    FrameBufferPool framePool;
+
+    // Tile-hash change detection for the recording path
+    FrameDiffer frameDiffer;
+    std::atomic<bool> skipUnchangedFrames;
+    std::function<void(const Frame&, const DirtyTileMap&)> frameCallback;
 
 #ifdef _WIN32
     // Process information for managing FFmpeg subprocess on Windows
@@ -52,25 +224,50 @@ private:
     bool ffmpegProcessRunning;
 #endif
 
+#ifdef __linux__
+    // One persistent X11 connection, MIT-SHM segment and worker per monitor
+    std::unique_ptr<MultiMonitorCapture> monitorCapture;
+    std::vector<Frame> monitorFrames;
+    std::vector<uint8_t> stitchBuffer; // Screenshot copy of all monitors, guarded by screenshotMutex
+
+    // XDamage events; opened on first use. Until a full grab has been taken after
+    // opening, the monitor images may predate the tracked damage.
+    std::unique_ptr<DamageTracker> damageTracker;
+    bool damageBaseline;
+    bool changeDrivenCapture;
+    double changeDrivenThreshold;
+    int recordingListenerId;
+    bool damageSignalled; // Guarded by recordingWakeMutex
+
+    bool ensureDamageTracker();
+#endif
+
     // Platform-specific implementation
-    std::string captureScreenWindows();
-    std::string captureScreenLinux();
-    std::string captureScreenMac();
+    std::string captureScreenWindows(ScreenshotQuality quality, bool skipDuplicates);
+    std::string captureScreenLinux(ScreenshotQuality quality, bool skipDuplicates);
+    std::string captureScreenMac(ScreenshotQuality quality);
+
+    // Encode a grabbed frame to a timestamped screenshot file and notify the callback
+    std::string saveScreenshot(const Frame& frame, ScreenshotQuality quality, bool skipDuplicates,
+                               const std::string& nameSuffix = "");
+    std::vector<std::string> saveThumbnails(const Frame& frame, const std::string& basePath,
+                                            ImageFormat format, int jpegQuality, double& elapsedMs);
 
-    // Recording functions using external FFmpeg
+    // Size the frame pool for the current screen; no-op if it already fits
+    bool ensureFramePool();
+
+    // Grab the full screen (BGRA) into a pooled buffer and fill in its frame view
+    bool grabFrame(PooledFrame& buffer);
+
+    // Recording functions
     void recordingLoop();
+    void captureAndEncode();
+    void encodeQueuedFrames(FrameQueue& queue, std::atomic<bool>& encoderFailed);
+    void pipeQueuedFrames(FrameQueue& queue, std::atomic<bool>& encoderFailed);
+    std::vector<std::string> externalEncoderArgs() const;
+    double chooseFrameRate(UserActivity& activity, double dirtyFraction, bool& locked) const;
     void startFFmpegScreenCapture();
-    void encodeVideoWithExternalFFmpeg();
-    void createTempFrameDirectory();
-    void cleanupTempFiles();
 
     // Windows-specific functions
-    bool captureFrameWindows(const std::string& filePath);
-    bool captureFrameLinux(const std::string& filePath);
-    bool captureFrameMac(const std::string& filePath);
-
-#ifdef _WIN32
-    // Helper function for getting encoder CLSID
-    friend int GetEncoderClsid(const WCHAR* format, CLSID* pClsid);
-#endif
+    bool grabFrameWindows(Frame& frame, uint8_t* pixels, size_t capacity);
 };
\ No newline at end of file
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+enum class StatusKind {
+    Info,
+    Error,
+    Progress // Work in progress; `progress` is 0..1, or negative when unknown
+};
+
+struct StatusEvent {
+    StatusKind kind = StatusKind::Info;
+    std::string text;
+    float progress = -1.0f;
+};
+
+// Bounded lock-free queue carrying status events from any number of worker threads to
+// the UI thread (Vyukov's bounded MPMC ring). post() never blocks: when the ring is full
+// it drops and counts the oldest event, so the latest status - a final error or result -
+// is never the one lost. Each post requests a redraw; the UI thread drains the ring with
+// poll() once per frame.
+class StatusChannel {
+public:
+    // Capacity is rounded up to a power of two
+    explicit StatusChannel(size_t capacity = 64);
+
+    StatusChannel(const StatusChannel&) = delete;
+    StatusChannel& operator=(const StatusChannel&) = delete;
+
+    // Any thread. Always queues the event; returns true.
+    bool post(StatusEvent event);
+    bool post(StatusKind kind, const std::string& text, float progress = -1.0f);
+
+    // Consumer thread. Returns false when empty.
+    bool poll(StatusEvent& event);
+
+    // Older events given up to make room for newer ones
+    uint64_t getDroppedCount() const;
+
+private:
+    // One attempt each; post() also takes the oldest event to make room
+    bool tryPush(StatusEvent& event);
+    bool tryTake(StatusEvent& event);
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        StatusEvent event;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    size_t mask;
+
+    // Producers and the consumer each own a cache line (producers also dequeue when full)
+    alignas(64) std::atomic<size_t> enqueuePosition;
+    alignas(64) std::atomic<size_t> dequeuePosition;
+    alignas(64) std::atomic<uint64_t> dropped;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <memory>
+#include <chrono>
+#include <cstdint>
+
+#include "NetworkMonitor.h"
+#include "Scheduler.h"
+#include "TimeSeries.h"
+
+class UserActivity;
+
+// One immutable set of readings; never modified after it is published
+struct TelemetrySnapshot {
+    uint64_t sequence = 0; // 0 until the first sample has been taken
+    std::chrono::steady_clock::time_point sampledAt;
+
+    NetworkUsage network = {0, 0}; // Totals since boot, loopback excluded
+    double sendBytesPerSecond = 0.0;
+    double receiveBytesPerSecond = 0.0;
+
+    int64_t idleMs = 0;
+    bool screenLocked = false;
+
+    double processCpuPercent = 0.0; // Of one core, averaged over the last interval
+    uint64_t residentBytes = 0;     // 0 where unsupported
+};
+
+// Metrics kept as history for the dashboard charts
+enum class TelemetryMetric {
+    SendRate,    // Bytes per second
+    ReceiveRate, // Bytes per second
+    ProcessCpu,  // Percent of one core
+    Count
+};
+
+// Polls network counters, input idle time, lock state and our own CPU/memory use as a
+// periodic task on the shared Scheduler, so the /proc reads and X queries stay off the
+// UI thread. Each sample is published as a new snapshot through an atomic shared_ptr
+// swap; readers just take the latest pointer and never wait for a sample in progress.
+class TelemetrySampler {
+public:
+    TelemetrySampler();
+    ~TelemetrySampler();
+
+    // Sample now, then every interval. Calling it again changes the rate.
+    void start(std::chrono::milliseconds interval = std::chrono::seconds(1));
+    void stop();
+
+    // Latest snapshot (sequence 0 before the first sample); never null
+    std::shared_ptr<const TelemetrySnapshot> latest() const;
+
+    // Every sample is also appended here, at 1 s and 1 min resolution
+    const TimeSeries& history(TelemetryMetric metric) const;
+
+    static const char* metricName(TelemetryMetric metric);
+
+private:
+    void sample();
+
+    std::unique_ptr<UserActivity> activity;
+    std::unique_ptr<NetworkMonitor> network;
+    std::shared_ptr<const TelemetrySnapshot> snapshot; // Only accessed with std::atomic_load/store
+    TimeSeries series[static_cast<int>(TelemetryMetric::Count)];
+
+    Scheduler::TaskId firstSampleTask;
+    Scheduler::TaskId periodicTask;
+
+    // Previous sample, for rates (sampler thread only)
+    double lastCpuSeconds;
+};
@@ -0,0 +1,6 @@
+#pragma once
+
+// Names the calling thread so per-thread CPU (the performance HUD, top -H, debuggers)
+// can tell the agent's threads apart. Linux keeps the first 15 characters; elsewhere
+// this does nothing.
+void setCurrentThreadName(const char* name);
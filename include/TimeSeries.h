@@ -0,0 +1,58 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+enum class SeriesResolution {
+    Second, // 1 s buckets covering the last 10 minutes
+    Minute  // 1 min buckets covering the last 24 hours
+};
+
+enum class SeriesAggregate {
+    Min,
+    Max,
+    Average
+};
+
+// In-memory history of one metric, kept at two resolutions in fixed-size rings of
+// (min, max, sum, count) buckets. A sample lands in the current bucket of each ring in O(1);
+// a bucket is recycled when its slot comes round again, so memory stays constant however
+// long the session runs. Gaps (no samples, e.g. while suspended) read back as empty buckets.
+// Thread-safe: one sampler thread appends while the UI reads.
+class TimeSeries {
+public:
+    TimeSeries();
+
+    void add(double value, std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now());
+
+    // The ring's whole window, oldest bucket first, ending at the bucket containing `now`.
+    // Empty buckets read as 0. Returns the number of non-empty buckets.
+    size_t read(SeriesResolution resolution, SeriesAggregate aggregate, std::vector<float>& values,
+                std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now()) const;
+
+    static size_t capacity(SeriesResolution resolution);
+
+private:
+    struct Bucket {
+        int64_t slot = -1; // Absolute bucket number since the epoch; -1 never written
+        float min = 0.0f;
+        float max = 0.0f;
+        double sum = 0.0;
+        uint32_t count = 0;
+    };
+
+    struct Ring {
+        std::chrono::seconds bucketDuration;
+        std::vector<Bucket> buckets;
+    };
+
+    static int64_t slotOf(const Ring& ring, std::chrono::steady_clock::time_point time);
+    const Ring& ring(SeriesResolution resolution) const;
+
+    mutable std::mutex mutex;
+    Ring seconds;
+    Ring minutes;
+};
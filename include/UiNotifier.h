@@ -0,0 +1,17 @@
+#pragma once
+
+// Lets background threads ask the UI thread for a redraw without depending on GLFW.
+// RemoteWorkerApp installs a handler that wakes its event wait; until then requests
+// are only recorded. Repeated requests before the UI thread picks them up coalesce
+// into one wakeup.
+class UiNotifier {
+public:
+    // handler may be null; it must be safe to call from any thread
+    static void setHandler(void (*handler)());
+
+    // Any thread
+    static void requestRedraw();
+
+    // UI thread: true if a redraw was requested since the last call
+    static bool takeRequest();
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <chrono>
+#include <cstdint>
 
 class UserActivity {
 public:
@@ -12,6 +13,12 @@ public:
     
     // Get idle time in seconds
     int getIdleTimeSeconds();
+
+    // Milliseconds since the last keyboard/mouse input
+    int64_t getIdleTimeMs();
+
+    // True while the session is locked or the screen saver is running
+    bool isScreenLocked();
     
     // Reset idle timer (call when user has activity)
     void resetIdleTimer();
@@ -19,6 +26,11 @@ public:
 private:
     std::chrono::steady_clock::time_point lastActivityTime;
 
+#ifdef __linux__
+    // Opened on first use for XScreenSaver idle/lock queries
+    struct _XDisplay* display;
+#endif
+
 #ifdef _WIN32
     bool isUserIdleWindows(int idleThresholdSeconds);
     int getIdleTimeSecondsWindows();
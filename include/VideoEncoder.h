@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <memory>
+#include <functional>
+#include <cstdint>
+
+#include "Frame.h"
+
+enum class VideoCodec {
+    H264,
+    VP9,
+    AV1
+};
+
+struct EncoderStats {
+    uint64_t framesEncoded = 0;
+    uint64_t bytesWritten = 0;
+    double totalEncodeMs = 0.0; // Wall time spent in conversion + encode
+    double totalCpuMs = 0.0;    // Process CPU time spent in conversion + encode
+    double lastEncodeMs = 0.0;
+    uint64_t framesSkipped = 0; // Unchanged frames dropped by the capture loop before encoding
+    uint64_t framesDropped = 0; // Grabs dropped because every pooled buffer was still waiting to be encoded
+    double currentFrameRate = 0.0; // Capture rate picked by the adaptive policy (0 while the screen is locked)
+
+    double averageEncodeMs() const { return framesEncoded ? totalEncodeMs / framesEncoded : 0.0; }
+    double averageCpuMs() const { return framesEncoded ? totalCpuMs / framesEncoded : 0.0; }
+};
+
+// In-process libavcodec/libavformat encoder fed with frames from our own capture path.
+// Only functional when built with WITH_FFMPEG.
+class VideoEncoder {
+public:
+    VideoEncoder();
+    ~VideoEncoder();
+
+    // Open the output file; the container is picked from the extension
+    bool open(const std::string& outputPath, int width, int height, int frameRate, VideoCodec codec);
+
+    // Encode one frame; timestamps are in milliseconds since the start of the recording
+    bool encodeFrame(const Frame& frame, int64_t timestampMs);
+
+    // Continue in a new file: the next frame is forced to a keyframe and starts nextPath.
+    // The current file is finalized once every earlier frame has been written to it,
+    // so each file plays on its own.
+    bool startNewSegment(const std::string& nextPath);
+
+    // Called with the path of every finished file (each segment, and the last one on close)
+    void setSegmentCallback(std::function<void(const std::string&)> callback);
+
+    // Flush delayed frames and finalize the file
+    bool close();
+
+    bool isOpen() const;
+
+    EncoderStats getStats() const;
+
+    static const char* codecName(VideoCodec codec);
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
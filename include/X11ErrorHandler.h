@@ -0,0 +1,28 @@
+#pragma once
+
+#ifdef __linux__
+
+#include <cstdint>
+
+typedef struct _XDisplay Display;
+
+// Process-wide Xlib error handling. Xlib's default handler exits the process on any
+// protocol error - e.g. a BadMatch when a grab races a monitor being unplugged - so
+// install() replaces it, once, with one that logs the error and counts it against the
+// display it came from. Code that needs to know whether its requests failed compares
+// getErrorCount() on its own connection before and after a round trip; the failing
+// call itself just reports failure.
+class X11ErrorHandler {
+public:
+    // Call at the start of main(), before any other Xlib call, since it also enables
+    // Xlib's thread support. Later calls do nothing.
+    static void install();
+
+    // Errors seen on this connection so far
+    static uint64_t getErrorCount(Display* display);
+
+    // Call before XCloseDisplay so a later connection at the same address starts at zero
+    static void forget(Display* display);
+};
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <memory>
+#include <cstdint>
+
+#include "Frame.h"
+
+// Grabs the X11 root window (or a rectangle of it) into a persistent buffer.
+// Uses MIT-SHM (XShmGetImage) when the server supports it, so repeated grabs
+// reuse the same shared-memory segment instead of copying through the X socket.
+// Falls back to plain XGetImage otherwise (e.g. remote displays).
+class X11ScreenGrabber {
+public:
+    X11ScreenGrabber();
+    ~X11ScreenGrabber();
+
+    // Connect to the display (nullptr = $DISPLAY) and set up the capture buffer
+    bool open(const char* displayName = nullptr);
+
+    // Same, but capture only the given rectangle of the root window (e.g. one monitor)
+    bool open(const char* displayName, int x, int y, int width, int height);
+    void close();
+    bool isOpen() const;
+
+    // Force the plain XGetImage path (for comparison against MIT-SHM)
+    void setUseSharedMemory(bool enabled);
+    bool isUsingSharedMemory() const;
+
+    // Grab the root window or region. The returned frame stays valid until the next grab.
+    bool grab(Frame& frame);
+
+    // Refresh only rows [firstRow, firstRow + rowCount) of the buffer (e.g. damaged ones);
+    // the other rows keep what the previous grab put there. Returns the full frame.
+    bool grabRows(int firstRow, int rowCount, Frame& frame);
+
+    int getWidth() const;
+    int getHeight() const;
+
+    // Latency of the last grab and running average, in milliseconds
+    double getLastGrabLatencyMs() const;
+    double getAverageGrabLatencyMs() const;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> pImpl;
+};
@@ -0,0 +1,221 @@
+#include "ControlSocket.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+namespace {
+// A client sending longer lines than this is not one of our tools
+const size_t kMaxLineLength = 4096;
+
+bool setNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0 && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0;
+}
+}
+
+ControlSocket::ControlSocket() : listenFd(-1), wakeRead(-1), wakeWrite(-1), nextClientId(1) {}
+
+ControlSocket::~ControlSocket() {
+    close();
+}
+
+bool ControlSocket::open(const std::string& socketPath) {
+    close();
+
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Control socket path is empty or too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        std::cerr << "Failed to create control socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // Only replace the file if nobody answers on it
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0) {
+        std::cerr << "Another agent is already listening on " << socketPath << std::endl;
+        ::close(fd);
+        return false;
+    }
+    unlink(socketPath.c_str());
+
+    // Created owner-only from the start, so there is no window where others could connect
+    mode_t previousMask = umask(077);
+    int bound = bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    umask(previousMask);
+    if (bound != 0 || listen(fd, 4) != 0 || !setNonBlocking(fd)) {
+        std::cerr << "Failed to listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        return false;
+    }
+
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0 || !setNonBlocking(pipeFds[0]) || !setNonBlocking(pipeFds[1])) {
+        std::cerr << "Failed to create control socket wake pipe: " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        unlink(socketPath.c_str());
+        return false;
+    }
+
+    path = socketPath;
+    listenFd = fd;
+    wakeRead = pipeFds[0];
+    wakeWrite = pipeFds[1];
+    return true;
+}
+
+void ControlSocket::close() {
+    for (Client& client : clients) {
+        ::close(client.fd);
+    }
+    clients.clear();
+
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        listenFd = -1;
+        unlink(path.c_str());
+    }
+    if (wakeRead >= 0) {
+        ::close(wakeRead);
+        ::close(wakeWrite);
+        wakeRead = wakeWrite = -1;
+    }
+}
+
+bool ControlSocket::isOpen() const {
+    return listenFd >= 0;
+}
+
+void ControlSocket::wake() {
+    // A full pipe already means a wakeup is pending
+    if (wakeWrite >= 0) {
+        char byte = 1;
+        ssize_t written = write(wakeWrite, &byte, 1);
+        (void)written;
+    }
+}
+
+void ControlSocket::poll(int timeoutMs, const CommandHandler& handler) {
+    if (!isOpen()) {
+        return;
+    }
+
+    std::vector<pollfd> fds;
+    fds.push_back({wakeRead, POLLIN, 0});
+    fds.push_back({listenFd, POLLIN, 0});
+    for (const Client& client : clients) {
+        fds.push_back({client.fd, POLLIN, 0});
+    }
+
+    if (::poll(fds.data(), fds.size(), timeoutMs) <= 0) {
+        return;
+    }
+
+    if (fds[0].revents & POLLIN) {
+        char drain[64];
+        while (read(wakeRead, drain, sizeof(drain)) > 0) {
+        }
+    }
+
+    // Handlers only send, so the client list is stable until the hung-up clients are dropped
+    std::vector<int> closed;
+    for (size_t i = 2; i < fds.size(); i++) {
+        Client& client = clients[i - 2];
+        if ((fds[i].revents & (POLLIN | POLLHUP | POLLERR)) && !readClient(client, handler)) {
+            ::close(client.fd);
+            closed.push_back(client.id);
+        }
+    }
+    clients.erase(std::remove_if(clients.begin(), clients.end(), [&closed](const Client& client) {
+        return std::find(closed.begin(), closed.end(), client.id) != closed.end();
+    }), clients.end());
+
+    if (fds[1].revents & POLLIN) {
+        acceptClients();
+    }
+}
+
+void ControlSocket::acceptClients() {
+    while (true) {
+        int fd = accept(listenFd, nullptr, nullptr);
+        if (fd < 0) {
+            return;
+        }
+        if (!setNonBlocking(fd)) {
+            ::close(fd);
+            continue;
+        }
+        clients.push_back({nextClientId++, fd, std::string()});
+    }
+}
+
+// False once the client has hung up or misbehaved
+bool ControlSocket::readClient(Client& client, const CommandHandler& handler) {
+    char data[1024];
+    while (true) {
+        ssize_t received = recv(client.fd, data, sizeof(data), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        }
+        client.buffer.append(data, static_cast<size_t>(received));
+
+        size_t newline;
+        while ((newline = client.buffer.find('\n')) != std::string::npos) {
+            std::string line = client.buffer.substr(0, newline);
+            client.buffer.erase(0, newline + 1);
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            handler(client.id, line);
+        }
+        if (client.buffer.size() > kMaxLineLength) {
+            return false;
+        }
+    }
+}
+
+ControlSocket::Client* ControlSocket::findClient(int id) {
+    auto it = std::find_if(clients.begin(), clients.end(), [id](const Client& client) { return client.id == id; });
+    return it == clients.end() ? nullptr : &*it;
+}
+
+bool ControlSocket::reply(int client, const std::string& line) {
+    Client* target = findClient(client);
+    if (!target) {
+        return false;
+    }
+
+    // Replies are short; a client that can't take one line is dropped at its next read
+    std::string message = line + "\n";
+    size_t sent = 0;
+    while (sent < message.size()) {
+        ssize_t result = send(target->fd, message.data() + sent, message.size() - sent, 0);
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            shutdown(target->fd, SHUT_RDWR);
+            return false;
+        }
+        sent += static_cast<size_t>(result);
+    }
+    return true;
+}
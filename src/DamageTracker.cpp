@@ -0,0 +1,326 @@
+#include "DamageTracker.h"
+
+#ifdef __linux__
+
+#include "ThreadName.h"
+#include "X11ErrorHandler.h"
+
+#ifdef HAVE_XDAMAGE
+#include <X11/Xlib.h>
+#include <X11/extensions/Xfixes.h>
+#include <X11/extensions/Xdamage.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <iostream>
+#include <cstdint>
+
+namespace {
+// Damaged tiles of one consumer, with a count so coverage checks don't rescan the map
+struct TileMap {
+    std::vector<uint8_t> tiles;
+    size_t damagedCount = 0;
+
+    void resize(size_t count) {
+        tiles.assign(count, 0);
+        damagedCount = 0;
+    }
+
+    void clear() {
+        std::fill(tiles.begin(), tiles.end(), 0);
+        damagedCount = 0;
+    }
+
+    void mark(size_t index) {
+        if (!tiles[index]) {
+            tiles[index] = 1;
+            damagedCount++;
+        }
+    }
+};
+
+struct Listener {
+    int id;
+    double threshold;
+    std::function<void(double)> callback;
+    TileMap seen;
+};
+}
+
+class DamageTracker::Impl {
+public:
+#ifdef HAVE_XDAMAGE
+    Display* display = nullptr;
+    Window root = 0;
+    Damage damage = 0;
+    XserverRegion parts = 0;
+    int damageEventBase = 0;
+    int wakePipe[2] = {-1, -1};
+#endif
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+
+    std::mutex mutex;
+    int width = 0;
+    int height = 0;
+    int tilesX = 0;
+    int tilesY = 0;
+    TileMap pending;
+    std::vector<Listener> listeners;
+    int nextListenerId = 0;
+
+    // Call with mutex held
+    void resize(int newWidth, int newHeight) {
+        width = newWidth;
+        height = newHeight;
+        tilesX = (width + kTileSize - 1) / kTileSize;
+        tilesY = (height + kTileSize - 1) / kTileSize;
+        size_t count = static_cast<size_t>(tilesX) * tilesY;
+        pending.resize(count);
+        for (auto& listener : listeners) {
+            listener.seen.resize(count);
+        }
+        // Everything counts as changed after a resize
+        markRect(0, 0, width, height);
+    }
+
+    // Call with mutex held
+    void markRect(int x, int y, int w, int h) {
+        int x0 = std::max(0, x) / kTileSize;
+        int y0 = std::max(0, y) / kTileSize;
+        int x1 = std::min(width, x + w);
+        int y1 = std::min(height, y + h);
+        if (x1 <= 0 || y1 <= 0) {
+            return;
+        }
+        x1 = (x1 - 1) / kTileSize;
+        y1 = (y1 - 1) / kTileSize;
+        for (int ty = y0; ty <= y1; ty++) {
+            for (int tx = x0; tx <= x1; tx++) {
+                size_t index = static_cast<size_t>(ty) * tilesX + tx;
+                pending.mark(index);
+                for (auto& listener : listeners) {
+                    listener.seen.mark(index);
+                }
+            }
+        }
+    }
+
+    // Listeners whose threshold was crossed, with their fraction; resets what they have seen
+    std::vector<std::pair<std::function<void(double)>, double>> collectNotifications() {
+        std::vector<std::pair<std::function<void(double)>, double>> due;
+        std::lock_guard<std::mutex> lock(mutex);
+        size_t total = pending.tiles.size();
+        for (auto& listener : listeners) {
+            if (listener.seen.damagedCount == 0 || total == 0) {
+                continue;
+            }
+            double fraction = static_cast<double>(listener.seen.damagedCount) / total;
+            if (fraction >= listener.threshold) {
+                due.emplace_back(listener.callback, fraction);
+                listener.seen.clear();
+            }
+        }
+        return due;
+    }
+
+#ifdef HAVE_XDAMAGE
+    void handleEvent(XEvent& event) {
+        if (event.type == damageEventBase + XDamageNotify) {
+            // Move the accumulated damage into `parts`; with NonEmpty reporting the next
+            // event only comes after this, so a busy screen can't flood us with rectangles
+            XDamageSubtract(display, damage, None, parts);
+            int count = 0;
+            XRectangle* rects = XFixesFetchRegion(display, parts, &count);
+            std::lock_guard<std::mutex> lock(mutex);
+            for (int i = 0; i < count; i++) {
+                markRect(rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+            }
+            if (rects) {
+                XFree(rects);
+            }
+        } else if (event.type == ConfigureNotify && event.xconfigure.window == root) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (event.xconfigure.width != width || event.xconfigure.height != height) {
+                resize(event.xconfigure.width, event.xconfigure.height);
+            }
+        }
+    }
+
+    void run() {
+        setCurrentThreadName("rw-damage");
+        while (!stopping) {
+            // Xlib may have buffered events already; only block when its queue is empty
+            if (!XPending(display)) {
+                pollfd fds[2] = {{ConnectionNumber(display), POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+                if (poll(fds, 2, -1) < 0 || (fds[1].revents & POLLIN)) {
+                    continue;
+                }
+            }
+
+            while (XPending(display)) {
+                XEvent event;
+                XNextEvent(display, &event);
+                handleEvent(event);
+            }
+
+            for (auto& notification : collectNotifications()) {
+                notification.first(notification.second);
+            }
+        }
+    }
+#endif
+};
+
+DamageTracker::DamageTracker() : pImpl(std::make_unique<Impl>()) {}
+
+DamageTracker::~DamageTracker() {
+    close();
+}
+
+bool DamageTracker::open(const char* displayName) {
+#ifdef HAVE_XDAMAGE
+    if (pImpl->display) {
+        return true;
+    }
+
+    X11ErrorHandler::install();
+    pImpl->display = XOpenDisplay(displayName);
+    if (!pImpl->display) {
+        std::cerr << "Failed to open X display for damage tracking" << std::endl;
+        return false;
+    }
+
+    // XFixes must be version-negotiated before its regions can be used
+    int errorBase = 0;
+    int fixesEventBase = 0;
+    int major = 0;
+    int minor = 0;
+    if (!XDamageQueryExtension(pImpl->display, &pImpl->damageEventBase, &errorBase) ||
+        !XDamageQueryVersion(pImpl->display, &major, &minor) ||
+        !XFixesQueryExtension(pImpl->display, &fixesEventBase, &errorBase) ||
+        !XFixesQueryVersion(pImpl->display, &major, &minor)) {
+        std::cerr << "XDamage not available, capture will poll" << std::endl;
+        X11ErrorHandler::forget(pImpl->display);
+        XCloseDisplay(pImpl->display);
+        pImpl->display = nullptr;
+        return false;
+    }
+
+    if (pipe(pImpl->wakePipe) != 0) {
+        X11ErrorHandler::forget(pImpl->display);
+        XCloseDisplay(pImpl->display);
+        pImpl->display = nullptr;
+        return false;
+    }
+
+    pImpl->root = DefaultRootWindow(pImpl->display);
+    XWindowAttributes attributes;
+    XGetWindowAttributes(pImpl->display, pImpl->root, &attributes);
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        pImpl->resize(attributes.width, attributes.height);
+    }
+
+    XSelectInput(pImpl->display, pImpl->root, StructureNotifyMask);
+    pImpl->damage = XDamageCreate(pImpl->display, pImpl->root, XDamageReportNonEmpty);
+    pImpl->parts = XFixesCreateRegion(pImpl->display, nullptr, 0);
+    XFlush(pImpl->display);
+
+    pImpl->stopping = false;
+    pImpl->thread = std::thread(&Impl::run, pImpl.get());
+    return true;
+#else
+    (void)displayName;
+    return false;
+#endif
+}
+
+void DamageTracker::close() {
+#ifdef HAVE_XDAMAGE
+    if (!pImpl->display) {
+        return;
+    }
+
+    pImpl->stopping = true;
+    char wake = 0;
+    if (write(pImpl->wakePipe[1], &wake, 1) < 0) {
+        std::cerr << "Failed to wake damage tracker" << std::endl;
+    }
+    if (pImpl->thread.joinable()) {
+        pImpl->thread.join();
+    }
+
+    XFixesDestroyRegion(pImpl->display, pImpl->parts);
+    XDamageDestroy(pImpl->display, pImpl->damage);
+    X11ErrorHandler::forget(pImpl->display);
+    XCloseDisplay(pImpl->display);
+    pImpl->display = nullptr;
+    ::close(pImpl->wakePipe[0]);
+    ::close(pImpl->wakePipe[1]);
+    pImpl->wakePipe[0] = pImpl->wakePipe[1] = -1;
+#endif
+}
+
+bool DamageTracker::isOpen() const {
+#ifdef HAVE_XDAMAGE
+    return pImpl->display != nullptr;
+#else
+    return false;
+#endif
+}
+
+std::vector<DamageRect> DamageTracker::takeDamage() {
+    std::vector<DamageRect> rects;
+    std::lock_guard<std::mutex> lock(pImpl->mutex);
+    if (pImpl->pending.damagedCount == 0) {
+        return rects;
+    }
+
+    // One rectangle per run of damaged tiles in a tile row
+    for (int ty = 0; ty < pImpl->tilesY; ty++) {
+        const uint8_t* row = pImpl->pending.tiles.data() + static_cast<size_t>(ty) * pImpl->tilesX;
+        for (int tx = 0; tx < pImpl->tilesX; tx++) {
+            if (!row[tx]) {
+                continue;
+            }
+            int start = tx;
+            while (tx + 1 < pImpl->tilesX && row[tx + 1]) {
+                tx++;
+            }
+            DamageRect rect;
+            rect.x = start * kTileSize;
+            rect.y = ty * kTileSize;
+            rect.width = std::min((tx + 1) * kTileSize, pImpl->width) - rect.x;
+            rect.height = std::min((ty + 1) * kTileSize, pImpl->height) - rect.y;
+            rects.push_back(rect);
+        }
+    }
+    pImpl->pending.clear();
+    return rects;
+}
+
+int DamageTracker::addListener(double threshold, std::function<void(double)> callback) {
+    std::lock_guard<std::mutex> lock(pImpl->mutex);
+    Listener listener;
+    listener.id = pImpl->nextListenerId++;
+    listener.threshold = threshold;
+    listener.callback = callback;
+    listener.seen.resize(pImpl->pending.tiles.size());
+    pImpl->listeners.push_back(std::move(listener));
+    return pImpl->listeners.back().id;
+}
+
+void DamageTracker::removeListener(int id) {
+    std::lock_guard<std::mutex> lock(pImpl->mutex);
+    pImpl->listeners.erase(std::remove_if(pImpl->listeners.begin(), pImpl->listeners.end(),
+                                          [id](const Listener& listener) { return listener.id == id; }),
+                           pImpl->listeners.end());
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "DatabaseManager.h"
+#include "LatencyHistogram.h"
 
 // MySQL connector headers would go here in a real implementation
 // #include <mysql_driver.h>
@@ -49,18 +50,22 @@ DatabaseManager::~DatabaseManager() = default;
 
 bool DatabaseManager::connect(const std::string& host, const std::string& user, 
                               const std::string& password, const std::string& database, int port) {
+    ScopedLatency timing(PipelineStage::Database);
     return pImpl->connect(host, user, password, database, port);
 }
 
 bool DatabaseManager::validateUser(const std::string& userId) {
+    ScopedLatency timing(PipelineStage::Database);
     return pImpl->validateUser(userId);
 }
 
 bool DatabaseManager::insertActivityData(const std::string& userId, const std::string& activityData) {
+    ScopedLatency timing(PipelineStage::Database);
     return pImpl->insertActivityData(userId, activityData);
 }
 
 bool DatabaseManager::insertNetworkUsage(const std::string& userId, long bytesSent, long bytesReceived) {
+    ScopedLatency timing(PipelineStage::Database);
     return pImpl->insertNetworkUsage(userId, bytesSent, bytesReceived);
 }
 
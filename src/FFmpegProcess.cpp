@@ -0,0 +1,329 @@
+#include "FFmpegProcess.h"
+#include "ImageEncoder.h"
+#include "LatencyHistogram.h"
+
+#ifndef _WIN32
+
+#include <spawn.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <iostream>
+
+extern char** environ;
+
+namespace {
+// Room for a good part of a frame in the pipe, so ffmpeg can read while we write
+const int kPipeSize = 1 << 20;
+const std::chrono::milliseconds kReapPollInterval(20);
+const std::chrono::milliseconds kDefaultMaxGap(2000);
+
+// Blocks SIGPIPE on the calling thread for the duration of a write, so a dead ffmpeg shows up
+// as EPIPE instead of killing the app, without changing the process-wide disposition
+class ScopedSigpipeBlock {
+public:
+    ScopedSigpipeBlock() {
+        sigemptyset(&pipeSignal);
+        sigaddset(&pipeSignal, SIGPIPE);
+        pthread_sigmask(SIG_BLOCK, &pipeSignal, &previousMask);
+        sigset_t pending;
+        sigpending(&pending);
+        alreadyPending = sigismember(&pending, SIGPIPE) == 1;
+    }
+
+    ~ScopedSigpipeBlock() {
+        pthread_sigmask(SIG_SETMASK, &previousMask, nullptr);
+    }
+
+    // Swallow the SIGPIPE our own write raised, leaving one that was pending before alone
+    void consumeRaised() {
+        if (alreadyPending) {
+            return;
+        }
+        struct timespec noWait = {0, 0};
+        while (sigtimedwait(&pipeSignal, nullptr, &noWait) < 0 && errno == EINTR) {
+        }
+    }
+
+private:
+    sigset_t pipeSignal;
+    sigset_t previousMask;
+    bool alreadyPending = false;
+};
+}
+
+class FFmpegProcess::Impl {
+public:
+    pid_t pid = -1;
+    int inputFd = -1;
+    int width = 0;
+    int height = 0;
+    int frameRate = 0;
+    int exitCode = -1;
+    uint64_t bytesWritten = 0;
+    uint64_t framesWritten = 0;
+    uint64_t slotsCollapsed = 0;
+    int64_t firstTimestampMs = -1;
+    std::chrono::milliseconds maxGap = kDefaultMaxGap;
+    std::vector<uint8_t> yuv;
+
+    void closeInput() {
+        if (inputFd >= 0) {
+            ::close(inputFd);
+            inputFd = -1;
+        }
+    }
+
+    bool writeAll(const uint8_t* data, size_t size) {
+        ScopedSigpipeBlock sigpipeBlock;
+        while (size > 0) {
+            ssize_t written = ::write(inputFd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                int error = errno;
+                if (error == EPIPE) {
+                    sigpipeBlock.consumeRaised();
+                }
+                std::cerr << "Failed to write frame to ffmpeg: " << std::strerror(error) << std::endl;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            bytesWritten += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    // Record the exit status once the child is gone
+    void reaped(int status) {
+        pid = -1;
+        exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+        if (WIFSIGNALED(status)) {
+            std::cerr << "ffmpeg terminated by signal " << WTERMSIG(status) << std::endl;
+        }
+    }
+
+    // Reap the child, waiting until deadline; false if it is still running
+    bool waitUntil(std::chrono::steady_clock::time_point deadline) {
+        while (pid > 0) {
+            int status = 0;
+            pid_t result = waitpid(pid, &status, WNOHANG);
+            if (result == pid) {
+                reaped(status);
+                return true;
+            }
+            if (result < 0 && errno != EINTR) {
+                std::cerr << "waitpid failed for ffmpeg: " << std::strerror(errno) << std::endl;
+                pid = -1;
+                return true;
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                return false;
+            }
+            std::this_thread::sleep_for(kReapPollInterval);
+        }
+        return true;
+    }
+};
+
+FFmpegProcess::FFmpegProcess() : pImpl(std::make_unique<Impl>()) {}
+
+FFmpegProcess::~FFmpegProcess() {
+    stop();
+}
+
+bool FFmpegProcess::start(int width, int height, int frameRate, const std::vector<std::string>& outputArgs) {
+    if (pImpl->pid > 0) {
+        std::cerr << "ffmpeg is already running" << std::endl;
+        return false;
+    }
+    if (frameRate <= 0) {
+        std::cerr << "Invalid ffmpeg input frame rate: " << frameRate << std::endl;
+        return false;
+    }
+
+    // Timestamps come from each frame's position on the constant-rate input, not from when
+    // ffmpeg happens to read it
+    std::vector<std::string> args = {
+        "ffmpeg", "-hide_banner", "-loglevel", "warning",
+        "-f", "rawvideo", "-pix_fmt", "yuv420p",
+        "-framerate", std::to_string(frameRate),
+        "-video_size", std::to_string(width) + "x" + std::to_string(height),
+        "-i", "pipe:0"
+    };
+    args.insert(args.end(), outputArgs.begin(), outputArgs.end());
+
+    std::vector<char*> argv;
+    for (auto& arg : args) {
+        argv.push_back(&arg[0]);
+    }
+    argv.push_back(nullptr);
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        std::cerr << "Failed to create pipe for ffmpeg: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    // Keep both ends out of any other child we spawn; dup2 below gives ffmpeg its own stdin
+    fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+#ifdef F_SETPIPE_SZ
+    fcntl(fds[1], F_SETPIPE_SZ, kPipeSize);
+#endif
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[0], STDIN_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // Own process group so a Ctrl-C on our terminal doesn't cut the file short before we stop it,
+    // and default signal handling whatever the app has set up for itself
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    sigset_t signals;
+    sigemptyset(&signals);
+    posix_spawnattr_setsigmask(&attributes, &signals);
+    sigaddset(&signals, SIGPIPE);
+    sigaddset(&signals, SIGINT);
+    posix_spawnattr_setsigdefault(&attributes, &signals);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETPGROUP);
+
+    pid_t pid = -1;
+    int error = posix_spawnp(&pid, "ffmpeg", &actions, &attributes, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    ::close(fds[0]);
+
+    if (error != 0) {
+        std::cerr << "Failed to launch ffmpeg: " << std::strerror(error) << std::endl;
+        ::close(fds[1]);
+        return false;
+    }
+
+    pImpl->pid = pid;
+    pImpl->inputFd = fds[1];
+    pImpl->width = width;
+    pImpl->height = height;
+    pImpl->frameRate = frameRate;
+    pImpl->exitCode = -1;
+    pImpl->bytesWritten = 0;
+    pImpl->framesWritten = 0;
+    pImpl->slotsCollapsed = 0;
+    pImpl->firstTimestampMs = -1;
+    return true;
+}
+
+bool FFmpegProcess::writeFrame(const Frame& frame, int64_t timestampMs) {
+    if (pImpl->inputFd < 0) {
+        return false;
+    }
+    if (frame.format != PixelFormat::BGRA || frame.width != pImpl->width || frame.height != pImpl->height) {
+        std::cerr << "Frame does not match the ffmpeg input (" << pImpl->width << "x" << pImpl->height
+                  << " BGRA)" << std::endl;
+        return false;
+    }
+
+    // The first frame opens the timeline; each later one belongs to the slot nearest its timestamp,
+    // less the slots already cut out of long gaps
+    if (pImpl->firstTimestampMs < 0) {
+        pImpl->firstTimestampMs = timestampMs;
+    }
+    int64_t slot = std::llround((timestampMs - pImpl->firstTimestampMs) * pImpl->frameRate / 1000.0) -
+                   static_cast<int64_t>(pImpl->slotsCollapsed);
+    int64_t written = static_cast<int64_t>(pImpl->framesWritten);
+    if (written > 0 && slot < written) {
+        return true;
+    }
+
+    // Fill at most maxGap with repeats; writing out an hour of a locked screen would block this
+    // thread for minutes and starve the capture loop of buffers
+    int64_t maxRepeats = std::max<int64_t>(1, pImpl->maxGap.count() * pImpl->frameRate / 1000);
+    if (written > 0 && slot - written > maxRepeats) {
+        pImpl->slotsCollapsed += static_cast<uint64_t>(slot - written - maxRepeats);
+        slot = written + maxRepeats;
+    }
+
+    // Repeats of a static screen are cheap for the encoder and reuse the previous conversion
+    for (int64_t i = written; i < slot; ++i) {
+        if (!pImpl->writeAll(pImpl->yuv.data(), pImpl->yuv.size())) {
+            return false;
+        }
+        pImpl->framesWritten++;
+    }
+
+    // I420 is 1.5 bytes per pixel instead of 4, and it is what the encoder wants anyway
+    auto convertStart = std::chrono::steady_clock::now();
+    if (!ImageEncoder::convertToYuv420(frame, YuvLayout::I420, pImpl->yuv)) {
+        return false;
+    }
+    PipelineLatency::stage(PipelineStage::Convert).recordSince(convertStart);
+
+    if (!pImpl->writeAll(pImpl->yuv.data(), pImpl->yuv.size())) {
+        return false;
+    }
+    pImpl->framesWritten++;
+    return true;
+}
+
+void FFmpegProcess::setMaxGap(std::chrono::milliseconds gap) {
+    pImpl->maxGap = gap;
+}
+
+int FFmpegProcess::stop(std::chrono::milliseconds timeout) {
+    pImpl->closeInput();
+    if (pImpl->pid <= 0) {
+        return pImpl->exitCode;
+    }
+
+    if (pImpl->waitUntil(std::chrono::steady_clock::now() + timeout)) {
+        return pImpl->exitCode;
+    }
+
+    std::cerr << "ffmpeg still running after end of input, sending SIGINT" << std::endl;
+    kill(pImpl->pid, SIGINT);
+    if (pImpl->waitUntil(std::chrono::steady_clock::now() + timeout)) {
+        return pImpl->exitCode;
+    }
+
+    std::cerr << "ffmpeg ignored SIGINT, killing it" << std::endl;
+    kill(pImpl->pid, SIGKILL);
+    int status = 0;
+    while (waitpid(pImpl->pid, &status, 0) < 0 && errno == EINTR) {
+    }
+    pImpl->reaped(status);
+    return pImpl->exitCode;
+}
+
+bool FFmpegProcess::isRunning() {
+    if (pImpl->pid <= 0) {
+        return false;
+    }
+    return !pImpl->waitUntil(std::chrono::steady_clock::now());
+}
+
+uint64_t FFmpegProcess::getBytesWritten() const {
+    return pImpl->bytesWritten;
+}
+
+uint64_t FFmpegProcess::getFramesWritten() const {
+    return pImpl->framesWritten;
+}
+
+uint64_t FFmpegProcess::getSlotsCollapsed() const {
+    return pImpl->slotsCollapsed;
+}
+
+#endif
@@ -0,0 +1,194 @@
+#include "FrameBufferPool.h"
+#include "QueueMetrics.h"
+
+#include <new>
+#include <utility>
+#include <iostream>
+
+namespace {
+// Cache-line alignment keeps rows friendly to the SIMD converters and avoids false sharing
+const size_t kBufferAlignment = 64;
+}
+
+PooledFrame::PooledFrame(const PooledFrame& other) : buffer(other.buffer) {
+    if (buffer) {
+        buffer->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+PooledFrame::PooledFrame(PooledFrame&& other) noexcept : buffer(other.buffer) {
+    other.buffer = nullptr;
+}
+
+PooledFrame& PooledFrame::operator=(const PooledFrame& other) {
+    if (this != &other) {
+        PooledFrame copy(other);
+        std::swap(buffer, copy.buffer);
+    }
+    return *this;
+}
+
+PooledFrame& PooledFrame::operator=(PooledFrame&& other) noexcept {
+    if (this != &other) {
+        reset();
+        buffer = other.buffer;
+        other.buffer = nullptr;
+    }
+    return *this;
+}
+
+PooledFrame::~PooledFrame() {
+    reset();
+}
+
+void PooledFrame::reset() {
+    if (buffer && buffer->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        buffer->owner->recycle(buffer);
+    }
+    buffer = nullptr;
+}
+
+FrameBufferPool::FrameBufferPool() : bufferSize(0), exhaustedCount(0) {}
+
+FrameBufferPool::~FrameBufferPool() {
+    release();
+}
+
+bool FrameBufferPool::allocate(size_t bufferCount, size_t size) {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (freeList.size() != buffers.size()) {
+        std::cerr << "Cannot resize frame pool while buffers are in use" << std::endl;
+        return false;
+    }
+
+    for (auto& buffer : buffers) {
+        ::operator delete(buffer->data, std::align_val_t(kBufferAlignment));
+    }
+    buffers.clear();
+    freeList.clear();
+
+    buffers.reserve(bufferCount);
+    freeList.reserve(bufferCount);
+    for (size_t i = 0; i < bufferCount; i++) {
+        auto buffer = std::make_unique<PooledBuffer>();
+        buffer->data = static_cast<uint8_t*>(::operator new(size, std::align_val_t(kBufferAlignment)));
+        buffer->capacity = size;
+        buffer->owner = this;
+        freeList.push_back(buffer.get());
+        buffers.push_back(std::move(buffer));
+    }
+
+    bufferSize = size;
+    return true;
+}
+
+void FrameBufferPool::release() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (freeList.size() != buffers.size()) {
+        std::cerr << "Frame pool released with buffers still in use" << std::endl;
+    }
+
+    for (auto& buffer : buffers) {
+        ::operator delete(buffer->data, std::align_val_t(kBufferAlignment));
+    }
+    buffers.clear();
+    freeList.clear();
+    bufferSize = 0;
+}
+
+PooledFrame FrameBufferPool::acquire(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(mutex);
+
+    if (!bufferFreed.wait_for(lock, timeout, [this] { return !freeList.empty(); })) {
+        exhaustedCount++;
+        return PooledFrame();
+    }
+
+    PooledBuffer* buffer = freeList.back();
+    freeList.pop_back();
+    buffer->refCount.store(1, std::memory_order_relaxed);
+    buffer->frame = Frame();
+    return PooledFrame(buffer);
+}
+
+void FrameBufferPool::recycle(PooledBuffer* buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        freeList.push_back(buffer);
+    }
+    bufferFreed.notify_one();
+}
+
+size_t FrameBufferPool::getBufferCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return buffers.size();
+}
+
+size_t FrameBufferPool::getBufferSize() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return bufferSize;
+}
+
+size_t FrameBufferPool::getFreeCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return freeList.size();
+}
+
+uint64_t FrameBufferPool::getExhaustedCount() const {
+    return exhaustedCount;
+}
+
+FrameQueue::FrameQueue(size_t capacity, QueueCounters* counters)
+    : ring(capacity > 0 ? capacity : 1), head(0), count(0), closed(false), counters(counters) {}
+
+bool FrameQueue::push(Entry entry) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (closed || count == ring.size()) {
+            if (counters && !closed) {
+                counters->dropped();
+            }
+            return false;
+        }
+        entry.queuedAt = std::chrono::steady_clock::now();
+        ring[(head + count) % ring.size()] = std::move(entry);
+        count++;
+    }
+    if (counters) {
+        counters->pushed();
+    }
+    entryAdded.notify_one();
+    return true;
+}
+
+bool FrameQueue::pop(Entry& entry) {
+    std::unique_lock<std::mutex> lock(mutex);
+    entryAdded.wait(lock, [this] { return count > 0 || closed; });
+
+    if (count == 0) {
+        return false;
+    }
+
+    entry = std::move(ring[head]);
+    head = (head + 1) % ring.size();
+    count--;
+    if (counters) {
+        counters->popped(entry.queuedAt);
+    }
+    return true;
+}
+
+void FrameQueue::close() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+    }
+    entryAdded.notify_all();
+}
+
+size_t FrameQueue::size() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return count;
+}
@@ -0,0 +1,985 @@
+#include "ImageEncoder.h"
+#include "QoiCodec.h"
+
+#include <fstream>
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <thread>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef WITH_JPEG
+#include <cstdio>
+#include <cstdlib>
+#include <csetjmp>
+#include <jpeglib.h>
+#endif
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define IMAGE_ENCODER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSSE3
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+typedef void (*ConvertKernel)(const uint8_t* src, uint8_t* dst, size_t pixelCount);
+typedef void (*AccumulateKernel)(const uint8_t* src, uint16_t* sums, size_t byteCount);
+typedef void (*LumaKernel)(const uint8_t* src, uint8_t* y, int width);
+typedef void (*ChromaKernel)(const uint8_t* row0, const uint8_t* row1, uint8_t* u, uint8_t* v, int width);
+
+// Limited-range BT.601 in 8.8 fixed point, the matrix libswscale and most encoders assume.
+// Chroma is taken from the sum of each 2x2 block, hence the extra 2 bits of shift.
+const int kLumaRound = 128;
+const int kChromaBias = 512 + (128 << 10);
+
+// ---- Scalar kernels ----
+
+void bgraToBgrScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++) {
+        dst[i * 3] = src[i * 4];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4 + 2];
+    }
+}
+
+void bgraToRgbScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++) {
+        dst[i * 3] = src[i * 4 + 2];
+        dst[i * 3 + 1] = src[i * 4 + 1];
+        dst[i * 3 + 2] = src[i * 4];
+    }
+}
+
+void swapRedBlueScalar(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++) {
+        dst[i * 3] = src[i * 3 + 2];
+        dst[i * 3 + 1] = src[i * 3 + 1];
+        dst[i * 3 + 2] = src[i * 3];
+    }
+}
+
+// Adds a row of bytes into 16-bit column sums (the vertical half of the box filter)
+void accumulateRowScalar(const uint8_t* src, uint16_t* sums, size_t byteCount) {
+    for (size_t i = 0; i < byteCount; i++) {
+        sums[i] += src[i];
+    }
+}
+
+void bgraToLumaScalar(const uint8_t* src, uint8_t* y, int width) {
+    for (int x = 0; x < width; x++, src += 4) {
+        y[x] = static_cast<uint8_t>(((25 * src[0] + 129 * src[1] + 66 * src[2] + kLumaRound) >> 8) + 16);
+    }
+}
+
+// One chroma row from two BGRA rows. An odd last column is paired with itself.
+// With v == nullptr, U and V are interleaved into u (NV12).
+void bgraToChromaScalar(const uint8_t* row0, const uint8_t* row1, uint8_t* u, uint8_t* v, int width) {
+    for (int x = 0; x < width; x += 2) {
+        const uint8_t* a = row0 + x * 4;
+        const uint8_t* b = row1 + x * 4;
+        int next = x + 1 < width ? 4 : 0;
+        int blue = a[0] + a[next] + b[0] + b[next];
+        int green = a[1] + a[next + 1] + b[1] + b[next + 1];
+        int red = a[2] + a[next + 2] + b[2] + b[next + 2];
+        uint8_t cb = static_cast<uint8_t>((112 * blue - 74 * green - 38 * red + kChromaBias) >> 10);
+        uint8_t cr = static_cast<uint8_t>((-18 * blue - 94 * green + 112 * red + kChromaBias) >> 10);
+        if (v) {
+            u[x / 2] = cb;
+            v[x / 2] = cr;
+        } else {
+            u[x] = cb;
+            u[x + 1] = cr;
+        }
+    }
+}
+
+#ifdef IMAGE_ENCODER_X86
+
+// ---- SSSE3 kernels ----
+// Each step stores a full 16-byte register, so the loops stop early enough
+// that the over-written tail stays inside dst; the scalar kernel finishes the rest.
+
+TARGET_SSSE3 void bgraToBgrSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    const __m128i mask = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 6 <= pixelCount; i += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(pixels, mask));
+    }
+    bgraToBgrScalar(src + i * 4, dst + i * 3, pixelCount - i);
+}
+
+TARGET_SSSE3 void bgraToRgbSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    size_t i = 0;
+    for (; i + 6 <= pixelCount; i += 4) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(pixels, mask));
+    }
+    bgraToRgbScalar(src + i * 4, dst + i * 3, pixelCount - i);
+}
+
+TARGET_SSSE3 void swapRedBlueSsse3(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    // Five 3-byte pixels per 16-byte register; byte 15 belongs to the next pixel
+    const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    size_t i = 0;
+    for (; i + 6 <= pixelCount; i += 5) {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 3), _mm_shuffle_epi8(pixels, mask));
+    }
+    swapRedBlueScalar(src + i * 3, dst + i * 3, pixelCount - i);
+}
+
+TARGET_SSSE3 void accumulateRowSsse3(const uint8_t* src, uint16_t* sums, size_t byteCount) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= byteCount; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i* out = reinterpret_cast<__m128i*>(sums + i);
+        _mm_storeu_si128(out, _mm_add_epi16(_mm_loadu_si128(out), _mm_unpacklo_epi8(bytes, zero)));
+        _mm_storeu_si128(out + 1, _mm_add_epi16(_mm_loadu_si128(out + 1), _mm_unpackhi_epi8(bytes, zero)));
+    }
+    accumulateRowScalar(src + i, sums + i, byteCount - i);
+}
+
+// 16 pixels per step: unpack to 16 bits, weight B,G,R with pmaddwd and add the two halves of each pixel
+TARGET_SSSE3 void bgraToLumaSsse3(const uint8_t* src, uint8_t* y, int width) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i coeffs = _mm_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0);
+    const __m128i round = _mm_set1_epi32(kLumaRound);
+    const __m128i offset = _mm_set1_epi8(16);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i sums[4];
+        for (int i = 0; i < 4; i++) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + (x + i * 4) * 4));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi8(pixels, zero), coeffs);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi8(pixels, zero), coeffs);
+            sums[i] = _mm_srli_epi32(_mm_add_epi32(_mm_hadd_epi32(lo, hi), round), 8);
+        }
+        __m128i luma = _mm_packus_epi16(_mm_packs_epi32(sums[0], sums[1]), _mm_packs_epi32(sums[2], sums[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y + x), _mm_add_epi8(luma, offset));
+    }
+    bgraToLumaScalar(src + x * 4, y + x, width - x);
+}
+
+// 16 pixels (8 chroma samples) per step: pmaddubsw adds horizontal neighbours per channel,
+// the two rows are added, and pmaddwd + phaddd produce [U0 U1 V0 V1] per 4 pixels
+TARGET_SSSE3 void bgraToChromaSsse3(const uint8_t* row0, const uint8_t* row1, uint8_t* u, uint8_t* v, int width) {
+    const __m128i pairChannels = _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+    const __m128i ones = _mm_set1_epi8(1);
+    const __m128i uCoeffs = _mm_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0);
+    const __m128i vCoeffs = _mm_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0);
+    const __m128i bias = _mm_set1_epi32(kChromaBias);
+    const __m128i planar = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+    const __m128i interleaved = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    int x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m128i samples[4];
+        for (int i = 0; i < 4; i++) {
+            size_t offset = static_cast<size_t>(x + i * 4) * 4;
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + offset)), pairChannels);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + offset)), pairChannels);
+            __m128i block = _mm_add_epi16(_mm_maddubs_epi16(a, ones), _mm_maddubs_epi16(b, ones));
+            __m128i uv = _mm_hadd_epi32(_mm_madd_epi16(block, uCoeffs), _mm_madd_epi16(block, vCoeffs));
+            samples[i] = _mm_srli_epi32(_mm_add_epi32(uv, bias), 10);
+        }
+        // [U0 U1 V0 V1 U2 U3 V2 V3 ...] -> planar or interleaved order
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(samples[0], samples[1]), _mm_packs_epi32(samples[2], samples[3]));
+        if (v) {
+            packed = _mm_shuffle_epi8(packed, planar);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(u + x / 2), packed);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(v + x / 2), _mm_srli_si128(packed, 8));
+        } else {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x), _mm_shuffle_epi8(packed, interleaved));
+        }
+    }
+    bgraToChromaScalar(row0 + x * 4, row1 + x * 4, v ? u + x / 2 : u + x, v ? v + x / 2 : nullptr, width - x);
+}
+
+// ---- AVX2 kernels ----
+
+TARGET_AVX2 void accumulateRowAvx2(const uint8_t* src, uint16_t* sums, size_t byteCount) {
+    size_t i = 0;
+    for (; i + 16 <= byteCount; i += 16) {
+        __m256i widened = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+        __m256i* out = reinterpret_cast<__m256i*>(sums + i);
+        _mm256_storeu_si256(out, _mm256_add_epi16(_mm256_loadu_si256(out), widened));
+    }
+    accumulateRowScalar(src + i, sums + i, byteCount - i);
+}
+
+// The shuffle packs 12 bytes at the bottom of each 128-bit lane; the permute joins the two lanes
+TARGET_AVX2 void bgraToBgrAvx2(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    const __m256i mask = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 11 <= pixelCount; i += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, mask), join);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 3), packed);
+    }
+    bgraToBgrScalar(src + i * 4, dst + i * 3, pixelCount - i);
+}
+
+TARGET_AVX2 void bgraToRgbAvx2(const uint8_t* src, uint8_t* dst, size_t pixelCount) {
+    const __m256i mask = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 11 <= pixelCount; i += 8) {
+        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+        __m256i packed = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, mask), join);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i * 3), packed);
+    }
+    bgraToRgbScalar(src + i * 4, dst + i * 3, pixelCount - i);
+}
+
+// Same arithmetic as the SSSE3 kernels on 32 pixels per step. The packs work per 128-bit lane,
+// so a final dword permute puts the results back in pixel order.
+TARGET_AVX2 void bgraToLumaAvx2(const uint8_t* src, uint8_t* y, int width) {
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i coeffs = _mm256_setr_epi16(25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0, 25, 129, 66, 0);
+    const __m256i round = _mm256_set1_epi32(kLumaRound);
+    const __m256i offset = _mm256_set1_epi8(16);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i sums[4];
+        for (int i = 0; i < 4; i++) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + (x + i * 8) * 4));
+            __m256i lo = _mm256_madd_epi16(_mm256_unpacklo_epi8(pixels, zero), coeffs);
+            __m256i hi = _mm256_madd_epi16(_mm256_unpackhi_epi8(pixels, zero), coeffs);
+            sums[i] = _mm256_srli_epi32(_mm256_add_epi32(_mm256_hadd_epi32(lo, hi), round), 8);
+        }
+        __m256i luma = _mm256_packus_epi16(_mm256_packs_epi32(sums[0], sums[1]), _mm256_packs_epi32(sums[2], sums[3]));
+        luma = _mm256_permutevar8x32_epi32(luma, order);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(y + x), _mm256_add_epi8(luma, offset));
+    }
+    bgraToLumaSsse3(src + x * 4, y + x, width - x);
+}
+
+TARGET_AVX2 void bgraToChromaAvx2(const uint8_t* row0, const uint8_t* row1, uint8_t* u, uint8_t* v, int width) {
+    const __m256i pairChannels = _mm256_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15,
+                                                  0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15);
+    const __m256i ones = _mm256_set1_epi8(1);
+    const __m256i uCoeffs = _mm256_setr_epi16(112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0, 112, -74, -38, 0);
+    const __m256i vCoeffs = _mm256_setr_epi16(-18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0, -18, -94, 112, 0);
+    const __m256i bias = _mm256_set1_epi32(kChromaBias);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    const __m256i planar = _mm256_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15,
+                                            0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15);
+    const __m256i interleaved = _mm256_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15,
+                                                 0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i samples[4];
+        for (int i = 0; i < 4; i++) {
+            size_t offset = static_cast<size_t>(x + i * 8) * 4;
+            __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + offset)), pairChannels);
+            __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + offset)), pairChannels);
+            __m256i block = _mm256_add_epi16(_mm256_maddubs_epi16(a, ones), _mm256_maddubs_epi16(b, ones));
+            __m256i uv = _mm256_hadd_epi32(_mm256_madd_epi16(block, uCoeffs), _mm256_madd_epi16(block, vCoeffs));
+            samples[i] = _mm256_srli_epi32(_mm256_add_epi32(uv, bias), 10);
+        }
+        __m256i packed = _mm256_packus_epi16(_mm256_packs_epi32(samples[0], samples[1]),
+                                             _mm256_packs_epi32(samples[2], samples[3]));
+        packed = _mm256_permutevar8x32_epi32(packed, order);
+        if (v) {
+            // Each lane is [8 U | 8 V]; gather the U halves into the low lane
+            packed = _mm256_permute4x64_epi64(_mm256_shuffle_epi8(packed, planar), 0xD8);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(u + x / 2), _mm256_castsi256_si128(packed));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(v + x / 2), _mm256_extracti128_si256(packed, 1));
+        } else {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(u + x), _mm256_shuffle_epi8(packed, interleaved));
+        }
+    }
+    bgraToChromaSsse3(row0 + x * 4, row1 + x * 4, v ? u + x / 2 : u + x, v ? v + x / 2 : nullptr, width - x);
+}
+
+#endif
+
+enum class SimdLevel {
+    Scalar,
+    SSSE3,
+    AVX2
+};
+
+SimdLevel detectSimdLevel() {
+#ifdef IMAGE_ENCODER_X86
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    // REMOTE_WORKER_SIMD=scalar|ssse3 caps the level, so tests can check every kernel on one machine
+    const char* cap = std::getenv("REMOTE_WORKER_SIMD");
+    if (cap && std::strcmp(cap, "scalar") == 0) {
+        ssse3 = false;
+        avx2 = false;
+    } else if (cap && std::strcmp(cap, "ssse3") == 0) {
+        avx2 = false;
+    }
+
+    if (avx2) return SimdLevel::AVX2;
+    if (ssse3) return SimdLevel::SSSE3;
+#endif
+    return SimdLevel::Scalar;
+}
+
+SimdLevel simdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+struct Kernels {
+    ConvertKernel bgraToBgr;
+    ConvertKernel bgraToRgb;
+    ConvertKernel swapRedBlue;
+    AccumulateKernel accumulateRow;
+    LumaKernel bgraToLuma;
+    ChromaKernel bgraToChroma;
+};
+
+const Kernels& kernels() {
+    static const Kernels selected = []() {
+        Kernels k = {bgraToBgrScalar, bgraToRgbScalar, swapRedBlueScalar, accumulateRowScalar,
+                     bgraToLumaScalar, bgraToChromaScalar};
+#ifdef IMAGE_ENCODER_X86
+        SimdLevel level = simdLevel();
+        if (level == SimdLevel::AVX2) {
+            k.bgraToBgr = bgraToBgrAvx2;
+            k.bgraToRgb = bgraToRgbAvx2;
+            k.swapRedBlue = swapRedBlueSsse3; // 3-byte pixels straddle AVX2 lanes, SSSE3 is as fast
+            k.accumulateRow = accumulateRowAvx2;
+            k.bgraToLuma = bgraToLumaAvx2;
+            k.bgraToChroma = bgraToChromaAvx2;
+        } else if (level == SimdLevel::SSSE3) {
+            k.bgraToBgr = bgraToBgrSsse3;
+            k.bgraToRgb = bgraToRgbSsse3;
+            k.swapRedBlue = swapRedBlueSsse3;
+            k.accumulateRow = accumulateRowSsse3;
+            k.bgraToLuma = bgraToLumaSsse3;
+            k.bgraToChroma = bgraToChromaSsse3;
+        }
+#endif
+        return k;
+    }();
+    return selected;
+}
+
+int bytesPerPixel(PixelFormat format) {
+    return format == PixelFormat::BGRA ? 4 : 3;
+}
+
+// Horizontal half of the box filter: add up `factor` neighbouring column sums per channel
+// and scale by the 16.16 reciprocal of the block area. Sums never exceed 16 bits (factor <= 16).
+template <int Channels>
+void sumBlocks(const uint16_t* sums, uint8_t* out, int outWidth, int factor, uint32_t reciprocal) {
+    for (int x = 0; x < outWidth; x++) {
+        uint32_t totals[Channels] = {};
+        for (int dx = 0; dx < factor; dx++) {
+            for (int c = 0; c < Channels; c++) {
+                totals[c] += sums[c];
+            }
+            sums += Channels;
+        }
+        for (int c = 0; c < Channels; c++) {
+            out[c] = static_cast<uint8_t>((totals[c] * reciprocal + 32768) >> 16);
+        }
+        out += Channels;
+    }
+}
+
+void put32LE(uint8_t* out, uint32_t value) {
+    out[0] = value & 0xFF;
+    out[1] = (value >> 8) & 0xFF;
+    out[2] = (value >> 16) & 0xFF;
+    out[3] = (value >> 24) & 0xFF;
+}
+
+void append32BE(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((value >> 24) & 0xFF);
+    out.push_back((value >> 16) & 0xFF);
+    out.push_back((value >> 8) & 0xFF);
+    out.push_back(value & 0xFF);
+}
+
+#ifndef WITH_ZLIB
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    static uint32_t table[256];
+    static bool tableReady = []() {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return true;
+    }();
+    (void)tableReady;
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+uint32_t adler32Update(uint32_t adler, const uint8_t* data, size_t length) {
+    uint32_t a = adler & 0xFFFF;
+    uint32_t b = adler >> 16;
+    while (length > 0) {
+        size_t block = length < 5552 ? length : 5552; // Largest run without 32-bit overflow
+        length -= block;
+        while (block--) {
+            a += *data++;
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    return (b << 16) | a;
+}
+#endif
+
+uint32_t chunkCrc(const uint8_t* data, size_t length) {
+#ifdef WITH_ZLIB
+    return static_cast<uint32_t>(crc32(0L, data, static_cast<uInt>(length)));
+#else
+    return crc32Update(0, data, length);
+#endif
+}
+
+void appendChunk(std::vector<uint8_t>& out, const char type[4], const uint8_t* data, size_t length) {
+    append32BE(out, static_cast<uint32_t>(length));
+    size_t typeOffset = out.size();
+    out.insert(out.end(), type, type + 4);
+    if (length > 0) {
+        out.insert(out.end(), data, data + length);
+    }
+    append32BE(out, chunkCrc(out.data() + typeOffset, length + 4));
+}
+
+// Convert a band of rows to RGB scanlines with the PNG "Sub" filter applied.
+// Sub only looks at the current row, so bands can be filtered independently,
+// and it turns flat UI colour runs into zeros, which deflate compresses very well.
+void buildFilteredScanlines(const Frame& frame, int firstRow, int rowCount, std::vector<uint8_t>& raw) {
+    size_t rowBytes = static_cast<size_t>(frame.width) * 3;
+    raw.resize((rowBytes + 1) * rowCount);
+    std::vector<uint8_t> rgbRow(rowBytes);
+
+    for (int row = 0; row < rowCount; row++) {
+        const uint8_t* src = frame.data + static_cast<size_t>(firstRow + row) * frame.stride;
+        ImageEncoder::convertPixels(src, frame.format, rgbRow.data(), PixelFormat::RGB, frame.width);
+
+        uint8_t* out = raw.data() + row * (rowBytes + 1);
+        out[0] = 1; // Sub
+        out[1] = rgbRow[0];
+        out[2] = rgbRow[1];
+        out[3] = rgbRow[2];
+        for (size_t i = 3; i < rowBytes; i++) {
+            out[1 + i] = static_cast<uint8_t>(rgbRow[i] - rgbRow[i - 3]);
+        }
+    }
+}
+
+// Run job(0..count-1) with one thread per index, the calling thread taking index 0
+void runParallel(int count, const std::function<void(int)>& job) {
+    std::vector<std::thread> workers;
+    workers.reserve(count > 1 ? count - 1 : 0);
+    for (int i = 1; i < count; i++) {
+        workers.emplace_back(job, i);
+    }
+    job(0);
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+#ifdef WITH_ZLIB
+// Compress one band as raw deflate data. Every band but the last ends with a
+// byte-aligned sync flush, so the bands concatenate into a single valid stream
+// (the pigz approach).
+bool deflateBand(const std::vector<uint8_t>& raw, const std::vector<uint8_t>* previousBand, bool lastBand,
+                 int compressionLevel, std::vector<uint8_t>& compressed) {
+    z_stream stream = {};
+    if (deflateInit2(&stream, compressionLevel, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return false;
+    }
+
+    // Prime the window with the tail of the previous band so matches can cross the seam
+    if (previousBand && !previousBand->empty()) {
+        size_t dictionarySize = std::min<size_t>(previousBand->size(), 32768);
+        deflateSetDictionary(&stream, previousBand->data() + previousBand->size() - dictionarySize,
+                             static_cast<uInt>(dictionarySize));
+    }
+
+    compressed.resize(deflateBound(&stream, static_cast<uLong>(raw.size())) + 16);
+    stream.next_in = const_cast<Bytef*>(raw.data());
+    stream.avail_in = static_cast<uInt>(raw.size());
+    stream.next_out = compressed.data();
+    stream.avail_out = static_cast<uInt>(compressed.size());
+
+    int flush = lastBand ? Z_FINISH : Z_SYNC_FLUSH;
+    bool ok = false;
+    while (true) {
+        int result = deflate(&stream, flush);
+        if (result == Z_STREAM_ERROR) {
+            break;
+        }
+
+        bool done = lastBand ? result == Z_STREAM_END : (stream.avail_in == 0 && stream.avail_out != 0);
+        if (done) {
+            ok = true;
+            break;
+        }
+        if (stream.avail_out != 0) {
+            break; // No progress possible
+        }
+
+        size_t used = compressed.size();
+        compressed.resize(used * 2);
+        stream.next_out = compressed.data() + used;
+        stream.avail_out = static_cast<uInt>(compressed.size() - used);
+    }
+
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ok;
+}
+
+// Filter and deflate the frame in row bands on worker threads, then stitch the
+// bands into one zlib stream with a combined Adler-32.
+bool compressImageData(const Frame& frame, const PngOptions& options, std::vector<uint8_t>& compressed) {
+    const int minRowsPerBand = 64;
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    int bands = std::max(1, std::min(threads, frame.height / minRowsPerBand));
+    int rowsPerBand = (frame.height + bands - 1) / bands;
+    bands = (frame.height + rowsPerBand - 1) / rowsPerBand;
+    int level = std::max(0, std::min(9, options.compressionLevel));
+
+    std::vector<std::vector<uint8_t>> raw(bands);
+    std::vector<std::vector<uint8_t>> deflated(bands);
+    std::vector<uLong> checksums(bands);
+    std::vector<char> bandOk(bands, 0);
+
+    runParallel(bands, [&](int band) {
+        int firstRow = band * rowsPerBand;
+        int rowCount = std::min(rowsPerBand, frame.height - firstRow);
+        buildFilteredScanlines(frame, firstRow, rowCount, raw[band]);
+        checksums[band] = adler32(1L, raw[band].data(), static_cast<uInt>(raw[band].size()));
+    });
+
+    // Second pass so each band can use its predecessor's tail as a dictionary
+    runParallel(bands, [&](int band) {
+        bandOk[band] = deflateBand(raw[band], band > 0 ? &raw[band - 1] : nullptr, band == bands - 1,
+                                   level, deflated[band]);
+    });
+
+    size_t total = 6;
+    for (int band = 0; band < bands; band++) {
+        if (!bandOk[band]) {
+            return false;
+        }
+        total += deflated[band].size();
+    }
+
+    // zlib header: deflate with 32K window, FLEVEL matching the compression level
+    compressed.clear();
+    compressed.reserve(total);
+    compressed.push_back(0x78);
+    compressed.push_back(level < 2 ? 0x01 : level < 6 ? 0x5E : level == 6 ? 0x9C : 0xDA);
+
+    uLong adler = checksums[0];
+    for (int band = 0; band < bands; band++) {
+        compressed.insert(compressed.end(), deflated[band].begin(), deflated[band].end());
+        if (band > 0) {
+            adler = adler32_combine(adler, checksums[band], static_cast<z_off_t>(raw[band].size()));
+        }
+    }
+    append32BE(compressed, static_cast<uint32_t>(adler));
+    return true;
+}
+#else
+// No zlib: emit a valid zlib stream made of stored (uncompressed) blocks
+bool compressImageData(const Frame& frame, const PngOptions&, std::vector<uint8_t>& compressed) {
+    std::vector<uint8_t> raw;
+    buildFilteredScanlines(frame, 0, frame.height, raw);
+
+    compressed.clear();
+    compressed.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    compressed.push_back(0x78);
+    compressed.push_back(0x01);
+
+    size_t offset = 0;
+    do {
+        size_t blockSize = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+        bool last = offset + blockSize == raw.size();
+        compressed.push_back(last ? 1 : 0);
+        compressed.push_back(blockSize & 0xFF);
+        compressed.push_back((blockSize >> 8) & 0xFF);
+        compressed.push_back(~blockSize & 0xFF);
+        compressed.push_back((~blockSize >> 8) & 0xFF);
+        compressed.insert(compressed.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+        offset += blockSize;
+    } while (offset < raw.size());
+
+    append32BE(compressed, adler32Update(1, raw.data(), raw.size()));
+    return true;
+}
+#endif
+
+#ifdef WITH_JPEG
+struct JpegErrorManager {
+    jpeg_error_mgr base;
+    jmp_buf jump;
+};
+
+// libjpeg's default handler calls exit(); unwind back to encodeJpeg instead
+void jpegErrorExit(j_common_ptr cinfo) {
+    char message[JMSG_LENGTH_MAX];
+    cinfo->err->format_message(cinfo, message);
+    std::cerr << "JPEG encoder error: " << message << std::endl;
+    longjmp(reinterpret_cast<JpegErrorManager*>(cinfo->err)->jump, 1);
+}
+#endif
+
+}
+
+bool ImageEncoder::convertPixels(const uint8_t* src, PixelFormat srcFormat,
+                                 uint8_t* dst, PixelFormat dstFormat, size_t pixelCount) {
+    if (srcFormat == dstFormat) {
+        std::memcpy(dst, src, pixelCount * bytesPerPixel(srcFormat));
+        return true;
+    }
+
+    const Kernels& k = kernels();
+    if (srcFormat == PixelFormat::BGRA && dstFormat == PixelFormat::BGR) {
+        k.bgraToBgr(src, dst, pixelCount);
+    } else if (srcFormat == PixelFormat::BGRA && dstFormat == PixelFormat::RGB) {
+        k.bgraToRgb(src, dst, pixelCount);
+    } else if (srcFormat != PixelFormat::BGRA && dstFormat != PixelFormat::BGRA) {
+        k.swapRedBlue(src, dst, pixelCount);
+    } else {
+        std::cerr << "Unsupported pixel conversion" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ImageEncoder::downscale(const Frame& frame, int factor, std::vector<uint8_t>& pixels, Frame& scaled) {
+    if (!frame.data || factor < 1 || factor > kMaxDownscaleFactor) {
+        return false;
+    }
+
+    int bpp = bytesPerPixel(frame.format);
+    int outWidth = frame.width / factor;
+    int outHeight = frame.height / factor;
+    if (outWidth <= 0 || outHeight <= 0) {
+        std::cerr << "Frame too small to downscale by " << factor << std::endl;
+        return false;
+    }
+
+    // Trailing columns/rows that don't fill a whole block are dropped
+    size_t rowBytes = static_cast<size_t>(outWidth) * factor * bpp;
+    size_t outRowBytes = static_cast<size_t>(outWidth) * bpp;
+    pixels.resize(outRowBytes * outHeight);
+
+    // Divide by multiplying with a 16.16 reciprocal of the block area
+    const uint32_t area = static_cast<uint32_t>(factor) * factor;
+    const uint32_t reciprocal = (65536 + area / 2) / area;
+    const Kernels& k = kernels();
+    std::vector<uint16_t> sums(rowBytes);
+
+    for (int y = 0; y < outHeight; y++) {
+        std::fill(sums.begin(), sums.end(), 0);
+        for (int dy = 0; dy < factor; dy++) {
+            const uint8_t* srcRow = frame.data + static_cast<size_t>(y * factor + dy) * frame.stride;
+            k.accumulateRow(srcRow, sums.data(), rowBytes);
+        }
+
+        uint8_t* outRow = pixels.data() + outRowBytes * y;
+        if (bpp == 4) {
+            sumBlocks<4>(sums.data(), outRow, outWidth, factor, reciprocal);
+        } else {
+            sumBlocks<3>(sums.data(), outRow, outWidth, factor, reciprocal);
+        }
+    }
+
+    scaled.data = pixels.data();
+    scaled.width = outWidth;
+    scaled.height = outHeight;
+    scaled.stride = static_cast<int>(outRowBytes);
+    scaled.format = frame.format;
+    return true;
+}
+
+bool ImageEncoder::convertToYuv420(const Frame& frame, YuvLayout layout, uint8_t* y, int yStride,
+                                   uint8_t* u, int uStride, uint8_t* v, int vStride) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0 || frame.format != PixelFormat::BGRA) {
+        std::cerr << "YUV conversion needs a BGRA frame" << std::endl;
+        return false;
+    }
+
+    const Kernels& k = kernels();
+    uint8_t* planeV = layout == YuvLayout::I420 ? v : nullptr;
+    for (int row = 0; row < frame.height; row += 2) {
+        const uint8_t* row0 = frame.data + static_cast<size_t>(frame.stride) * row;
+        // An odd last row is paired with itself
+        const uint8_t* row1 = row + 1 < frame.height ? row0 + frame.stride : row0;
+        k.bgraToLuma(row0, y + static_cast<size_t>(yStride) * row, frame.width);
+        if (row1 != row0) {
+            k.bgraToLuma(row1, y + static_cast<size_t>(yStride) * (row + 1), frame.width);
+        }
+        k.bgraToChroma(row0, row1, u + static_cast<size_t>(uStride) * (row / 2),
+                       planeV ? planeV + static_cast<size_t>(vStride) * (row / 2) : nullptr, frame.width);
+    }
+    return true;
+}
+
+bool ImageEncoder::convertToYuv420(const Frame& frame, YuvLayout layout, std::vector<uint8_t>& output) {
+    size_t lumaSize = static_cast<size_t>(frame.width) * frame.height;
+    int chromaWidth = (frame.width + 1) / 2;
+    size_t chromaSize = static_cast<size_t>(chromaWidth) * ((frame.height + 1) / 2);
+    output.resize(lumaSize + chromaSize * 2);
+
+    uint8_t* y = output.data();
+    uint8_t* u = y + lumaSize;
+    if (layout == YuvLayout::NV12) {
+        return convertToYuv420(frame, layout, y, frame.width, u, chromaWidth * 2, nullptr, 0);
+    }
+    return convertToYuv420(frame, layout, y, frame.width, u, chromaWidth, u + chromaSize, chromaWidth);
+}
+
+bool ImageEncoder::encodeBmp(const Frame& frame, std::vector<uint8_t>& output) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+        return false;
+    }
+
+    const uint32_t headersSize = 54;
+    size_t rowSize = (static_cast<size_t>(frame.width) * 3 + 3) & ~static_cast<size_t>(3); // 4-byte aligned rows
+    size_t imageSize = rowSize * frame.height;
+
+    output.assign(headersSize + imageSize, 0);
+    uint8_t* header = output.data();
+
+    // BITMAPFILEHEADER
+    header[0] = 'B';
+    header[1] = 'M';
+    put32LE(header + 2, static_cast<uint32_t>(headersSize + imageSize));
+    put32LE(header + 10, headersSize);
+
+    // BITMAPINFOHEADER (bottom-up, 24bpp, BI_RGB)
+    put32LE(header + 14, 40);
+    put32LE(header + 18, frame.width);
+    put32LE(header + 22, frame.height);
+    header[26] = 1;
+    header[28] = 24;
+    put32LE(header + 34, static_cast<uint32_t>(imageSize));
+
+    uint8_t* pixels = output.data() + headersSize;
+    for (int y = 0; y < frame.height; y++) {
+        const uint8_t* src = frame.data + static_cast<size_t>(frame.height - 1 - y) * frame.stride;
+        convertPixels(src, frame.format, pixels + y * rowSize, PixelFormat::BGR, frame.width);
+    }
+
+    return true;
+}
+
+bool ImageEncoder::encodePng(const Frame& frame, std::vector<uint8_t>& output, const PngOptions& options) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> compressed;
+    if (!compressImageData(frame, options, compressed)) {
+        std::cerr << "PNG compression failed" << std::endl;
+        return false;
+    }
+
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    output.clear();
+    output.reserve(compressed.size() + 64);
+    output.insert(output.end(), signature, signature + 8);
+
+    uint8_t ihdr[13] = {0};
+    ihdr[0] = (frame.width >> 24) & 0xFF;
+    ihdr[1] = (frame.width >> 16) & 0xFF;
+    ihdr[2] = (frame.width >> 8) & 0xFF;
+    ihdr[3] = frame.width & 0xFF;
+    ihdr[4] = (frame.height >> 24) & 0xFF;
+    ihdr[5] = (frame.height >> 16) & 0xFF;
+    ihdr[6] = (frame.height >> 8) & 0xFF;
+    ihdr[7] = frame.height & 0xFF;
+    ihdr[8] = 8; // Bit depth
+    ihdr[9] = 2; // Colour type: truecolour RGB
+    appendChunk(output, "IHDR", ihdr, sizeof(ihdr));
+    appendChunk(output, "IDAT", compressed.data(), compressed.size());
+    appendChunk(output, "IEND", nullptr, 0);
+
+    return true;
+}
+
+bool ImageEncoder::encodeJpeg(const Frame& frame, std::vector<uint8_t>& output, int quality) {
+#ifdef WITH_JPEG
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+        return false;
+    }
+
+    jpeg_compress_struct cinfo;
+    JpegErrorManager errorManager;
+    unsigned char* buffer = nullptr;
+    unsigned long bufferSize = 0;
+    std::vector<uint8_t> rgbRow;
+
+    cinfo.err = jpeg_std_error(&errorManager.base);
+    errorManager.base.error_exit = jpegErrorExit;
+    if (setjmp(errorManager.jump)) {
+        jpeg_destroy_compress(&cinfo);
+        free(buffer);
+        return false;
+    }
+
+    jpeg_create_compress(&cinfo);
+    jpeg_mem_dest(&cinfo, &buffer, &bufferSize);
+
+    cinfo.image_width = frame.width;
+    cinfo.image_height = frame.height;
+#ifdef JCS_EXTENSIONS
+    // libjpeg-turbo reads BGRX/BGR directly, no swizzle pass needed
+    bool convertRows = false;
+    if (frame.format == PixelFormat::BGRA) {
+        cinfo.in_color_space = JCS_EXT_BGRX;
+        cinfo.input_components = 4;
+    } else if (frame.format == PixelFormat::BGR) {
+        cinfo.in_color_space = JCS_EXT_BGR;
+        cinfo.input_components = 3;
+    } else {
+        cinfo.in_color_space = JCS_RGB;
+        cinfo.input_components = 3;
+    }
+#else
+    bool convertRows = frame.format != PixelFormat::RGB;
+    cinfo.in_color_space = JCS_RGB;
+    cinfo.input_components = 3;
+    rgbRow.resize(static_cast<size_t>(frame.width) * 3);
+#endif
+
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, std::max(1, std::min(100, quality)), TRUE);
+    cinfo.dct_method = JDCT_IFAST;
+    jpeg_start_compress(&cinfo, TRUE);
+
+    while (cinfo.next_scanline < cinfo.image_height) {
+        const uint8_t* src = frame.data + static_cast<size_t>(cinfo.next_scanline) * frame.stride;
+        if (convertRows) {
+            convertPixels(src, frame.format, rgbRow.data(), PixelFormat::RGB, frame.width);
+            src = rgbRow.data();
+        }
+        JSAMPROW row = const_cast<JSAMPROW>(src);
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+
+    jpeg_finish_compress(&cinfo);
+    output.assign(buffer, buffer + bufferSize);
+    jpeg_destroy_compress(&cinfo);
+    free(buffer);
+    return true;
+#else
+    (void)frame;
+    (void)output;
+    (void)quality;
+    std::cerr << "JPEG support not compiled in" << std::endl;
+    return false;
+#endif
+}
+
+bool ImageEncoder::isJpegAvailable() {
+#ifdef WITH_JPEG
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool ImageEncoder::encode(const Frame& frame, ImageFormat format, std::vector<uint8_t>& output,
+                          const PngOptions& pngOptions, int jpegQuality) {
+    switch (format) {
+        case ImageFormat::PNG: return encodePng(frame, output, pngOptions);
+        case ImageFormat::QOI: return QoiCodec::encode(frame, output);
+        case ImageFormat::JPEG: return encodeJpeg(frame, output, jpegQuality);
+        case ImageFormat::BMP: return encodeBmp(frame, output);
+    }
+    return false;
+}
+
+bool ImageEncoder::saveImage(const std::string& filePath, const Frame& frame, ImageFormat format,
+                             const PngOptions& pngOptions, int jpegQuality) {
+    std::vector<uint8_t> encoded;
+    if (!encode(frame, format, encoded, pngOptions, jpegQuality)) {
+        std::cerr << "Failed to encode image: " << filePath << std::endl;
+        return false;
+    }
+    return writeFile(filePath, encoded);
+}
+
+bool ImageEncoder::writeFile(const std::string& filePath, const std::vector<uint8_t>& data) {
+    std::ofstream file(filePath, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create file: " << filePath << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    return file.good();
+}
+
+const char* ImageEncoder::extensionFor(ImageFormat format) {
+    switch (format) {
+        case ImageFormat::PNG: return ".png";
+        case ImageFormat::QOI: return ".qoi";
+        case ImageFormat::JPEG: return ".jpg";
+        case ImageFormat::BMP: return ".bmp";
+    }
+    return "";
+}
+
+const char* ImageEncoder::simdLevel() {
+    switch (::simdLevel()) {
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::SSSE3: return "ssse3";
+        default: return "scalar";
+    }
+}
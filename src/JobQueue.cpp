@@ -0,0 +1,95 @@
+#include "JobQueue.h"
+#include "UiNotifier.h"
+#include "QueueMetrics.h"
+#include "ThreadName.h"
+
+#include <algorithm>
+
+JobQueue::JobQueue(size_t threadCount, QueueCounters* counters) : running(0), stopping(false), counters(counters) {
+    threadCount = std::max<size_t>(threadCount, 1);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&JobQueue::workerLoop, this);
+    }
+}
+
+JobQueue::~JobQueue() {
+    // Jobs already queued still run (an upload shouldn't be lost); their callbacks are dropped
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    jobAvailable.notify_all();
+    for (auto& worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+JobQueue& JobQueue::shared() {
+    static JobQueue queue(2, &QueueMetrics::queue(BackgroundQueue::Jobs));
+    return queue;
+}
+
+void JobQueue::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back({std::move(job), std::chrono::steady_clock::now()});
+    }
+    if (counters) {
+        counters->pushed();
+    }
+    jobAvailable.notify_one();
+}
+
+void JobQueue::postCompletion(std::function<void()> callback) {
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        completions.push_back(std::move(callback));
+    }
+    // The UI thread may be asleep waiting for events
+    UiNotifier::requestRedraw();
+}
+
+size_t JobQueue::runCompletions() {
+    std::vector<std::function<void()>> ready;
+    {
+        std::lock_guard<std::mutex> lock(completionMutex);
+        ready.swap(completions);
+    }
+
+    // Outside the lock: callbacks may submit follow-up jobs
+    for (auto& callback : ready) {
+        callback();
+    }
+    return ready.size();
+}
+
+size_t JobQueue::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return jobs.size() + running;
+}
+
+void JobQueue::workerLoop() {
+    setCurrentThreadName("rw-job");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+        if (jobs.empty()) {
+            return;
+        }
+
+        QueuedJob job = std::move(jobs.front());
+        jobs.pop_front();
+        running++;
+
+        lock.unlock();
+        if (counters) {
+            counters->popped(job.queuedAt);
+        }
+        job.function();
+        lock.lock();
+
+        running--;
+    }
+}
@@ -0,0 +1,150 @@
+#include "LatencyHistogram.h"
+
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <ctime>
+
+namespace {
+const uint64_t kSubBucketCount = 1ull << LatencyHistogram::kSubBucketBits;
+
+int highestBit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// Values below 32 ns get a bucket each; above that, every power of two is split into 32
+int bucketIndex(uint64_t value) {
+    if (value < kSubBucketCount) {
+        return static_cast<int>(value);
+    }
+    int shift = highestBit(value) - LatencyHistogram::kSubBucketBits;
+    int index = static_cast<int>(((static_cast<uint64_t>(shift) + 1) << LatencyHistogram::kSubBucketBits) +
+                                 ((value >> shift) - kSubBucketCount));
+    return index < LatencyHistogram::kBucketCount ? index : LatencyHistogram::kBucketCount - 1;
+}
+
+// Midpoint of the values that map to a bucket
+double bucketValue(int index) {
+    if (index < static_cast<int>(kSubBucketCount)) {
+        return index;
+    }
+    int shift = (index >> LatencyHistogram::kSubBucketBits) - 1;
+    uint64_t lowest = (kSubBucketCount + (index & (kSubBucketCount - 1))) << shift;
+    return static_cast<double>(lowest) + ((1ull << shift) - 1) / 2.0;
+}
+
+double toMs(double nanoseconds) {
+    return nanoseconds / 1e6;
+}
+}
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    buckets[bucketIndex(nanoseconds)].fetch_add(1, std::memory_order_relaxed);
+    totalNs.fetch_add(nanoseconds, std::memory_order_relaxed);
+
+    uint64_t currentMax = maxNs.load(std::memory_order_relaxed);
+    while (nanoseconds > currentMax &&
+           !maxNs.compare_exchange_weak(currentMax, nanoseconds, std::memory_order_relaxed)) {
+    }
+}
+
+LatencySummary LatencyHistogram::summary() const {
+    LatencySummary result;
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (int i = 0; i < kBucketCount; i++) {
+        counts[i] = buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+    if (total == 0) {
+        return result;
+    }
+
+    result.count = total;
+    result.meanMs = toMs(static_cast<double>(totalNs.load(std::memory_order_relaxed)) / total);
+    result.maxMs = toMs(static_cast<double>(maxNs.load(std::memory_order_relaxed)));
+
+    const double percentiles[3] = {0.50, 0.90, 0.99};
+    double* outputs[3] = {&result.p50Ms, &result.p90Ms, &result.p99Ms};
+    uint64_t seen = 0;
+    int next = 0;
+    for (int i = 0; i < kBucketCount && next < 3; i++) {
+        seen += counts[i];
+        while (next < 3 && seen >= static_cast<uint64_t>(percentiles[next] * total + 0.5)) {
+            // Bucket midpoints can overshoot the largest sample; never report above it
+            *outputs[next] = std::min(toMs(bucketValue(i)), result.maxMs);
+            next++;
+        }
+    }
+    return result;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    totalNs.store(0, std::memory_order_relaxed);
+    maxNs.store(0, std::memory_order_relaxed);
+}
+
+LatencyHistogram& PipelineLatency::stage(PipelineStage stage) {
+    static LatencyHistogram histograms[static_cast<int>(PipelineStage::Count)];
+    return histograms[static_cast<int>(stage)];
+}
+
+const char* PipelineLatency::stageName(PipelineStage stage) {
+    switch (stage) {
+        case PipelineStage::Grab: return "grab";
+        case PipelineStage::Stitch: return "stitch";
+        case PipelineStage::Diff: return "diff";
+        case PipelineStage::Hash: return "hash";
+        case PipelineStage::Thumbnail: return "thumbnail";
+        case PipelineStage::Encode: return "encode";
+        case PipelineStage::Write: return "write";
+        case PipelineStage::Convert: return "convert";
+        case PipelineStage::VideoEncode: return "video_encode";
+        case PipelineStage::Upload: return "upload";
+        case PipelineStage::Database: return "database";
+        case PipelineStage::Count: break;
+    }
+    return "unknown";
+}
+
+bool PipelineLatency::dumpToFile(const std::string& filePath) {
+    std::ofstream file(filePath, std::ios::app);
+    if (!file) {
+        std::cerr << "Failed to open " << filePath << " for latency dump" << std::endl;
+        return false;
+    }
+
+    std::time_t now = std::time(nullptr);
+    file << "# pipeline latency at " << now << " (ms)\n";
+    file << "# stage count mean p50 p90 p99 max\n";
+    file << std::fixed << std::setprecision(3);
+    for (int i = 0; i < static_cast<int>(PipelineStage::Count); i++) {
+        PipelineStage current = static_cast<PipelineStage>(i);
+        LatencySummary summary = stage(current).summary();
+        file << stageName(current) << " " << summary.count << " " << summary.meanMs << " " << summary.p50Ms
+             << " " << summary.p90Ms << " " << summary.p99Ms << " " << summary.maxMs << "\n";
+    }
+    return static_cast<bool>(file);
+}
+
+void PipelineLatency::resetAll() {
+    for (int i = 0; i < static_cast<int>(PipelineStage::Count); i++) {
+        stage(static_cast<PipelineStage>(i)).reset();
+    }
+}
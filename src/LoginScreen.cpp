@@ -1,5 +1,6 @@
 #include "LoginScreen.h"
 #include "DatabaseManager.h"
+#include "JobQueue.h"
 
 #include "imgui.h"
 #include <string>
@@ -19,7 +20,8 @@ void LoginScreen::render() {
     ImGui::Begin("User Login", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
     
     ImGui::Text("Please enter your User ID:");
-    ImGui::InputText("User ID", userIdBuffer, sizeof(userIdBuffer));
+    // Locked while the ID is being checked so the validated ID is the one we keep
+    ImGui::InputText("User ID", userIdBuffer, sizeof(userIdBuffer), connecting ? ImGuiInputTextFlags_ReadOnly : 0);
     
     if (!errorMessage.empty()) {
         ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "%s", errorMessage.c_str());
@@ -33,20 +35,20 @@ void LoginScreen::render() {
             std::string userId(userIdBuffer);
             if (!userId.empty()) {
                 connecting = true;
-                
-                // Create database manager and try to validate user
-                DatabaseManager dbManager;
-                if (dbManager.connect("localhost", "root", "", "worker_db")) {
-                    if (dbManager.validateUser(userId)) {
-                        loginSuccessful = true;
-                    } else {
-                        errorMessage = "Invalid User ID";
+                errorMessage.clear();
+
+                // Validate on a worker; the result comes back on this thread at a later frame
+                JobQueue::shared().submit([userId]() {
+                    DatabaseManager dbManager;
+                    if (!dbManager.connect("localhost", "root", "", "worker_db")) {
+                        return std::string("Cannot connect to server");
                     }
-                } else {
-                    errorMessage = "Cannot connect to server";
-                }
-                
-                connecting = false;
+                    return dbManager.validateUser(userId) ? std::string() : std::string("Invalid User ID");
+                }, [this](const std::string& error) {
+                    connecting = false;
+                    loginSuccessful = error.empty();
+                    errorMessage = error;
+                });
             } else {
                 errorMessage = "Please enter a User ID";
             }
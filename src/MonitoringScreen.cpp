@@ -1,113 +1,65 @@
 #include "MonitoringScreen.h"
-#include "AppState.h"
-#include "ScreenCapture.h"
-#include "UserActivity.h"
-#include "NetworkMonitor.h"
-#include "FileUploader.h"
-#include "DatabaseManager.h"
+#include "MonitoringSession.h"
+#include "TelemetrySampler.h"
+#include "LatencyHistogram.h"
+#include "JobQueue.h"
 
 #include "imgui.h"
-#include <chrono>
-#include <thread>
-#include <random>
-#include <iostream>
-
-MonitoringScreen::MonitoringScreen() : timerRunning(false), currentState(MonitoringState::STOPPED), isRecording(false), screenCapture(nullptr) {
-    // Initialize monitoring components
-    screenCapture = new ScreenCapture();
-}
+#include <algorithm>
+#include <cstdio>
 
-MonitoringScreen::~MonitoringScreen() {
-    if (timerRunning) {
-        stopRandomScreenshotTimer();
-    }
+MonitoringScreen::MonitoringScreen() : session(std::make_unique<MonitoringSession>()), statusIsError(false),
+    progress(-1.0f), chartShowDay(false) {}
 
-    // Stop recording if it's in progress
-    if (isRecording && screenCapture) {
-        screenCapture->stopRecording();
-        isRecording = false;
-    }
-
-    // Clean up the screen capture object
-    if (screenCapture) {
-        delete screenCapture;
-        screenCapture = nullptr;
-    }
-}
+MonitoringScreen::~MonitoringScreen() = default;
 
 void MonitoringScreen::render() {
+    applyStatusEvents();
+
     ImGui::SetNextWindowPos(ImVec2(ImGui::GetIO().DisplaySize.x * 0.5f, ImGui::GetIO().DisplaySize.y * 0.5f), ImGuiCond_Always, ImVec2(0.5f, 0.5f));
     ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiCond_Always);
 
     ImGui::Begin("Work Monitoring Dashboard", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoCollapse);
 
     // Control buttons
+    MonitoringState currentState = session->getState();
     if (currentState == MonitoringState::STOPPED) {
         if (ImGui::Button("Start Monitoring")) {
-            startMonitoring();
-            currentState = MonitoringState::RUNNING;
+            session->start();
         }
     } else if (currentState == MonitoringState::RUNNING) {
         if (ImGui::Button("Pause")) {
-            pauseMonitoring();
-            currentState = MonitoringState::PAUSED;
+            session->pause();
         }
         if (ImGui::Button("Stop")) {
-            stopMonitoring();
-            currentState = MonitoringState::STOPPED;
+            session->stop();
         }
     } else if (currentState == MonitoringState::PAUSED) {
         if (ImGui::Button("Resume")) {
-            resumeMonitoring();
-            currentState = MonitoringState::RUNNING;
+            session->resume();
         }
         if (ImGui::Button("Stop")) {
-            stopMonitoring();
-            currentState = MonitoringState::STOPPED;
+            session->stop();
         }
     }
 
     // Additional functionality buttons
     ImGui::Separator();
-    if (ImGui::Button("Take Screenshot Now")) {
-        ScreenCapture screenCapture;
-        std::string screenshotPath = screenCapture.captureScreen();
-
-        if (!screenshotPath.empty()) {
-            // Upload screenshot
-            FileUploader uploader;
-            uploader.setServerCredentials("localhost", "root", "");
-            uploader.uploadFile(screenshotPath, "/screenshots/" + userId + "/");
-
-            // Record to database
-            DatabaseManager dbManager;
-            dbManager.connect("localhost", "root", "", "worker_db");
-            dbManager.insertActivityData(userId, "manual_screenshot_taken");
-
-            statusMessage = "Manual screenshot taken: " + screenshotPath;
-        } else {
-            statusMessage = "Failed to take screenshot";
-        }
+    if (session->isScreenshotPending()) {
+        ImGui::Text("Taking screenshot...");
+    } else if (ImGui::Button("Take Screenshot Now")) {
+        session->takeScreenshot();
     }
 
-    if (!isRecording) {
+    if (session->isRecordingStopPending()) {
+        ImGui::Text("Stopping recording...");
+    } else if (!session->isRecording()) {
         if (ImGui::Button("Start Recording")) {
-            std::string recordingPath = "recording_" + userId + ".mkv";
-            if (screenCapture->startRecording(recordingPath)) {
-                isRecording = true;
-                statusMessage = "Started recording: " + recordingPath;
-            } else {
-                statusMessage = "Failed to start recording";
-            }
+            session->startRecording();
         }
     } else {
         if (ImGui::Button("Stop Recording")) {
-            if (screenCapture->stopRecording()) {
-                isRecording = false;
-                statusMessage = "Stopped recording";
-            } else {
-                statusMessage = "Failed to stop recording";
-            }
+            session->stopRecording();
         }
     }
 
@@ -118,122 +70,160 @@ void MonitoringScreen::render() {
         currentState == MonitoringState::PAUSED ? "Paused" : "Stopped");
 
     if (!statusMessage.empty()) {
-        ImGui::Text("Info: %s", statusMessage.c_str());
+        if (statusIsError) {
+            ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Error: %s", statusMessage.c_str());
+        } else {
+            ImGui::Text("Info: %s", statusMessage.c_str());
+        }
+    }
+    if (progress >= 0.0f) {
+        ImGui::ProgressBar(progress, ImVec2(-1.0f, 0.0f), progressText.c_str());
     }
 
-    // Show some stats
-    UserActivity userActivity;
-    bool isIdle = userActivity.isUserIdle(300); // 5 minutes threshold
-    ImGui::Text("User Status: %s", isIdle ? "Idle" : "Active");
-
-    NetworkMonitor networkMonitor;
-    auto networkUsage = networkMonitor.getNetworkUsage();
-    ImGui::Text("Network Usage - Sent: %llu bytes, Received: %llu bytes",
-                networkUsage.bytesSent, networkUsage.bytesReceived);
-
-    ImGui::End();
-}
+    if (session->isRecording()) {
+        EncoderStats stats = session->getRecordingStats();
+        ImGui::Text("Recording: %llu frames at %.1f fps, %.2f ms/frame (CPU %.2f ms/frame)",
+                    static_cast<unsigned long long>(stats.framesEncoded), stats.currentFrameRate,
+                    stats.averageEncodeMs(), stats.averageCpuMs());
+    }
 
-void MonitoringScreen::setUserId(const std::string& id) {
-    userId = id;
-}
+    ScreenshotStats periodicStats = session->getPeriodicScreenshotStats();
+    if (periodicStats.duplicatesSkipped > 0) {
+        ImGui::Text("Unchanged screenshots skipped: %llu (%llu bytes saved)",
+                    static_cast<unsigned long long>(periodicStats.duplicatesSkipped),
+                    static_cast<unsigned long long>(periodicStats.bytesSaved));
+    }
 
-void MonitoringScreen::triggerStartMonitoring() {
-    if (currentState == MonitoringState::STOPPED) {
-        startMonitoring();
-        currentState = MonitoringState::RUNNING;
+    // Show some stats
+    TelemetrySampler& telemetry = session->getTelemetry();
+    std::shared_ptr<const TelemetrySnapshot> sample = telemetry.latest();
+    if (sample->sequence > 0) {
+        bool isIdle = sample->idleMs / 1000 > 300; // 5 minutes threshold
+        ImGui::Text("User Status: %s", sample->screenLocked ? "Locked" : isIdle ? "Idle" : "Active");
+        ImGui::Text("Network Usage - Sent: %llu bytes, Received: %llu bytes",
+                    sample->network.bytesSent, sample->network.bytesReceived);
+        ImGui::Text("Agent: %.1f%% CPU, %.1f MB resident", sample->processCpuPercent,
+                    sample->residentBytes / (1024.0 * 1024.0));
     }
-}
 
-void MonitoringScreen::triggerStopMonitoring() {
-    if (currentState != MonitoringState::STOPPED) {
-        stopMonitoring();
-        currentState = MonitoringState::STOPPED;
+    // Throughput history: average per bucket as a line, per-bucket peak as bars so bursts stand out
+    if (ImGui::CollapsingHeader("Throughput")) {
+        if (ImGui::RadioButton("Last 10 minutes", !chartShowDay)) {
+            chartShowDay = false;
+        }
+        ImGui::SameLine();
+        if (ImGui::RadioButton("Last 24 hours", chartShowDay)) {
+            chartShowDay = true;
+        }
+        SeriesResolution resolution = chartShowDay ? SeriesResolution::Minute : SeriesResolution::Second;
+
+        const TelemetryMetric metrics[3] = {TelemetryMetric::ReceiveRate, TelemetryMetric::SendRate,
+                                            TelemetryMetric::ProcessCpu};
+        for (TelemetryMetric metric : metrics) {
+            const TimeSeries& series = telemetry.history(metric);
+            series.read(resolution, SeriesAggregate::Average, chartAverage);
+            series.read(resolution, SeriesAggregate::Max, chartPeak);
+
+            bool isRate = metric != TelemetryMetric::ProcessCpu;
+            float scale = isRate ? 1.0f / 1024.0f : 1.0f;
+            float peak = 0.0f;
+            for (size_t i = 0; i < chartPeak.size(); i++) {
+                chartAverage[i] *= scale;
+                chartPeak[i] *= scale;
+                peak = std::max(peak, chartPeak[i]);
+            }
+            float top = std::max(peak * 1.1f, isRate ? 1.0f : 10.0f);
+
+            char overlay[64];
+            snprintf(overlay, sizeof(overlay), "%s (peak %.1f %s)", TelemetrySampler::metricName(metric), peak,
+                     isRate ? "KB/s" : "%");
+            ImGui::PushID(static_cast<int>(metric));
+            ImGui::PlotLines("##average", chartAverage.data(), static_cast<int>(chartAverage.size()), 0, overlay,
+                             0.0f, top, ImVec2(-1.0f, 50.0f));
+            ImGui::PlotHistogram("##peak", chartPeak.data(), static_cast<int>(chartPeak.size()), 0, nullptr,
+                                 0.0f, top, ImVec2(-1.0f, 25.0f));
+            ImGui::PopID();
+        }
     }
-}
 
-void MonitoringScreen::startMonitoring() {
-    statusMessage = "Monitoring started...";
+    // Where screenshot and recording time goes, per pipeline stage
+    if (ImGui::CollapsingHeader("Pipeline Latency")) {
+        if (ImGui::BeginTable("latency", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            const char* columns[6] = {"Stage", "Count", "p50 ms", "p90 ms", "p99 ms", "Max ms"};
+            for (const char* column : columns) {
+                ImGui::TableSetupColumn(column);
+            }
+            ImGui::TableHeadersRow();
+
+            for (int i = 0; i < static_cast<int>(PipelineStage::Count); i++) {
+                PipelineStage stage = static_cast<PipelineStage>(i);
+                LatencySummary summary = PipelineLatency::stage(stage).summary();
+                if (summary.count == 0) {
+                    continue;
+                }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(PipelineLatency::stageName(stage));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(summary.count));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", summary.p50Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", summary.p90Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", summary.p99Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", summary.maxMs);
+            }
+            ImGui::EndTable();
+        }
 
-    // Start random screenshot timer
-    startRandomScreenshotTimer();
+        if (ImGui::Button("Dump to File")) {
+            // Reported through the session's channel, which outlives this screen if need be
+            std::shared_ptr<StatusChannel> status = session->getStatusChannel();
+            JobQueue::shared().submit([status]() {
+                bool written = PipelineLatency::dumpToFile("pipeline_latency.txt");
+                status->post(written ? StatusKind::Info : StatusKind::Error,
+                             written ? "Latency histograms appended to pipeline_latency.txt"
+                                     : "Failed to write pipeline_latency.txt");
+            });
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Reset")) {
+            PipelineLatency::resetAll();
+        }
+    }
 
-    // Here you would start other monitoring components
-    std::cout << "Monitoring started for user: " << userId << std::endl;
+    ImGui::End();
 }
 
-void MonitoringScreen::stopMonitoring() {
-    statusMessage = "Monitoring stopped.";
-
-    // Stop random screenshot timer
-    stopRandomScreenshotTimer();
-
-    // Stop any ongoing recording
-    if (isRecording && screenCapture) {
-        screenCapture->stopRecording();
-        isRecording = false;
-    }
-
-    std::cout << "Monitoring stopped for user: " << userId << std::endl;
+void MonitoringScreen::setUserId(const std::string& id) {
+    session->setUserId(id);
 }
 
-void MonitoringScreen::pauseMonitoring() {
-    statusMessage = "Monitoring paused.";
-    std::cout << "Monitoring paused for user: " << userId << std::endl;
+void MonitoringScreen::triggerStartMonitoring() {
+    session->start();
 }
 
-void MonitoringScreen::resumeMonitoring() {
-    statusMessage = "Monitoring resumed.";
-    
-    // Restart random screenshot timer if needed
-    startRandomScreenshotTimer();
-    
-    std::cout << "Monitoring resumed for user: " << userId << std::endl;
+void MonitoringScreen::triggerStopMonitoring() {
+    session->stop();
 }
 
-void MonitoringScreen::startRandomScreenshotTimer() {
-    if (timerRunning) return;
-    
-    timerRunning = true;
-    screenshotTimerThread = std::thread([this]() {
-        std::random_device rd;
-        std::mt19937 gen(rd());
-        // Random interval between 10-30 minutes (600-1800 seconds)
-        std::uniform_int_distribution<> dis(600, 1800);
-        
-        while (timerRunning) {
-            int interval = dis(gen);
-            
-            std::this_thread::sleep_for(std::chrono::seconds(interval));
-            
-            if (!timerRunning) break;
-            
-            // Take screenshot
-            ScreenCapture screenCapture;
-            std::string screenshotPath = screenCapture.captureScreen();
-            
-            if (!screenshotPath.empty()) {
-                // Upload screenshot
-                FileUploader uploader;
-                uploader.setServerCredentials("localhost", "root", "");
-                uploader.uploadFile(screenshotPath, "/screenshots/" + userId + "/");
-                
-                // Record to database
-                DatabaseManager dbManager;
-                dbManager.connect("localhost", "root", "", "worker_db");
-                dbManager.insertActivityData(userId, "screenshot_taken");
-                
-                statusMessage = "Screenshot taken and uploaded: " + screenshotPath;
-            }
-        }
-    });
+void MonitoringScreen::setStatus(const std::string& message, bool isError) {
+    statusMessage = message;
+    statusIsError = isError;
 }
 
-void MonitoringScreen::stopRandomScreenshotTimer() {
-    if (!timerRunning) return;
-    
-    timerRunning = false;
-    if (screenshotTimerThread.joinable()) {
-        screenshotTimerThread.join();
+void MonitoringScreen::applyStatusEvents() {
+    StatusEvent event;
+    while (session->getStatusChannel()->poll(event)) {
+        if (event.kind == StatusKind::Progress) {
+            progressText = event.text;
+            progress = event.progress < 0.0f ? 0.0f : event.progress;
+        } else {
+            // A final status ends whatever was in progress
+            setStatus(event.text, event.kind == StatusKind::Error);
+            progress = -1.0f;
+        }
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,332 @@
+#include "MonitoringSession.h"
+#include "TelemetrySampler.h"
+#include "FileUploader.h"
+#include "DatabaseManager.h"
+#include "LatencyHistogram.h"
+#include "JobQueue.h"
+
+#include <chrono>
+#include <iostream>
+#include <filesystem>
+#include <mutex>
+
+namespace {
+// Upload thumbnails first so the dashboard can list the screenshot before the full image arrives
+void uploadScreenshot(const std::string& user, const std::string& screenshotPath,
+                      const std::vector<std::string>& thumbnailPaths, StatusChannel& status) {
+    ScopedLatency timing(PipelineStage::Upload);
+    FileUploader uploader;
+    uploader.setServerCredentials("localhost", "root", "");
+
+    float total = static_cast<float>(thumbnailPaths.size() + 1);
+    for (size_t i = 0; i < thumbnailPaths.size(); i++) {
+        status.post(StatusKind::Progress, "Uploading thumbnails", i / total);
+        uploader.uploadFile(thumbnailPaths[i], "/screenshots/" + user + "/thumbnails/");
+    }
+    status.post(StatusKind::Progress, "Uploading screenshot", thumbnailPaths.size() / total);
+    uploader.uploadFile(screenshotPath, "/screenshots/" + user + "/");
+}
+
+// A screenshot's results, read before another job can use the same capture
+struct Screenshot {
+    std::string path;
+    std::vector<std::string> thumbnailPaths;
+    std::string duplicateOf;
+    uint64_t bytes = 0;
+};
+
+Screenshot grabScreenshot(ScreenCapture& capture, std::mutex& captureMutex, ScreenshotQuality quality,
+                          bool skipDuplicates) {
+    std::lock_guard<std::mutex> lock(captureMutex);
+    Screenshot screenshot;
+    screenshot.path = capture.captureScreen(quality, skipDuplicates);
+    screenshot.thumbnailPaths = capture.getLastThumbnailPaths();
+    screenshot.duplicateOf = capture.getLastDuplicateOf();
+    screenshot.bytes = capture.getScreenshotStats().lastBytes;
+    return screenshot;
+}
+
+// The periodic screenshot job: upload and log on a JobQueue worker
+void takePeriodicScreenshot(const std::string& user, const Screenshot& screenshot, StatusChannel& status) {
+    if (!screenshot.path.empty()) {
+        uploadScreenshot(user, screenshot.path, screenshot.thumbnailPaths, status);
+
+        // Record to database
+        DatabaseManager dbManager;
+        dbManager.connect("localhost", "root", "", "worker_db");
+        dbManager.insertActivityData(user, "screenshot_taken");
+
+        status.post(StatusKind::Info, "Screenshot taken and uploaded: " + screenshot.path);
+    } else if (!screenshot.duplicateOf.empty()) {
+        // Screen looks the same as a recent upload; log the tick without sending the image again
+        DatabaseManager dbManager;
+        dbManager.connect("localhost", "root", "", "worker_db");
+        dbManager.insertActivityData(user, "screenshot_unchanged");
+
+        status.post(StatusKind::Info, "Screen unchanged since " + screenshot.duplicateOf + ", upload skipped");
+    } else {
+        status.post(StatusKind::Error, "Periodic screenshot failed");
+    }
+}
+}
+
+MonitoringSession::MonitoringSession() : currentState(MonitoringState::STOPPED),
+    statusChannel(std::make_shared<StatusChannel>()), screenshotTask(0),
+    periodicJob(std::make_shared<PeriodicJob>()), jobs(std::make_shared<JobState>()),
+    telemetry(std::make_unique<TelemetrySampler>()) {
+    // Dashboard readings, refreshed once a second off the control thread
+    telemetry->start(std::chrono::seconds(1));
+}
+
+MonitoringSession::~MonitoringSession() {
+    telemetry->stop();
+
+    // No new periodic job once the trigger is gone; let one already submitted finish
+    Scheduler::shared().cancel(screenshotTask, true);
+    {
+        std::lock_guard<std::mutex> lock(periodicJob->mutex);
+        if (periodicJob->running.valid()) {
+            periodicJob->running.wait();
+        }
+    }
+
+    // A stop already started is still draining the encoder on a worker
+    if (jobs->recordingStopPending) {
+        recordingStop.wait();
+    } else if (jobs->recording) {
+        screenCapture->stopRecording();
+    }
+}
+
+void MonitoringSession::setUserId(const std::string& id) {
+    userId = id;
+}
+
+const std::string& MonitoringSession::getUserId() const {
+    return userId;
+}
+
+bool MonitoringSession::start() {
+    if (currentState != MonitoringState::STOPPED) {
+        return false;
+    }
+    currentState = MonitoringState::RUNNING;
+    statusChannel->post(StatusKind::Info, "Monitoring started...");
+
+    startRandomScreenshotTimer();
+
+    std::cout << "Monitoring started for user: " << userId << std::endl;
+    return true;
+}
+
+bool MonitoringSession::stop() {
+    if (currentState == MonitoringState::STOPPED) {
+        return false;
+    }
+    currentState = MonitoringState::STOPPED;
+    statusChannel->post(StatusKind::Info, "Monitoring stopped.");
+
+    stopRandomScreenshotTimer();
+
+    // Stop any ongoing recording
+    stopRecording();
+
+    std::cout << "Monitoring stopped for user: " << userId << std::endl;
+    return true;
+}
+
+bool MonitoringSession::pause() {
+    if (currentState != MonitoringState::RUNNING) {
+        return false;
+    }
+    currentState = MonitoringState::PAUSED;
+    statusChannel->post(StatusKind::Info, "Monitoring paused.");
+
+    // Keeps the time left until the next screenshot for resume
+    Scheduler::shared().pause(screenshotTask);
+    std::cout << "Monitoring paused for user: " << userId << std::endl;
+    return true;
+}
+
+bool MonitoringSession::resume() {
+    if (currentState != MonitoringState::PAUSED) {
+        return false;
+    }
+    currentState = MonitoringState::RUNNING;
+    statusChannel->post(StatusKind::Info, "Monitoring resumed.");
+
+    // Continue the paused screenshot countdown, or start one if there was none
+    if (!Scheduler::shared().resume(screenshotTask)) {
+        startRandomScreenshotTimer();
+    }
+
+    std::cout << "Monitoring resumed for user: " << userId << std::endl;
+    return true;
+}
+
+MonitoringState MonitoringSession::getState() const {
+    return currentState;
+}
+
+bool MonitoringSession::takeScreenshot() {
+    if (jobs->screenshotPending) {
+        return false;
+    }
+    jobs->screenshotPending = true;
+    ensureStillCapture();
+    std::string user = userId;
+    std::shared_ptr<StillCapture> still = stillCapture;
+    std::shared_ptr<StatusChannel> status = statusChannel;
+
+    // Grab, upload and DB insert run on a worker; progress and the result come back as status events
+    JobQueue::shared().submit([user, still, status]() {
+        // Asked for by the user, so always uploaded: only the periodic screenshots skip repeats
+        Screenshot screenshot = grabScreenshot(still->capture, still->mutex, ScreenshotQuality::High, false);
+        if (screenshot.path.empty()) {
+            status->post(StatusKind::Error, "Failed to take screenshot");
+            return;
+        }
+
+        uploadScreenshot(user, screenshot.path, screenshot.thumbnailPaths, *status);
+
+        // Record to database
+        DatabaseManager dbManager;
+        dbManager.connect("localhost", "root", "", "worker_db");
+        dbManager.insertActivityData(user, "manual_screenshot_taken");
+
+        status->post(StatusKind::Info, "Manual screenshot taken: " + screenshot.path + " (" +
+                     std::to_string(screenshot.bytes) + " bytes)");
+    }, [state = jobs]() {
+        state->screenshotPending = false;
+    });
+    return true;
+}
+
+bool MonitoringSession::isScreenshotPending() const {
+    return jobs->screenshotPending;
+}
+
+bool MonitoringSession::startRecording() {
+    if (jobs->recording || jobs->recordingStopPending) {
+        return false;
+    }
+    ensureRecordingCapture();
+
+    // Segments upload from the encoder's thread, so the callback gets its own copy of the user
+    std::string user = userId;
+    screenCapture->setSegmentCallback([user](const std::string& segmentPath) {
+        FileUploader uploader;
+        uploader.setServerCredentials("localhost", "root", "");
+        if (uploader.uploadFile(segmentPath, "/recordings/" + user + "/")) {
+            std::error_code error;
+            std::filesystem::remove(segmentPath, error);
+        }
+    });
+
+    // Only spawns the recording thread
+    std::string recordingPath = "recording_" + userId + ".mkv";
+    if (!screenCapture->startRecording(recordingPath)) {
+        statusChannel->post(StatusKind::Error, "Failed to start recording");
+        return false;
+    }
+    jobs->recording = true;
+    statusChannel->post(StatusKind::Info, "Started recording: " + recordingPath);
+    return true;
+}
+
+bool MonitoringSession::stopRecording() {
+    if (!jobs->recording || jobs->recordingStopPending) {
+        return false;
+    }
+
+    // Stopping drains the encoder and finalizes the file, which can take seconds
+    jobs->recordingStopPending = true;
+    std::shared_ptr<ScreenCapture> capture = screenCapture;
+    std::shared_ptr<StatusChannel> status = statusChannel;
+    recordingStop = JobQueue::shared().submit([capture]() { return capture->stopRecording(); },
+                                              [state = jobs, status](bool stopped) {
+        state->recordingStopPending = false;
+        state->recording = !stopped;
+        status->post(stopped ? StatusKind::Info : StatusKind::Error,
+                     stopped ? "Stopped recording" : "Failed to stop recording");
+    });
+    return true;
+}
+
+bool MonitoringSession::isRecording() const {
+    return jobs->recording;
+}
+
+bool MonitoringSession::isRecordingStopPending() const {
+    return jobs->recordingStopPending;
+}
+
+EncoderStats MonitoringSession::getRecordingStats() const {
+    return screenCapture ? screenCapture->getRecordingStats() : EncoderStats();
+}
+
+ScreenshotStats MonitoringSession::getPeriodicScreenshotStats() const {
+    return stillCapture ? stillCapture->capture.getScreenshotStats() : ScreenshotStats();
+}
+
+TelemetrySampler& MonitoringSession::getTelemetry() {
+    return *telemetry;
+}
+
+const std::shared_ptr<StatusChannel>& MonitoringSession::getStatusChannel() const {
+    return statusChannel;
+}
+
+void MonitoringSession::ensureStillCapture() {
+    if (stillCapture) {
+        return;
+    }
+    stillCapture = std::make_shared<StillCapture>();
+    // Screenshots only need to show what was on screen; keep the thumbnails small, and let the
+    // periodic ones skip repeats
+    stillCapture->capture.setThumbnailFactors({4, 8});
+    stillCapture->capture.setDuplicateDetection(true);
+}
+
+void MonitoringSession::ensureRecordingCapture() {
+    if (screenCapture) {
+        return;
+    }
+    screenCapture = std::make_shared<ScreenCapture>();
+    // Full rate while the user works, a trickle while idle, nothing while locked,
+    screenCapture->setAdaptiveFrameRate(true);
+    // and no grabs at all while nothing on screen changes
+    screenCapture->setChangeDrivenCapture(true);
+    // Ship recordings a minute at a time while recording continues, then free the local copy
+    screenCapture->setRecordingSegmentDuration(60);
+}
+
+void MonitoringSession::startRandomScreenshotTimer() {
+    if (Scheduler::shared().isScheduled(screenshotTask)) return;
+
+    // Random interval between 10-30 minutes. The scheduler thread only submits the job, so
+    // the grab, upload and database calls never hold up the other timers.
+    ensureStillCapture();
+    std::string user = userId;
+    std::shared_ptr<StillCapture> still = stillCapture;
+    std::shared_ptr<StatusChannel> status = statusChannel;
+    std::shared_ptr<PeriodicJob> job = periodicJob;
+    screenshotTask = Scheduler::shared().scheduleJittered(std::chrono::minutes(10), std::chrono::minutes(30),
+                                                          [user, still, status, job]() {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        // Skip a tick while the previous screenshot is still uploading
+        if (job->running.valid() && job->running.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return;
+        }
+        job->running = JobQueue::shared().submit([user, still, status]() {
+            takePeriodicScreenshot(user, grabScreenshot(still->capture, still->mutex, ScreenshotQuality::Low, true),
+                                   *status);
+        });
+    });
+}
+
+void MonitoringSession::stopRandomScreenshotTimer() {
+    // Waits only for a trigger in progress, which just submits; a submitted job finishes on its
+    // own with shared state
+    Scheduler::shared().cancel(screenshotTask, true);
+}
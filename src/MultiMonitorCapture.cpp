@@ -0,0 +1,428 @@
+#include "MultiMonitorCapture.h"
+
+#ifdef __linux__
+
+#include "X11ScreenGrabber.h"
+#include "X11ErrorHandler.h"
+#include "LatencyHistogram.h"
+#include "ThreadName.h"
+
+#include <X11/Xlib.h>
+#ifdef HAVE_XRANDR
+#include <X11/extensions/Xrandr.h>
+#endif
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+namespace {
+// A monitor with its own grabber and worker thread
+struct MonitorWorker {
+    MonitorInfo info;
+    X11ScreenGrabber grabber;
+    std::thread thread;
+    Frame frame;
+    bool ok = false;
+    uint64_t seenGeneration = 0;
+
+    // What the next grab refreshes: everything, or only these row bands (first row, count)
+    bool fullGrab = true;
+    bool hasFrame = false;
+    std::vector<std::pair<int, int>> bands;
+};
+
+// Monitor-local row bands covered by damage, sorted and merged
+std::vector<std::pair<int, int>> damagedBands(const MonitorInfo& monitor, const std::vector<DamageRect>& damage) {
+    std::vector<std::pair<int, int>> rows;
+    for (const auto& rect : damage) {
+        if (rect.x >= monitor.x + monitor.width || rect.x + rect.width <= monitor.x) {
+            continue;
+        }
+        int top = std::max(rect.y, monitor.y) - monitor.y;
+        int bottom = std::min(rect.y + rect.height, monitor.y + monitor.height) - monitor.y;
+        if (bottom > top) {
+            rows.emplace_back(top, bottom);
+        }
+    }
+    std::sort(rows.begin(), rows.end());
+
+    std::vector<std::pair<int, int>> bands;
+    for (const auto& row : rows) {
+        if (!bands.empty() && row.first <= bands.back().first + bands.back().second) {
+            int end = std::max(bands.back().first + bands.back().second, row.second);
+            bands.back().second = end - bands.back().first;
+        } else {
+            bands.emplace_back(row.first, row.second - row.first);
+        }
+    }
+    return bands;
+}
+}
+
+class MultiMonitorCapture::Impl {
+public:
+    std::string displayName;
+    bool hasDisplayName = false;
+
+    // Separate connection that only listens for layout changes
+    Display* eventDisplay = nullptr;
+    Window root = 0;
+    int randrEventBase = -1;
+    bool layoutChanged = false;
+
+    int width = 0;
+    int height = 0;
+    std::vector<std::unique_ptr<MonitorWorker>> workers;
+
+    std::mutex mutex;
+    std::condition_variable grabRequested;
+    std::condition_variable grabFinished;
+    uint64_t generation = 0;
+    size_t pending = 0;
+    bool stopping = false;
+
+    double lastLatencyMs = 0.0;
+    double totalLatencyMs = 0.0;
+    unsigned long long grabCount = 0;
+
+    const char* name() const {
+        return hasDisplayName ? displayName.c_str() : nullptr;
+    }
+
+    std::vector<MonitorInfo> enumerate() {
+        std::vector<MonitorInfo> monitors;
+
+        XWindowAttributes attributes;
+        XGetWindowAttributes(eventDisplay, root, &attributes);
+        width = attributes.width;
+        height = attributes.height;
+
+#ifdef HAVE_XRANDR
+        int major = 0;
+        int minor = 0;
+        if (randrEventBase >= 0 && XRRQueryVersion(eventDisplay, &major, &minor) &&
+            (major > 1 || (major == 1 && minor >= 5))) {
+            int count = 0;
+            XRRMonitorInfo* info = XRRGetMonitors(eventDisplay, root, True, &count);
+            for (int i = 0; i < count; i++) {
+                MonitorInfo monitor;
+                char* atomName = XGetAtomName(eventDisplay, info[i].name);
+                monitor.name = atomName ? atomName : "monitor" + std::to_string(i);
+                if (atomName) {
+                    XFree(atomName);
+                }
+                monitor.x = info[i].x;
+                monitor.y = info[i].y;
+                monitor.width = info[i].width;
+                monitor.height = info[i].height;
+                monitor.primary = info[i].primary;
+                monitors.push_back(monitor);
+            }
+            if (info) {
+                XRRFreeMonitors(info);
+            }
+        }
+#endif
+
+        // No XRandR (or no active outputs): treat the root window as a single monitor
+        if (monitors.empty()) {
+            MonitorInfo monitor;
+            monitor.name = "screen";
+            monitor.width = width;
+            monitor.height = height;
+            monitor.primary = true;
+            monitors.push_back(monitor);
+        }
+
+        return monitors;
+    }
+
+    void workerLoop(MonitorWorker* worker) {
+        setCurrentThreadName("rw-grab");
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            grabRequested.wait(lock, [&] { return stopping || worker->seenGeneration != generation; });
+            if (stopping) {
+                return;
+            }
+            worker->seenGeneration = generation;
+
+            lock.unlock();
+            bool ok = true;
+            if (worker->fullGrab || !worker->hasFrame) {
+                ok = worker->grabber.grab(worker->frame);
+            } else {
+                // Undamaged rows still hold the previous grab
+                for (const auto& band : worker->bands) {
+                    ok = worker->grabber.grabRows(band.first, band.second, worker->frame) && ok;
+                }
+            }
+            lock.lock();
+
+            worker->ok = ok;
+            worker->hasFrame = ok;
+            if (--pending == 0) {
+                grabFinished.notify_one();
+            }
+        }
+    }
+
+    void startWorkers(const std::vector<MonitorInfo>& monitors) {
+        for (const auto& monitor : monitors) {
+            auto worker = std::make_unique<MonitorWorker>();
+            worker->info = monitor;
+            if (!worker->grabber.open(name(), monitor.x, monitor.y, monitor.width, monitor.height)) {
+                std::cerr << "Failed to open capture for monitor " << monitor.name << std::endl;
+                continue;
+            }
+            workers.push_back(std::move(worker));
+        }
+
+        stopping = false;
+        generation = 0;
+        for (auto& worker : workers) {
+            worker->thread = std::thread(&Impl::workerLoop, this, worker.get());
+        }
+    }
+
+    // Run one grab on every worker with the modes already set on them
+    bool grab(std::vector<Frame>& frames);
+
+    void stopWorkers() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        grabRequested.notify_all();
+        for (auto& worker : workers) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        workers.clear();
+    }
+};
+
+MultiMonitorCapture::MultiMonitorCapture() : pImpl(std::make_unique<Impl>()) {}
+
+MultiMonitorCapture::~MultiMonitorCapture() {
+    close();
+}
+
+bool MultiMonitorCapture::open(const char* displayName) {
+    if (pImpl->eventDisplay) {
+        return true;
+    }
+
+    pImpl->hasDisplayName = displayName != nullptr;
+    pImpl->displayName = displayName ? displayName : "";
+
+    X11ErrorHandler::install();
+    pImpl->eventDisplay = XOpenDisplay(displayName);
+    if (!pImpl->eventDisplay) {
+        std::cerr << "Failed to open X display" << std::endl;
+        return false;
+    }
+
+    // Root resizes arrive as ConfigureNotify even without XRandR
+    pImpl->root = DefaultRootWindow(pImpl->eventDisplay);
+    XSelectInput(pImpl->eventDisplay, pImpl->root, StructureNotifyMask);
+
+#ifdef HAVE_XRANDR
+    int errorBase = 0;
+    if (XRRQueryExtension(pImpl->eventDisplay, &pImpl->randrEventBase, &errorBase)) {
+        XRRSelectInput(pImpl->eventDisplay, pImpl->root,
+                       RRScreenChangeNotifyMask | RRCrtcChangeNotifyMask | RROutputChangeNotifyMask);
+    } else {
+        pImpl->randrEventBase = -1;
+    }
+#endif
+
+    pImpl->startWorkers(pImpl->enumerate());
+    if (pImpl->workers.empty()) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MultiMonitorCapture::close() {
+    pImpl->stopWorkers();
+    if (pImpl->eventDisplay) {
+        X11ErrorHandler::forget(pImpl->eventDisplay);
+        XCloseDisplay(pImpl->eventDisplay);
+        pImpl->eventDisplay = nullptr;
+    }
+}
+
+bool MultiMonitorCapture::isOpen() const {
+    return pImpl->eventDisplay != nullptr && !pImpl->workers.empty();
+}
+
+bool MultiMonitorCapture::refreshIfChanged() {
+    if (!pImpl->eventDisplay) {
+        return false;
+    }
+
+    while (XPending(pImpl->eventDisplay)) {
+        XEvent event;
+        XNextEvent(pImpl->eventDisplay, &event);
+        if (event.type == ConfigureNotify) {
+            pImpl->layoutChanged = true;
+        }
+#ifdef HAVE_XRANDR
+        if (pImpl->randrEventBase >= 0 &&
+            (event.type == pImpl->randrEventBase + RRScreenChangeNotify ||
+             event.type == pImpl->randrEventBase + RRNotify)) {
+            XRRUpdateConfiguration(&event);
+            pImpl->layoutChanged = true;
+        }
+#endif
+    }
+
+    if (!pImpl->layoutChanged) {
+        return false;
+    }
+    pImpl->layoutChanged = false;
+
+    std::vector<MonitorInfo> monitors = pImpl->enumerate();
+    bool same = monitors.size() == pImpl->workers.size();
+    for (size_t i = 0; same && i < monitors.size(); i++) {
+        const MonitorInfo& current = pImpl->workers[i]->info;
+        same = current.x == monitors[i].x && current.y == monitors[i].y &&
+               current.width == monitors[i].width && current.height == monitors[i].height;
+    }
+    if (same) {
+        return false;
+    }
+
+    // Grabbers are sized per monitor, so rebuild them for the new layout
+    pImpl->stopWorkers();
+    pImpl->startWorkers(monitors);
+    std::cout << "Monitor layout changed: " << pImpl->workers.size() << " monitor(s), "
+              << pImpl->width << "x" << pImpl->height << std::endl;
+    return true;
+}
+
+std::vector<MonitorInfo> MultiMonitorCapture::getMonitors() const {
+    std::vector<MonitorInfo> monitors;
+    for (const auto& worker : pImpl->workers) {
+        monitors.push_back(worker->info);
+    }
+    return monitors;
+}
+
+int MultiMonitorCapture::getWidth() const {
+    return pImpl->width;
+}
+
+int MultiMonitorCapture::getHeight() const {
+    return pImpl->height;
+}
+
+bool MultiMonitorCapture::grabAll(std::vector<Frame>& frames) {
+    if (pImpl->workers.empty()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        for (auto& worker : pImpl->workers) {
+            worker->fullGrab = true;
+        }
+    }
+    return pImpl->grab(frames);
+}
+
+bool MultiMonitorCapture::grabDamaged(const std::vector<DamageRect>& damage, std::vector<Frame>& frames) {
+    if (pImpl->workers.empty()) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pImpl->mutex);
+        for (auto& worker : pImpl->workers) {
+            worker->fullGrab = false;
+            worker->bands = damagedBands(worker->info, damage);
+        }
+    }
+    return pImpl->grab(frames);
+}
+
+bool MultiMonitorCapture::Impl::grab(std::vector<Frame>& frames) {
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        generation++;
+        pending = workers.size();
+        grabRequested.notify_all();
+        grabFinished.wait(lock, [this] { return pending == 0; });
+
+        frames.resize(workers.size());
+        for (size_t i = 0; i < workers.size(); i++) {
+            ok = ok && workers[i]->ok;
+            frames[i] = workers[i]->frame;
+        }
+    }
+
+    PipelineLatency::stage(PipelineStage::Grab).recordSince(start);
+    lastLatencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    totalLatencyMs += lastLatencyMs;
+    grabCount++;
+    return ok;
+}
+
+void MultiMonitorCapture::stitch(const std::vector<Frame>& frames, uint8_t* canvas,
+                                 int canvasWidth, int canvasHeight, int canvasStride) const {
+    ScopedLatency timing(PipelineStage::Stitch);
+
+    // A single monitor filling the canvas leaves no gaps to clear
+    bool fullyCovered = frames.size() == 1 && pImpl->workers.size() == 1 &&
+                        pImpl->workers[0]->info.x == 0 && pImpl->workers[0]->info.y == 0 &&
+                        frames[0].width >= canvasWidth && frames[0].height >= canvasHeight;
+    if (!fullyCovered) {
+        for (int y = 0; y < canvasHeight; y++) {
+            std::memset(canvas + static_cast<size_t>(canvasStride) * y, 0, static_cast<size_t>(canvasWidth) * 4);
+        }
+    }
+
+    for (size_t i = 0; i < frames.size() && i < pImpl->workers.size(); i++) {
+        const Frame& frame = frames[i];
+        const MonitorInfo& monitor = pImpl->workers[i]->info;
+        if (!frame.data) {
+            continue;
+        }
+
+        int copyWidth = std::min(frame.width, canvasWidth - monitor.x);
+        int copyHeight = std::min(frame.height, canvasHeight - monitor.y);
+        if (copyWidth <= 0 || copyHeight <= 0) {
+            continue;
+        }
+
+        for (int y = 0; y < copyHeight; y++) {
+            std::memcpy(canvas + static_cast<size_t>(canvasStride) * (monitor.y + y) + static_cast<size_t>(monitor.x) * 4,
+                        frame.data + static_cast<size_t>(frame.stride) * y,
+                        static_cast<size_t>(copyWidth) * 4);
+        }
+    }
+}
+
+bool MultiMonitorCapture::isUsingSharedMemory() const {
+    return !pImpl->workers.empty() && pImpl->workers[0]->grabber.isUsingSharedMemory();
+}
+
+double MultiMonitorCapture::getLastGrabLatencyMs() const {
+    return pImpl->lastLatencyMs;
+}
+
+double MultiMonitorCapture::getAverageGrabLatencyMs() const {
+    return pImpl->grabCount ? pImpl->totalLatencyMs / pImpl->grabCount : 0.0;
+}
+
+#endif
@@ -117,30 +117,26 @@ NetworkUsage NetworkMonitor::getNetworkUsageLinux() {
     std::getline(file, line);
 
     while (std::getline(file, line)) {
+        // The name may run straight into the first counter ("eth0:123"), so split on the colon
+        size_t colon = line.find(':');
+        if (colon != std::string::npos) {
+            line[colon] = ' ';
+        }
         std::istringstream iss(line);
         std::string interface_name;
         iss >> interface_name;
 
-        // Remove the colon after interface name
-        if (interface_name.back() == ':') {
-            interface_name.pop_back();
-        }
-
         // Skip loopback interface
         if (interface_name == "lo") {
             continue;
         }
 
-        unsigned long long rx_bytes, tx_bytes;
-        // Skip interface name, then read rx bytes
-        for (int i = 0; i < 1; i++) {
-            std::string temp;
-            iss >> temp;
-        }
+        unsigned long long rx_bytes = 0, tx_bytes = 0;
+        // rx bytes is the first field after the interface name
         iss >> rx_bytes;
 
-        // Skip additional rx fields (packets, errs, etc.)
-        for (int i = 0; i < 6; i++) {
+        // Skip the remaining rx fields (packets, errs, drop, fifo, frame, compressed, multicast)
+        for (int i = 0; i < 7; i++) {
             std::string temp;
             iss >> temp;
         }
@@ -0,0 +1,65 @@
+#include "PerceptualHash.h"
+
+#include <cstddef>
+
+namespace {
+const int kGridWidth = 9;
+const int kGridHeight = 8;
+
+// Samples per block edge; a 1080p screen would otherwise touch every pixel for 64 bits of output
+const int kSamplesPerBlock = 16;
+}
+
+uint64_t PerceptualHash::dHash(const Frame& frame) {
+    if (!frame.data || frame.width < kGridWidth || frame.height < kGridHeight) {
+        return 0;
+    }
+
+    int bpp = frame.format == PixelFormat::BGRA ? 4 : 3;
+    int redOffset = frame.format == PixelFormat::RGB ? 0 : 2;
+    int blueOffset = 2 - redOffset;
+
+    uint32_t luma[kGridHeight][kGridWidth];
+    for (int gy = 0; gy < kGridHeight; gy++) {
+        int y0 = gy * frame.height / kGridHeight;
+        int y1 = (gy + 1) * frame.height / kGridHeight;
+        int stepY = (y1 - y0 + kSamplesPerBlock - 1) / kSamplesPerBlock;
+
+        for (int gx = 0; gx < kGridWidth; gx++) {
+            int x0 = gx * frame.width / kGridWidth;
+            int x1 = (gx + 1) * frame.width / kGridWidth;
+            int stepX = (x1 - x0 + kSamplesPerBlock - 1) / kSamplesPerBlock;
+
+            uint32_t sum = 0;
+            uint32_t count = 0;
+            for (int y = y0; y < y1; y += stepY) {
+                const uint8_t* row = frame.data + static_cast<size_t>(y) * frame.stride;
+                for (int x = x0; x < x1; x += stepX) {
+                    const uint8_t* px = row + x * bpp;
+                    // BT.601 luma in 8.8 fixed point
+                    sum += (px[redOffset] * 77 + px[1] * 150 + px[blueOffset] * 29) >> 8;
+                    count++;
+                }
+            }
+            luma[gy][gx] = count ? sum / count : 0;
+        }
+    }
+
+    uint64_t hash = 0;
+    for (int gy = 0; gy < kGridHeight; gy++) {
+        for (int gx = 0; gx < kGridWidth - 1; gx++) {
+            hash = (hash << 1) | (luma[gy][gx] > luma[gy][gx + 1] ? 1 : 0);
+        }
+    }
+    return hash;
+}
+
+int PerceptualHash::distance(uint64_t a, uint64_t b) {
+    uint64_t diff = a ^ b;
+    int bits = 0;
+    while (diff) {
+        diff &= diff - 1;
+        bits++;
+    }
+    return bits;
+}
@@ -0,0 +1,269 @@
+#include "PerfHud.h"
+#include "QueueMetrics.h"
+#include "LatencyHistogram.h"
+
+#include "imgui.h"
+
+#ifdef __linux__
+#include <dirent.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <fstream>
+#include <sstream>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+double toMegabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+#ifdef __linux__
+// utime + stime of one thread, in clock ticks; false if it exited meanwhile
+bool readThreadTicks(const std::string& taskDir, std::string& name, uint64_t& ticks) {
+    std::ifstream stat(taskDir + "/stat");
+    std::string line;
+    if (!std::getline(stat, line)) {
+        return false;
+    }
+
+    // The name is in parentheses and may contain spaces; fields after it are plain numbers
+    size_t open = line.find('(');
+    size_t close = line.rfind(')');
+    if (open == std::string::npos || close == std::string::npos || close < open) {
+        return false;
+    }
+    name = line.substr(open + 1, close - open - 1);
+
+    // After the name: state, then fields 4..13, then utime and stime (fields 14 and 15)
+    std::istringstream fields(line.substr(close + 2));
+    std::string skip;
+    for (int i = 0; i < 11; i++) {
+        fields >> skip;
+    }
+    uint64_t userTicks = 0;
+    uint64_t systemTicks = 0;
+    fields >> userTicks >> systemTicks;
+    ticks = userTicks + systemTicks;
+    return static_cast<bool>(fields);
+}
+#endif
+}
+
+PerfHud::PerfHud()
+    : visible(false), firstSampleTask(0), samplerTask(0), sample(std::make_shared<ProcessSample>()), lastSampleNs(0),
+      frameIndex(0), framesRecorded(0), vertexCount(0), indexCount(0), drawListCount(0) {
+    std::fill(frameMs, frameMs + kFrameHistory, 0.0f);
+    std::fill(swapMs, swapMs + kFrameHistory, 0.0f);
+}
+
+PerfHud::~PerfHud() {
+    // The tasks use this object
+    Scheduler::shared().cancel(firstSampleTask, true);
+    Scheduler::shared().cancel(samplerTask, true);
+}
+
+void PerfHud::toggle() {
+    visible = !visible;
+    if (visible) {
+        // A sample from the last time the window was open may still be finishing
+        Scheduler::shared().cancel(firstSampleTask, true);
+        Scheduler::shared().cancel(samplerTask, true);
+
+        // Fresh baseline, so the first figures cover only the time the window has been open
+        lastThreadTicks.clear();
+        lastSampleNs = 0;
+        firstSampleTask = Scheduler::shared().scheduleOnce(std::chrono::milliseconds(0), [this]() { sampleProcess(); });
+        samplerTask = Scheduler::shared().schedulePeriodic(std::chrono::seconds(1), [this]() { sampleProcess(); });
+    } else {
+        Scheduler::shared().cancel(firstSampleTask);
+        Scheduler::shared().cancel(samplerTask);
+    }
+}
+
+bool PerfHud::isVisible() const {
+    return visible;
+}
+
+void PerfHud::recordFrame(double cpuMs, double swapMsValue, const ImDrawData* drawData) {
+    frameMs[frameIndex] = static_cast<float>(cpuMs);
+    swapMs[frameIndex] = static_cast<float>(swapMsValue);
+    frameIndex = (frameIndex + 1) % kFrameHistory;
+    framesRecorded = std::min(framesRecorded + 1, kFrameHistory);
+
+    if (drawData) {
+        vertexCount = drawData->TotalVtxCount;
+        indexCount = drawData->TotalIdxCount;
+        drawListCount = drawData->CmdListsCount;
+    }
+}
+
+void PerfHud::sampleProcess() {
+    auto next = std::make_shared<ProcessSample>();
+    int64_t nowNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+#ifdef __linux__
+    double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+    double elapsedSeconds = lastSampleNs > 0 ? (nowNs - lastSampleNs) / 1e9 : 0.0;
+
+    std::map<int, uint64_t> ticksNow;
+    if (DIR* tasks = opendir("/proc/self/task")) {
+        while (dirent* entry = readdir(tasks)) {
+            int id = std::atoi(entry->d_name);
+            std::string name;
+            uint64_t ticks = 0;
+            if (id <= 0 || !readThreadTicks(std::string("/proc/self/task/") + entry->d_name, name, ticks)) {
+                continue;
+            }
+            ticksNow[id] = ticks;
+
+            // Threads first seen now have no interval yet
+            auto previous = lastThreadTicks.find(id);
+            double percent = 0.0;
+            if (previous != lastThreadTicks.end() && elapsedSeconds > 0.0 && ticks >= previous->second) {
+                percent = 100.0 * (ticks - previous->second) / ticksPerSecond / elapsedSeconds;
+            }
+            next->threads.push_back({id, name, percent});
+        }
+        closedir(tasks);
+    }
+    lastThreadTicks.swap(ticksNow);
+
+    std::sort(next->threads.begin(), next->threads.end(), [](const ThreadUsage& a, const ThreadUsage& b) {
+        return a.cpuPercent != b.cpuPercent ? a.cpuPercent > b.cpuPercent : a.id < b.id;
+    });
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 heap = mallinfo2();
+    next->heapKnown = true;
+    next->heapBytes = heap.arena + heap.hblkhd;
+    next->heapInUse = heap.uordblks + heap.hblkhd;
+    next->heapFree = heap.fordblks;
+    next->mappedBytes = heap.hblkhd;
+#endif
+#endif
+
+    lastSampleNs = nowNs;
+    std::atomic_store_explicit(&sample, std::shared_ptr<const ProcessSample>(std::move(next)),
+                               std::memory_order_release);
+}
+
+void PerfHud::render() {
+    if (!visible) {
+        return;
+    }
+
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f), ImGuiCond_FirstUseEver);
+    ImGui::SetNextWindowSize(ImVec2(420.0f, 0.0f), ImGuiCond_FirstUseEver);
+    bool open = true;
+    if (!ImGui::Begin("Performance (F12)", &open)) {
+        ImGui::End();
+        if (!open) {
+            toggle();
+        }
+        return;
+    }
+
+    // Frames are only drawn on demand, so these cover recent frames rather than a fixed rate
+    if (framesRecorded > 0) {
+        int offset = framesRecorded < kFrameHistory ? 0 : frameIndex;
+        int newest = (frameIndex + kFrameHistory - 1) % kFrameHistory;
+        float worstFrame = *std::max_element(frameMs, frameMs + framesRecorded);
+        float worstSwap = *std::max_element(swapMs, swapMs + framesRecorded);
+
+        char overlay[64];
+        snprintf(overlay, sizeof(overlay), "CPU %.2f ms (max %.2f)", frameMs[newest], worstFrame);
+        ImGui::PlotLines("##frame", frameMs, framesRecorded, offset, overlay, 0.0f,
+                         std::max(worstFrame * 1.2f, 1.0f), ImVec2(-1.0f, 40.0f));
+        snprintf(overlay, sizeof(overlay), "Swap %.2f ms (max %.2f, incl. vsync)", swapMs[newest], worstSwap);
+        ImGui::PlotLines("##swap", swapMs, framesRecorded, offset, overlay, 0.0f,
+                         std::max(worstSwap * 1.2f, 1.0f), ImVec2(-1.0f, 40.0f));
+        ImGui::Text("ImGui: %d vertices, %d indices, %d draw lists", vertexCount, indexCount, drawListCount);
+    }
+
+    std::shared_ptr<const ProcessSample> current = std::atomic_load_explicit(&sample, std::memory_order_acquire);
+
+    if (ImGui::CollapsingHeader("Threads", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (current->threads.empty()) {
+            ImGui::TextUnformatted("Not available on this platform");
+        } else if (ImGui::BeginTable("threads", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Thread");
+            ImGui::TableSetupColumn("TID");
+            ImGui::TableSetupColumn("CPU %");
+            ImGui::TableHeadersRow();
+            for (const ThreadUsage& thread : current->threads) {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(thread.name.c_str());
+                ImGui::TableNextColumn();
+                ImGui::Text("%d", thread.id);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", thread.cpuPercent);
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Heap", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (current->heapKnown) {
+            ImGui::Text("%.1f MB from system, %.1f MB in use, %.1f MB free in arenas, %.1f MB mmapped",
+                        toMegabytes(current->heapBytes), toMegabytes(current->heapInUse),
+                        toMegabytes(current->heapFree), toMegabytes(current->mappedBytes));
+        } else {
+            ImGui::TextUnformatted("Not available with this allocator");
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Queues", ImGuiTreeNodeFlags_DefaultOpen)) {
+        if (ImGui::BeginTable("queues", 6, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            const char* columns[6] = {"Queue", "Depth", "Peak", "Dropped", "Wait p50 ms", "Wait p99 ms"};
+            for (const char* column : columns) {
+                ImGui::TableSetupColumn(column);
+            }
+            ImGui::TableHeadersRow();
+            for (int i = 0; i < static_cast<int>(BackgroundQueue::Count); i++) {
+                BackgroundQueue queue = static_cast<BackgroundQueue>(i);
+                const QueueCounters& counters = QueueMetrics::queue(queue);
+                LatencySummary wait = counters.getWait().summary();
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::TextUnformatted(QueueMetrics::queueName(queue));
+                ImGui::TableNextColumn();
+                ImGui::Text("%lld", static_cast<long long>(counters.getDepth()));
+                ImGui::TableNextColumn();
+                ImGui::Text("%lld", static_cast<long long>(counters.getPeakDepth()));
+                ImGui::TableNextColumn();
+                ImGui::Text("%llu", static_cast<unsigned long long>(counters.getDroppedCount()));
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", wait.p50Ms);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.2f", wait.p99Ms);
+            }
+            ImGui::EndTable();
+        }
+
+        // Time spent on an item once it leaves the queue
+        const PipelineStage stages[3] = {PipelineStage::VideoEncode, PipelineStage::Upload, PipelineStage::Database};
+        for (PipelineStage stage : stages) {
+            LatencySummary service = PipelineLatency::stage(stage).summary();
+            ImGui::Text("%s: p50 %.2f ms, p99 %.2f ms (%llu)", PipelineLatency::stageName(stage), service.p50Ms,
+                        service.p99Ms, static_cast<unsigned long long>(service.count));
+        }
+        if (ImGui::Button("Reset")) {
+            for (int i = 0; i < static_cast<int>(BackgroundQueue::Count); i++) {
+                QueueMetrics::queue(static_cast<BackgroundQueue>(i)).reset();
+            }
+        }
+    }
+
+    ImGui::End();
+    if (!open) {
+        toggle();
+    }
+}
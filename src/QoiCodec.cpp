@@ -0,0 +1,201 @@
+#include "QoiCodec.h"
+
+#include <cstring>
+#include <iostream>
+
+namespace {
+const uint8_t kOpIndex = 0x00;
+const uint8_t kOpDiff = 0x40;
+const uint8_t kOpLuma = 0x80;
+const uint8_t kOpRun = 0xC0;
+const uint8_t kOpRgb = 0xFE;
+const uint8_t kOpRgba = 0xFF;
+const uint8_t kMask2 = 0xC0;
+const int kHeaderSize = 14;
+const uint8_t kEndMarker[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+
+struct Rgba {
+    uint8_t r, g, b, a;
+
+    bool operator==(const Rgba& other) const {
+        return r == other.r && g == other.g && b == other.b && a == other.a;
+    }
+};
+
+inline int colorHash(const Rgba& c) {
+    return (c.r * 3 + c.g * 5 + c.b * 7 + c.a * 11) % 64;
+}
+
+void write32BE(uint8_t* out, uint32_t value) {
+    out[0] = (value >> 24) & 0xFF;
+    out[1] = (value >> 16) & 0xFF;
+    out[2] = (value >> 8) & 0xFF;
+    out[3] = value & 0xFF;
+}
+
+uint32_t read32BE(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | in[3];
+}
+}
+
+bool QoiCodec::encode(const Frame& frame, std::vector<uint8_t>& output) {
+    if (!frame.data || frame.width <= 0 || frame.height <= 0) {
+        return false;
+    }
+
+    int bpp = frame.format == PixelFormat::BGRA ? 4 : 3;
+    int redOffset = frame.format == PixelFormat::RGB ? 0 : 2;
+    int blueOffset = 2 - redOffset;
+
+    // Worst case: every pixel is an RGB op
+    size_t pixelCount = static_cast<size_t>(frame.width) * frame.height;
+    output.resize(kHeaderSize + pixelCount * 4 + sizeof(kEndMarker));
+    uint8_t* out = output.data();
+
+    std::memcpy(out, "qoif", 4);
+    write32BE(out + 4, frame.width);
+    write32BE(out + 8, frame.height);
+    out[12] = 3; // Channels
+    out[13] = 0; // sRGB with linear alpha
+    size_t pos = kHeaderSize;
+
+    Rgba index[64];
+    std::memset(index, 0, sizeof(index));
+    Rgba previous = {0, 0, 0, 255};
+    int run = 0;
+
+    for (int y = 0; y < frame.height; y++) {
+        const uint8_t* row = frame.data + static_cast<size_t>(y) * frame.stride;
+
+        for (int x = 0; x < frame.width; x++) {
+            const uint8_t* px = row + x * bpp;
+            Rgba current = {px[redOffset], px[1], px[blueOffset], 255};
+
+            if (current == previous) {
+                run++;
+                if (run == 62) {
+                    out[pos++] = kOpRun | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+
+            if (run > 0) {
+                out[pos++] = kOpRun | (run - 1);
+                run = 0;
+            }
+
+            int hash = colorHash(current);
+            if (index[hash] == current) {
+                out[pos++] = kOpIndex | hash;
+            } else {
+                index[hash] = current;
+
+                int8_t dr = static_cast<int8_t>(current.r - previous.r);
+                int8_t dg = static_cast<int8_t>(current.g - previous.g);
+                int8_t db = static_cast<int8_t>(current.b - previous.b);
+                int8_t drdg = static_cast<int8_t>(dr - dg);
+                int8_t dbdg = static_cast<int8_t>(db - dg);
+
+                if (dr > -3 && dr < 2 && dg > -3 && dg < 2 && db > -3 && db < 2) {
+                    out[pos++] = kOpDiff | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+                } else if (drdg > -9 && drdg < 8 && dg > -33 && dg < 32 && dbdg > -9 && dbdg < 8) {
+                    out[pos++] = kOpLuma | (dg + 32);
+                    out[pos++] = ((drdg + 8) << 4) | (dbdg + 8);
+                } else {
+                    out[pos++] = kOpRgb;
+                    out[pos++] = current.r;
+                    out[pos++] = current.g;
+                    out[pos++] = current.b;
+                }
+            }
+
+            previous = current;
+        }
+    }
+
+    if (run > 0) {
+        out[pos++] = kOpRun | (run - 1);
+    }
+
+    std::memcpy(out + pos, kEndMarker, sizeof(kEndMarker));
+    pos += sizeof(kEndMarker);
+    output.resize(pos);
+    return true;
+}
+
+bool QoiCodec::decode(const uint8_t* data, size_t size, std::vector<uint8_t>& rgbPixels, int& width, int& height) {
+    if (size < kHeaderSize + sizeof(kEndMarker) || std::memcmp(data, "qoif", 4) != 0) {
+        std::cerr << "Not a QOI file" << std::endl;
+        return false;
+    }
+
+    uint32_t w = read32BE(data + 4);
+    uint32_t h = read32BE(data + 8);
+    int channels = data[12];
+    if (w == 0 || h == 0 || (channels != 3 && channels != 4) || static_cast<uint64_t>(w) * h > 400000000ull) {
+        std::cerr << "Invalid QOI header" << std::endl;
+        return false;
+    }
+
+    width = static_cast<int>(w);
+    height = static_cast<int>(h);
+    size_t pixelCount = static_cast<size_t>(w) * h;
+    rgbPixels.resize(pixelCount * 3);
+
+    Rgba index[64];
+    std::memset(index, 0, sizeof(index));
+    Rgba px = {0, 0, 0, 255};
+    int run = 0;
+
+    size_t pos = kHeaderSize;
+    size_t chunksEnd = size - sizeof(kEndMarker);
+
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (run > 0) {
+            run--;
+        } else if (pos < chunksEnd) {
+            uint8_t b1 = data[pos++];
+
+            if (b1 == kOpRgb) {
+                if (pos + 3 > chunksEnd) return false;
+                px.r = data[pos++];
+                px.g = data[pos++];
+                px.b = data[pos++];
+            } else if (b1 == kOpRgba) {
+                if (pos + 4 > chunksEnd) return false;
+                px.r = data[pos++];
+                px.g = data[pos++];
+                px.b = data[pos++];
+                px.a = data[pos++];
+            } else if ((b1 & kMask2) == kOpIndex) {
+                px = index[b1];
+            } else if ((b1 & kMask2) == kOpDiff) {
+                px.r += ((b1 >> 4) & 0x03) - 2;
+                px.g += ((b1 >> 2) & 0x03) - 2;
+                px.b += (b1 & 0x03) - 2;
+            } else if ((b1 & kMask2) == kOpLuma) {
+                if (pos + 1 > chunksEnd) return false;
+                uint8_t b2 = data[pos++];
+                int vg = (b1 & 0x3F) - 32;
+                px.r += vg - 8 + ((b2 >> 4) & 0x0F);
+                px.g += vg;
+                px.b += vg - 8 + (b2 & 0x0F);
+            } else {
+                run = b1 & 0x3F;
+            }
+
+            index[colorHash(px)] = px;
+        } else {
+            std::cerr << "Truncated QOI data" << std::endl;
+            return false;
+        }
+
+        rgbPixels[i * 3] = px.r;
+        rgbPixels[i * 3 + 1] = px.g;
+        rgbPixels[i * 3 + 2] = px.b;
+    }
+
+    return true;
+}
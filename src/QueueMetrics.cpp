@@ -0,0 +1,57 @@
+#include "QueueMetrics.h"
+
+QueueCounters::QueueCounters() : depth(0), peakDepth(0), droppedCount(0) {}
+
+void QueueCounters::pushed() {
+    int64_t current = depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    int64_t peak = peakDepth.load(std::memory_order_relaxed);
+    while (current > peak && !peakDepth.compare_exchange_weak(peak, current, std::memory_order_relaxed)) {
+    }
+}
+
+void QueueCounters::popped(std::chrono::steady_clock::time_point queuedAt) {
+    depth.fetch_sub(1, std::memory_order_relaxed);
+    wait.recordSince(queuedAt);
+}
+
+void QueueCounters::dropped() {
+    droppedCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+int64_t QueueCounters::getDepth() const {
+    return depth.load(std::memory_order_relaxed);
+}
+
+int64_t QueueCounters::getPeakDepth() const {
+    return peakDepth.load(std::memory_order_relaxed);
+}
+
+uint64_t QueueCounters::getDroppedCount() const {
+    return droppedCount.load(std::memory_order_relaxed);
+}
+
+const LatencyHistogram& QueueCounters::getWait() const {
+    return wait;
+}
+
+// Depth is live state, so only the history is cleared
+void QueueCounters::reset() {
+    peakDepth.store(depth.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    droppedCount.store(0, std::memory_order_relaxed);
+    wait.reset();
+}
+
+QueueCounters& QueueMetrics::queue(BackgroundQueue queue) {
+    static QueueCounters counters[static_cast<int>(BackgroundQueue::Count)];
+    return counters[static_cast<int>(queue)];
+}
+
+const char* QueueMetrics::queueName(BackgroundQueue queue) {
+    switch (queue) {
+        case BackgroundQueue::Frames: return "capture -> encode";
+        case BackgroundQueue::Segments: return "segment upload";
+        case BackgroundQueue::Jobs: return "jobs (upload, DB)";
+        case BackgroundQueue::Count: break;
+    }
+    return "unknown";
+}
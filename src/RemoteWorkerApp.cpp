@@ -1,8 +1,12 @@
 #include "RemoteWorkerApp.h"
 #include "LoginScreen.h"
 #include "MonitoringScreen.h"
+#include "PerfHud.h"
+#include "JobQueue.h"
+#include "UiNotifier.h"
 
 #include "imgui.h"
+#include "imgui_internal.h"
 #include "backends/imgui_impl_glfw.h"
 #include "backends/imgui_impl_opengl3.h"
 
@@ -17,6 +21,8 @@
 #endif
 
 #include <iostream>
+#include <algorithm>
+#include <chrono>
 
 // Include tray library if available
 #ifndef NO_TRAY_LIBRARY
@@ -25,6 +31,21 @@
 #endif
 #endif
 
+namespace {
+// With nothing going on, redraw this often so sampled readings (telemetry, charts) stay current
+const double kRefreshIntervalSeconds = 1.0;
+// While a text field has focus, often enough for the cursor to blink
+const double kTextInputRefreshSeconds = 0.5;
+// After input ImGui needs a couple more frames for hover, focus and layout to settle
+const int kFramesAfterInput = 3;
+
+// Input the GLFW backend queued for ImGui during the last event wait
+bool hasQueuedInput() {
+    ImGuiContext* context = ImGui::GetCurrentContext();
+    return context && context->InputEventsQueue.Size > 0;
+}
+}
+
 RemoteWorkerApp::RemoteWorkerApp() : window(nullptr), currentState(AppState::LOGIN) {
 #ifndef NO_TRAY_LIBRARY
 #ifdef USE_TRAY_LIBRARY
@@ -49,6 +70,9 @@ void RemoteWorkerApp::initialize() {
         return;
     }
 
+    // Background threads wake the event wait in run() when they have something to show
+    UiNotifier::setHandler([]() { glfwPostEmptyEvent(); });
+
     // Decide GL+GLSL versions
 #ifdef __APPLE__
     // GL 3.2 + GLSL 150
@@ -88,6 +112,7 @@ void RemoteWorkerApp::initialize() {
     // Initialize screens
     loginScreen = std::make_unique<::LoginScreen>();
     monitoringScreen = std::make_unique<::MonitoringScreen>();
+    perfHud = std::make_unique<PerfHud>();
 
 #ifndef NO_TRAY_LIBRARY
 #ifdef USE_TRAY_LIBRARY
@@ -143,6 +168,11 @@ void RemoteWorkerApp::setupSystemTray() {
 #endif
 
 void RemoteWorkerApp::render() {
+    auto frameStart = std::chrono::steady_clock::now();
+
+    // Results of background jobs are applied here, on the UI thread, before anything is drawn
+    JobQueue::shared().runCompletions();
+
     // Start the Dear ImGui frame
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
@@ -161,6 +191,11 @@ void RemoteWorkerApp::render() {
             break;
     }
 
+    if (ImGui::IsKeyPressed(ImGuiKey_F12, false)) {
+        perfHud->toggle();
+    }
+    perfHud->render();
+
     // Rendering
     ImGui::Render();
     int display_w, display_h;
@@ -170,7 +205,15 @@ void RemoteWorkerApp::render() {
     glClear(GL_COLOR_BUFFER_BIT);
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
+    auto swapStart = std::chrono::steady_clock::now();
     glfwSwapBuffers(window);
+
+    if (perfHud->isVisible()) {
+        auto swapEnd = std::chrono::steady_clock::now();
+        perfHud->recordFrame(std::chrono::duration<double, std::milli>(swapStart - frameStart).count(),
+                             std::chrono::duration<double, std::milli>(swapEnd - swapStart).count(),
+                             ImGui::GetDrawData());
+    }
 }
 
 void RemoteWorkerApp::cleanup() {
@@ -179,6 +222,7 @@ void RemoteWorkerApp::cleanup() {
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
 
+    UiNotifier::setHandler(nullptr);
     glfwDestroyWindow(window);
     glfwTerminate();
 }
@@ -187,15 +231,38 @@ void RemoteWorkerApp::cleanup() {
 void RemoteWorkerApp::run() {
     std::cout << "Remote Worker App starting..." << std::endl;
 
-    // Main loop
+    // Main loop. Frames are drawn on demand: after input, when a background thread posts a
+    // state change (UiNotifier), and on a slow refresh tick; otherwise the thread sleeps.
+    int framesToRender = 1;
     while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        // Handle window minimized
+        // Minimized or hidden: nothing to draw, so block until the next event
         int width, height;
         glfwGetWindowSize(window, &width, &height);
-        if (width > 0 && height > 0) {
-            render();
+        if (glfwGetWindowAttrib(window, GLFW_ICONIFIED) || !glfwGetWindowAttrib(window, GLFW_VISIBLE) ||
+            width <= 0 || height <= 0) {
+            glfwWaitEvents();
+            // Finished background jobs and their status events are still applied, so the ring
+            // doesn't fill up while hidden and the latest status shows once visible again
+            UiNotifier::takeRequest();
+            JobQueue::shared().runCompletions();
+            monitoringScreen->applyStatusEvents();
+            framesToRender = 1;
+            continue;
+        }
+
+        if (framesToRender > 0) {
+            glfwPollEvents();
+        } else {
+            glfwWaitEventsTimeout(ImGui::GetIO().WantTextInput ? kTextInputRefreshSeconds : kRefreshIntervalSeconds);
         }
+
+        if (hasQueuedInput()) {
+            framesToRender = std::max(framesToRender, kFramesAfterInput);
+        }
+        // Cleared before drawing so a change posted during this frame wakes the next wait
+        UiNotifier::takeRequest();
+
+        render();
+        framesToRender = std::max(framesToRender - 1, 0);
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,226 @@
+#include "RemoteWorkerDaemon.h"
+#include "MonitoringSession.h"
+#include "TelemetrySampler.h"
+#include "DatabaseManager.h"
+#include "JobQueue.h"
+#include "UiNotifier.h"
+
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <iostream>
+#include <sstream>
+
+namespace {
+// Reached from the signal handler and from background threads via UiNotifier
+std::atomic<ControlSocket*> activeControl(nullptr);
+volatile std::sig_atomic_t stopSignalled = 0;
+
+void wakeControlLoop() {
+    ControlSocket* control = activeControl.load();
+    if (control) {
+        control->wake();
+    }
+}
+
+void handleStopSignal(int) {
+    stopSignalled = 1;
+    wakeControlLoop();
+}
+
+const char* stateName(MonitoringState state) {
+    switch (state) {
+        case MonitoringState::RUNNING: return "running";
+        case MonitoringState::PAUSED: return "paused";
+        default: return "stopped";
+    }
+}
+
+const char* kHelp = "ok commands: login <user-id>, start, stop, pause, resume, screenshot, "
+                    "record start, record stop, status, quit";
+}
+
+RemoteWorkerDaemon::RemoteWorkerDaemon(const Options& options)
+    : options(options), loginPending(false), quitRequested(false), lastStatusIsError(false) {}
+
+RemoteWorkerDaemon::~RemoteWorkerDaemon() = default;
+
+int RemoteWorkerDaemon::run() {
+    if (!control.open(options.socketPath)) {
+        return 1;
+    }
+    std::cout << "Remote Worker daemon listening on " << options.socketPath << std::endl;
+
+    activeControl.store(&control);
+    // Finished jobs and status posts wake the loop the same way they wake the GUI
+    UiNotifier::setHandler(wakeControlLoop);
+    std::signal(SIGINT, handleStopSignal);
+    std::signal(SIGTERM, handleStopSignal);
+    // A client hanging up mid-reply must not kill the agent
+    std::signal(SIGPIPE, SIG_IGN);
+
+    if (!options.userId.empty()) {
+        login(0, options.userId);
+    }
+
+    while (!quitRequested && !stopSignalled) {
+        // Everything the loop reacts to arrives as a command or a wakeup; no polling interval
+        control.poll(-1, [this](int client, const std::string& line) { handleCommand(client, line); });
+
+        UiNotifier::takeRequest();
+        JobQueue::shared().runCompletions();
+        applyStatusEvents();
+    }
+
+    std::cout << "Remote Worker daemon shutting down" << std::endl;
+    if (session) {
+        session->stop();
+        // Waits for a recording stop to finish writing the file
+        session.reset();
+    }
+
+    UiNotifier::setHandler(nullptr);
+    activeControl.store(nullptr);
+    control.close();
+    return 0;
+}
+
+void RemoteWorkerDaemon::handleCommand(int client, const std::string& line) {
+    std::istringstream words(line);
+    std::string command;
+    std::string argument;
+    words >> command >> argument;
+
+    if (command.empty()) {
+        return;
+    }
+    if (command == "help") {
+        control.reply(client, kHelp);
+        return;
+    }
+    if (command == "status") {
+        control.reply(client, describeStatus());
+        return;
+    }
+    if (command == "quit") {
+        quitRequested = true;
+        control.reply(client, "ok shutting down");
+        return;
+    }
+    if (command == "login") {
+        if (argument.empty()) {
+            control.reply(client, "error usage: login <user-id>");
+        } else if (session || loginPending) {
+            control.reply(client, "error already logged in");
+        } else {
+            login(client, argument);
+        }
+        return;
+    }
+
+    // Everything else needs a logged-in session
+    if (!session) {
+        control.reply(client, "error not logged in");
+        return;
+    }
+
+    bool done;
+    std::string result;
+    if (command == "start") {
+        done = session->start();
+    } else if (command == "stop") {
+        done = session->stop();
+    } else if (command == "pause") {
+        done = session->pause();
+    } else if (command == "resume") {
+        done = session->resume();
+    } else if (command == "screenshot") {
+        done = session->takeScreenshot();
+        result = done ? "screenshot started" : "a screenshot is already being taken";
+    } else if (command == "record" && argument == "start") {
+        done = session->startRecording();
+        result = done ? "recording" : "recording could not be started";
+    } else if (command == "record" && argument == "stop") {
+        done = session->stopRecording();
+        result = done ? "stopping recording" : "not recording";
+    } else {
+        control.reply(client, "error unknown command: " + line);
+        return;
+    }
+
+    // State changes answer with the new state; background results show up in "status" once they finish
+    if (result.empty()) {
+        result = done ? stateName(session->getState())
+                      : std::string("not possible while ") + stateName(session->getState());
+    }
+    control.reply(client, (done ? "ok " : "error ") + result);
+}
+
+// client 0 is the command-line login, which has nobody to reply to
+void RemoteWorkerDaemon::login(int client, const std::string& userId) {
+    loginPending = true;
+    JobQueue::shared().submit([userId]() {
+        DatabaseManager dbManager;
+        if (!dbManager.connect("localhost", "root", "", "worker_db")) {
+            return std::string("Cannot connect to server");
+        }
+        return dbManager.validateUser(userId) ? std::string() : std::string("Invalid User ID");
+    }, [this, client, userId](const std::string& error) {
+        loginPending = false;
+        if (!error.empty()) {
+            std::cerr << "Login failed for " << userId << ": " << error << std::endl;
+            control.reply(client, "error " + error);
+            return;
+        }
+
+        session = std::make_unique<MonitoringSession>();
+        session->setUserId(userId);
+        if (client == 0 && options.startMonitoring) {
+            session->start();
+        }
+        std::cout << "Logged in as " << userId << std::endl;
+        control.reply(client, "ok logged in as " + userId);
+    });
+}
+
+void RemoteWorkerDaemon::applyStatusEvents() {
+    if (!session) {
+        return;
+    }
+
+    // Progress is only worth a log line when it completes; keep the final statuses
+    StatusEvent event;
+    while (session->getStatusChannel()->poll(event)) {
+        if (event.kind == StatusKind::Progress) {
+            continue;
+        }
+        lastStatus = event.text;
+        lastStatusIsError = event.kind == StatusKind::Error;
+        (lastStatusIsError ? std::cerr : std::cout) << event.text << std::endl;
+    }
+}
+
+std::string RemoteWorkerDaemon::describeStatus() const {
+    if (!session) {
+        return loginPending ? "ok logging in" : "ok not logged in";
+    }
+
+    std::ostringstream reply;
+    reply << "ok user=" << session->getUserId() << " state=" << stateName(session->getState())
+          << " recording=" << (session->isRecording() ? "yes" : "no")
+          << " screenshot=" << (session->isScreenshotPending() ? "pending" : "idle");
+
+    std::shared_ptr<const TelemetrySnapshot> sample = session->getTelemetry().latest();
+    if (sample->sequence > 0) {
+        char figures[160];
+        std::snprintf(figures, sizeof(figures), " cpu=%.1f%% rss=%.1fMB sent=%.0fB/s received=%.0fB/s idle=%llds",
+                      sample->processCpuPercent, sample->residentBytes / (1024.0 * 1024.0),
+                      sample->sendBytesPerSecond, sample->receiveBytesPerSecond,
+                      static_cast<long long>(sample->idleMs / 1000));
+        reply << figures;
+    }
+    if (!lastStatus.empty()) {
+        reply << (lastStatusIsError ? " error=\"" : " last=\"") << lastStatus << "\"";
+    }
+    return reply.str();
+}
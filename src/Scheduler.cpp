@@ -0,0 +1,198 @@
+#include "Scheduler.h"
+#include "ThreadName.h"
+
+#include <algorithm>
+
+Scheduler::Scheduler() : nextId(1), runningId(0), stopping(false), random(std::random_device()()) {
+    thread = std::thread(&Scheduler::run, this);
+}
+
+Scheduler::~Scheduler() {
+    shutdown();
+}
+
+Scheduler& Scheduler::shared() {
+    static Scheduler scheduler;
+    return scheduler;
+}
+
+Scheduler::TaskId Scheduler::scheduleOnce(std::chrono::milliseconds delay, std::function<void()> task) {
+    Task entry;
+    entry.function = std::move(task);
+    return add(std::move(entry), delay);
+}
+
+Scheduler::TaskId Scheduler::schedulePeriodic(std::chrono::milliseconds interval, std::function<void()> task) {
+    Task entry;
+    entry.function = std::move(task);
+    entry.minInterval = entry.maxInterval = interval;
+    entry.repeat = true;
+    return add(std::move(entry), interval);
+}
+
+Scheduler::TaskId Scheduler::scheduleJittered(std::chrono::milliseconds minInterval, std::chrono::milliseconds maxInterval,
+                                              std::function<void()> task) {
+    Task entry;
+    entry.function = std::move(task);
+    entry.minInterval = std::min(minInterval, maxInterval);
+    entry.maxInterval = std::max(minInterval, maxInterval);
+    entry.repeat = true;
+
+    std::chrono::milliseconds firstDelay;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        firstDelay = nextInterval(entry);
+    }
+    return add(std::move(entry), firstDelay);
+}
+
+Scheduler::TaskId Scheduler::add(Task task, std::chrono::milliseconds firstDelay) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping) {
+        return 0;
+    }
+
+    TaskId id = nextId++;
+    task.due = Clock::now() + std::max(firstDelay, std::chrono::milliseconds(0));
+    queue.insert({task.due, id});
+    tasks[id] = std::move(task);
+    wake.notify_one();
+    return id;
+}
+
+// Call with mutex held
+std::chrono::milliseconds Scheduler::nextInterval(const Task& task) {
+    if (task.minInterval == task.maxInterval) {
+        return task.minInterval;
+    }
+    std::uniform_int_distribution<int64_t> distribution(task.minInterval.count(), task.maxInterval.count());
+    return std::chrono::milliseconds(distribution(random));
+}
+
+bool Scheduler::cancel(TaskId id, bool waitIfRunning) {
+    if (id == 0) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    bool found = it != tasks.end();
+    if (found) {
+        if (!it->second.paused) {
+            queue.erase({it->second.due, id});
+        }
+        tasks.erase(it);
+        wake.notify_one();
+    }
+
+    if (waitIfRunning && std::this_thread::get_id() != thread.get_id()) {
+        runFinished.wait(lock, [this, id] { return runningId != id; });
+    }
+    return found;
+}
+
+bool Scheduler::pause(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    if (it == tasks.end() || it->second.paused) {
+        return false;
+    }
+
+    Task& task = it->second;
+    queue.erase({task.due, id});
+    task.remaining = std::max(task.due - Clock::now(), Clock::duration(0));
+    task.paused = true;
+    wake.notify_one();
+    return true;
+}
+
+bool Scheduler::resume(TaskId id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    if (it == tasks.end() || !it->second.paused) {
+        return false;
+    }
+
+    Task& task = it->second;
+    task.due = Clock::now() + task.remaining;
+    task.paused = false;
+    // A task paused mid-run is re-queued by the scheduler thread when that run ends
+    if (runningId != id) {
+        queue.insert({task.due, id});
+    }
+    wake.notify_one();
+    return true;
+}
+
+bool Scheduler::isScheduled(TaskId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return tasks.count(id) > 0;
+}
+
+bool Scheduler::isPaused(TaskId id) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = tasks.find(id);
+    return it != tasks.end() && it->second.paused;
+}
+
+void Scheduler::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        tasks.clear();
+        queue.clear();
+    }
+    wake.notify_one();
+    if (thread.joinable() && std::this_thread::get_id() != thread.get_id()) {
+        thread.join();
+    }
+}
+
+void Scheduler::run() {
+    setCurrentThreadName("rw-scheduler");
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping) {
+        if (queue.empty()) {
+            wake.wait(lock);
+            continue;
+        }
+
+        auto next = *queue.begin();
+        if (next.first > Clock::now()) {
+            wake.wait_until(lock, next.first);
+            continue;
+        }
+        queue.erase(queue.begin());
+
+        TaskId id = next.second;
+        std::function<void()> function = tasks[id].function;
+        runningId = id;
+
+        lock.unlock();
+        function();
+        lock.lock();
+
+        runningId = 0;
+        runFinished.notify_all();
+
+        // Cancelled during the run, or finished for good
+        auto it = tasks.find(id);
+        if (it == tasks.end()) {
+            continue;
+        }
+        Task& task = it->second;
+        if (!task.repeat) {
+            tasks.erase(it);
+            continue;
+        }
+
+        // Count the next interval from the slot this run was due in, but never schedule into the past
+        Clock::time_point now = Clock::now();
+        task.due = std::max(next.first + nextInterval(task), now);
+        if (task.paused) {
+            task.remaining = task.due - now;
+        } else {
+            queue.insert({task.due, id});
+        }
+    }
+}
@@ -1,4 +1,17 @@
 #include "ScreenCapture.h"
+#include "ImageEncoder.h"
+#ifdef __linux__
+#include "MultiMonitorCapture.h"
+#include "DamageTracker.h"
+#endif
+#include "UserActivity.h"
+#include "PerceptualHash.h"
+#include "LatencyHistogram.h"
+#include "QueueMetrics.h"
+#include "ThreadName.h"
+#ifndef _WIN32
+#include "FFmpegProcess.h"
+#endif
 
 #include <string>
 #include <functional>
@@ -10,26 +23,51 @@
 #include <thread>
 #include <mutex>
 #include <iomanip>    // For std::setfill, std::setw
-#include <process.h>  // For _spawnl on Windows
-#include <cstdlib>    // For system()
-#include <filesystem> // For file operations
+#include <cstring>
+#include <algorithm>
+#include <deque>
+#include <condition_variable>
+
+namespace {
+// Frames in flight: one being grabbed, one held for the trailing frame, the rest queued for encoding
+const size_t kFramePoolSize = 4;
+const std::chrono::milliseconds kScreenshotBufferWait(500);
+
+// How often the adaptive recorder re-checks activity while waiting for its next frame
+const std::chrono::milliseconds kActivityPollInterval(250);
+const double kMinAdaptiveFrameRate = 0.01;
+
+std::chrono::microseconds frameIntervalFor(double framesPerSecond) {
+    return std::chrono::microseconds(static_cast<int64_t>(1000000.0 / framesPerSecond));
+}
 
-#ifdef _WIN32
-#include <windows.h>
+#ifdef WITH_FFMPEG
+// recording.mkv -> recording_000.mkv, recording_001.mkv, ...
+std::string segmentFilePath(const std::string& outputPath, int index) {
+    size_t dot = outputPath.find_last_of('.');
+    std::string base = dot == std::string::npos ? outputPath : outputPath.substr(0, dot);
+    std::string extension = dot == std::string::npos ? "" : outputPath.substr(dot);
+
+    std::ostringstream path;
+    path << base << "_" << std::setfill('0') << std::setw(3) << index << extension;
+    return path.str();
+}
 #endif
+}
 
 #ifdef _WIN32
 #include <windows.h>
-#include <gdiplus.h>
-#pragma comment(lib, "gdiplus.lib")
+#include <process.h>  // For _spawnl on Windows
 #endif
 
 ScreenCapture::ScreenCapture() :
-    isRecording(false), screenshotCallback(nullptr), recordingThread(), tempFrameDir("temp_frames"), gdiplusToken(0) {
+    isRecording(false), recordingThread(), screenshotCallback(nullptr), screenWidth(0), screenHeight(0),
+    screenshotFormat(ImageFormat::PNG),
+    highJpegQuality(85), lowJpegQuality(50), monitorOutputMode(MonitorOutputMode::Stitched),
+    duplicateDetection(false), duplicateMaxDistance(5), duplicateHistorySize(8),
+    recordingCodec(VideoCodec::H264), recordingFrameRate(15),
+    recordingSegmentSeconds(0), adaptiveFrameRate(false), skipUnchangedFrames(true) {
 #ifdef _WIN32
-    Gdiplus::GdiplusStartupInput gdiplusStartupInput;
-    Gdiplus::GdiplusStartup(&gdiplusToken, &gdiplusStartupInput, NULL);
-
     // Initialize process info
     memset(&processInfo, 0, sizeof(PROCESS_INFORMATION));
     ffmpegProcessRunning = false;
@@ -37,9 +75,22 @@ ScreenCapture::ScreenCapture() :
     // Get screen dimensions
     screenWidth = GetSystemMetrics(SM_CXSCREEN);
     screenHeight = GetSystemMetrics(SM_CYSCREEN);
-
-    // Create temporary directory for frames
-    createTempFrameDirectory();
+#elif __linux__
+    damageBaseline = false;
+    changeDrivenCapture = false;
+    changeDrivenThreshold = 0.0;
+    recordingListenerId = -1;
+    damageSignalled = false;
+
+    // Keep the display connections and shared-memory segments for the object's lifetime
+    monitorCapture = std::make_unique<MultiMonitorCapture>();
+    if (monitorCapture->open()) {
+        screenWidth = monitorCapture->getWidth();
+        screenHeight = monitorCapture->getHeight();
+        std::cout << "X11 capture initialized (" << screenWidth << "x" << screenHeight << ", "
+                  << monitorCapture->getMonitors().size() << " monitor(s), "
+                  << (monitorCapture->isUsingSharedMemory() ? "MIT-SHM" : "XGetImage") << ")" << std::endl;
+    }
 #endif
 }
 
@@ -48,9 +99,6 @@ ScreenCapture::~ScreenCapture() {
         stopRecording();
     }
 
-    // Cleanup temporary files
-    cleanupTempFiles();
-
 #ifdef _WIN32
     // Ensure FFmpeg process is terminated in destructor if still running
     if (ffmpegProcessRunning) {
@@ -64,18 +112,23 @@ ScreenCapture::~ScreenCapture() {
         CloseHandle(processInfo.hThread);
         ffmpegProcessRunning = false;
     }
-
-    Gdiplus::GdiplusShutdown(gdiplusToken);
 #endif
 }
 
-std::string ScreenCapture::captureScreen() {
+std::string ScreenCapture::captureScreen(ScreenshotQuality quality, bool skipDuplicates) {
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        lastScreenshotPaths.clear();
+        lastThumbnailPaths.clear();
+        lastDuplicateOf.clear();
+    }
+
 #ifdef _WIN32
-    return captureScreenWindows();
+    return captureScreenWindows(quality, skipDuplicates);
 #elif __linux__
-    return captureScreenLinux();
+    return captureScreenLinux(quality, skipDuplicates);
 #elif __APPLE__
-    return captureScreenMac();
+    return captureScreenMac(quality);
 #else
     std::cerr << "Screen capture not implemented for this platform" << std::endl;
     return "";
@@ -96,9 +149,12 @@ bool ScreenCapture::startRecording(const std::string& outputFilePath) {
         finalOutputPath = outputFilePath;
     }
 
+    // Reap a previous recording thread that ended on its own (e.g. encoder failure)
+    if (recordingThread.joinable()) {
+        recordingThread.join();
+    }
+
     outputFile = finalOutputPath;
-    frameCounter = 0;
-    // Note: We're no longer using capturedFrameFiles since we're using direct FFmpeg capture
 
     isRecording = true;
 
@@ -116,6 +172,10 @@ bool ScreenCapture::stopRecording() {
     }
 
     isRecording = false;
+    {
+        std::lock_guard<std::mutex> lock(recordingWakeMutex);
+    }
+    recordingWake.notify_all();
 
     // Wait for recording thread to finish
     if (recordingThread.joinable()) {
@@ -152,28 +212,481 @@ bool ScreenCapture::stopRecording() {
 
 
 void ScreenCapture::recordingLoop() {
-    // For direct FFmpeg screen capture, we'll launch FFmpeg as a subprocess that captures directly
+    setCurrentThreadName("rw-record");
+#if defined(WITH_FFMPEG) || !defined(_WIN32)
+    // Feed frames from our own capture path into the in-process encoder, or without libav*
+    // into an ffmpeg child over a pipe
+    captureAndEncode();
+#else
+    // Windows builds without libav* let FFmpeg capture the desktop itself
     startFFmpegScreenCapture();
+#endif
 }
 
-void ScreenCapture::startFFmpegScreenCapture() {
-    // Build the FFmpeg command for direct screen capture
+bool ScreenCapture::ensureFramePool() {
+#ifdef __linux__
+    if (monitorCapture && monitorCapture->isOpen()) {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        monitorCapture->refreshIfChanged();
+        screenWidth = monitorCapture->getWidth();
+        screenHeight = monitorCapture->getHeight();
+    }
+#endif
+    if (screenWidth <= 0 || screenHeight <= 0) {
+        return false;
+    }
+
+    size_t frameBytes = static_cast<size_t>(screenWidth) * screenHeight * 4;
+    if (framePool.getBufferCount() == kFramePoolSize && framePool.getBufferSize() >= frameBytes) {
+        return true;
+    }
+    return framePool.allocate(kFramePoolSize, frameBytes);
+}
+
+bool ScreenCapture::grabFrame(PooledFrame& buffer) {
+    std::lock_guard<std::mutex> lock(captureMutex);
+    Frame& frame = buffer.frame();
+
 #ifdef _WIN32
-    std::string ffmpegCmd = "ffmpeg -f gdigrab -i desktop -c:v libx264 -crf 23 -preset ultrafast -y \"" + outputFile + "\"";
+    return grabFrameWindows(frame, buffer.data(), buffer.capacity());
+#elif __linux__
+    // Monitors are grabbed in parallel into their own SHM images, then stitched into the
+    // pooled buffer at the size the recording started with (monitors added later are clipped)
+    if (!monitorCapture) {
+        return false;
+    }
+    monitorCapture->refreshIfChanged();
+
+    // With damage tracking only the changed rows are re-read into the monitor images
+    bool tracking = damageTracker && damageTracker->isOpen();
+    bool grabbed;
+    if (tracking && damageBaseline) {
+        grabbed = monitorCapture->grabDamaged(damageTracker->takeDamage(), monitorFrames);
+    } else {
+        if (tracking) {
+            damageTracker->takeDamage();
+        }
+        grabbed = monitorCapture->grabAll(monitorFrames);
+    }
+    damageBaseline = tracking && grabbed;
+    if (!grabbed) {
+        return false;
+    }
+
+    size_t rowBytes = static_cast<size_t>(screenWidth) * 4;
+    if (rowBytes * screenHeight > buffer.capacity()) {
+        std::cerr << "Frame pool buffer too small for " << screenWidth << "x" << screenHeight << std::endl;
+        return false;
+    }
+
+    monitorCapture->stitch(monitorFrames, buffer.data(), screenWidth, screenHeight, static_cast<int>(rowBytes));
+
+    frame.data = buffer.data();
+    frame.width = screenWidth;
+    frame.height = screenHeight;
+    frame.stride = static_cast<int>(rowBytes);
+    frame.format = PixelFormat::BGRA;
+    return true;
 #else
-    // For Linux/macOS, we'd use different parameters
-    #ifdef __linux__
-    std::string ffmpegCmd = "ffmpeg -f x11grab -i :0 -c:v libx264 -crf 23 -preset ultrafast -y \"" + outputFile + "\"";
-    #elif __APPLE__
-    std::string ffmpegCmd = "ffmpeg -f avfoundation -i \"1\" -c:v libx264 -crf 23 -preset ultrafast -y \"" + outputFile + "\"";
-    #else
-    std::cerr << "Screen capture not implemented for this platform" << std::endl;
-    return;
-    #endif
+    (void)frame;
+    return false;
+#endif
+}
+
+#if defined(WITH_FFMPEG) || !defined(_WIN32)
+void ScreenCapture::captureAndEncode() {
+    if (!ensureFramePool()) {
+        std::cerr << "Could not allocate recording frame buffers" << std::endl;
+        return;
+    }
+
+    // Capture runs here; encoding runs on its own thread so a slow frame doesn't delay the next grab
+    FrameQueue queue(kFramePoolSize, &QueueMetrics::queue(BackgroundQueue::Frames));
+    std::atomic<bool> encoderFailed(false);
+#ifdef WITH_FFMPEG
+    std::thread encodeThread(&ScreenCapture::encodeQueuedFrames, this, std::ref(queue), std::ref(encoderFailed));
+#else
+    std::thread encodeThread(&ScreenCapture::pipeQueuedFrames, this, std::ref(queue), std::ref(encoderFailed));
+#endif
+
+    PooledFrame lastFrame;
+    uint64_t framesSkipped = 0;
+    uint64_t framesDropped = 0;
+    bool anyFrameQueued = false;
+    bool lastFrameSkipped = false;
+
+    // Even on a static screen, emit a frame now and then so players can seek
+    const auto staticKeepalive = std::chrono::seconds(2);
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        recordingStats = EncoderStats();
+    }
+
+    const auto startTime = std::chrono::steady_clock::now();
+    auto nextFrameTime = startTime;
+    auto lastQueuedTime = startTime;
+    frameDiffer.reset();
+
+    UserActivity userActivity;
+    double frameRate = recordingFrameRate;
+    double dirtyFraction = 1.0;
+
+#ifdef __linux__
+    // Change-driven mode: the tracker thread flags damage and wakes the wait below
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        if (ensureDamageTracker() && changeDrivenCapture) {
+            recordingListenerId = damageTracker->addListener(changeDrivenThreshold, [this](double) {
+                {
+                    std::lock_guard<std::mutex> wakeLock(recordingWakeMutex);
+                    damageSignalled = true;
+                }
+                recordingWake.notify_all();
+            });
+        }
+    }
+#endif
+
+    while (isRecording && !encoderFailed) {
+        const auto frameStart = std::chrono::steady_clock::now();
+        bool locked = false;
+        if (adaptiveFrameRate) {
+            frameRate = chooseFrameRate(userActivity, dirtyFraction, locked);
+        }
+        // While locked nothing is grabbed; just poll until the session comes back
+        const auto frameInterval = locked ? std::chrono::microseconds(kActivityPollInterval)
+                                          : frameIntervalFor(frameRate);
+
+        // Every buffer still queued means the encoder is behind: wait one frame, then drop
+        PooledFrame buffer;
+        if (!locked) {
+            buffer = framePool.acquire(std::chrono::duration_cast<std::chrono::milliseconds>(frameInterval));
+        }
+
+        if (locked) {
+            // Re-send the last frame at stop so the file's duration still covers the locked period
+            lastFrameSkipped = static_cast<bool>(lastFrame);
+        } else if (!buffer) {
+            framesDropped++;
+        } else if (!grabFrame(buffer)) {
+            std::cerr << "Screen grab failed, stopping encoder" << std::endl;
+            break;
+        } else {
+            const Frame& frame = buffer.frame();
+            auto diffStart = std::chrono::steady_clock::now();
+            int changedTiles = frameDiffer.update(frame);
+            PipelineLatency::stage(PipelineStage::Diff).recordSince(diffStart);
+            const DirtyTileMap& dirtyTiles = frameDiffer.getDirtyTiles();
+            int tileCount = dirtyTiles.tilesX * dirtyTiles.tilesY;
+            dirtyFraction = tileCount > 0 ? static_cast<double>(changedTiles) / tileCount : 0.0;
+            if (frameCallback) {
+                frameCallback(frame, dirtyTiles);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (skipUnchangedFrames && changedTiles == 0 && anyFrameQueued &&
+                now - lastQueuedTime < staticKeepalive) {
+                framesSkipped++;
+                lastFrameSkipped = true;
+            } else {
+                FrameQueue::Entry entry;
+                entry.buffer = buffer;
+                entry.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
+                if (queue.push(std::move(entry))) {
+                    anyFrameQueued = true;
+                    lastQueuedTime = now;
+                    lastFrameSkipped = false;
+                } else {
+                    framesDropped++;
+                }
+            }
+
+            // Keep the newest frame so a trailing run of skipped frames can be closed off at stop
+            lastFrame = std::move(buffer);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(statsMutex);
+            recordingStats.framesSkipped = framesSkipped;
+            recordingStats.framesDropped = framesDropped;
+            recordingStats.currentFrameRate = locked ? 0.0 : frameRate;
+        }
+
+        // Pace to the target rate; if the encoder falls behind, don't burst to catch up
+        nextFrameTime += frameInterval;
+        if (nextFrameTime < std::chrono::steady_clock::now()) {
+            nextFrameTime = std::chrono::steady_clock::now();
+        }
+
+        // Sleep until the next frame. In adaptive mode keep polling activity so that
+        // a returning user gets the full rate right away instead of after a long idle interval.
+        while (isRecording) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= nextFrameTime) {
+                break;
+            }
+
+            auto wakeAt = adaptiveFrameRate ? std::min(nextFrameTime, now + kActivityPollInterval) : nextFrameTime;
+            {
+                std::unique_lock<std::mutex> lock(recordingWakeMutex);
+                recordingWake.wait_until(lock, wakeAt, [this] { return !isRecording; });
+            }
+
+            if (adaptiveFrameRate) {
+                bool lockedNow = false;
+                double rate = chooseFrameRate(userActivity, dirtyFraction, lockedNow);
+                if (!lockedNow && (locked || rate > frameRate)) {
+                    nextFrameTime = std::min(nextFrameTime, frameStart + frameIntervalFor(rate));
+                }
+            }
+        }
+
+#ifdef __linux__
+        // The frame is due; without enough damage there is nothing new to grab, so sleep
+        // until there is (or the keepalive frame is due)
+        if (recordingListenerId >= 0 && !locked) {
+            std::unique_lock<std::mutex> lock(recordingWakeMutex);
+            recordingWake.wait_until(lock, lastQueuedTime + staticKeepalive,
+                                     [this] { return !isRecording || damageSignalled; });
+            damageSignalled = false;
+        }
+#endif
+    }
+
+#ifdef __linux__
+    if (recordingListenerId >= 0) {
+        damageTracker->removeListener(recordingListenerId);
+        recordingListenerId = -1;
+    }
+#endif
+
+    // Close the video on the last (skipped) frame so its duration covers the whole recording
+    if (lastFrameSkipped && lastFrame) {
+        FrameQueue::Entry entry;
+        entry.buffer = std::move(lastFrame);
+        entry.timestampMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - startTime).count();
+        queue.push(std::move(entry));
+    }
+    lastFrame.reset();
+
+    queue.close();
+    encodeThread.join();
+
+    EncoderStats stats;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        recordingStats.framesSkipped = framesSkipped;
+        recordingStats.framesDropped = framesDropped;
+        stats = recordingStats;
+    }
+
+    std::cout << "Encoded " << stats.framesEncoded << " frames (" << stats.bytesWritten << " bytes, "
+              << stats.framesSkipped << " unchanged frames skipped, " << stats.framesDropped
+              << " dropped under backpressure), avg " << stats.averageEncodeMs() << " ms/frame wall, "
+              << stats.averageCpuMs() << " ms/frame CPU" << std::endl;
+}
+#endif
+
+#ifdef WITH_FFMPEG
+void ScreenCapture::encodeQueuedFrames(FrameQueue& queue, std::atomic<bool>& encoderFailed) {
+    setCurrentThreadName("rw-encode");
+    VideoEncoder encoder;
+    FrameQueue::Entry entry;
+
+    const int64_t segmentMs = static_cast<int64_t>(recordingSegmentSeconds) * 1000;
+    int segmentIndex = 0;
+    int64_t segmentStartMs = 0;
+    bool encoderStarted = false;
+
+    // Finished segments are handed to the callback on their own thread so a slow upload can't stall encoding
+    std::mutex segmentMutex;
+    std::condition_variable segmentReady;
+    std::deque<std::pair<std::string, std::chrono::steady_clock::time_point>> finishedSegments;
+    QueueCounters& segmentCounters = QueueMetrics::queue(BackgroundQueue::Segments);
+    bool encodingDone = false;
+    std::thread deliveryThread;
+
+    if (segmentMs > 0 && segmentCallback) {
+        encoder.setSegmentCallback([&](const std::string& path) {
+            {
+                std::lock_guard<std::mutex> lock(segmentMutex);
+                finishedSegments.emplace_back(path, std::chrono::steady_clock::now());
+            }
+            segmentCounters.pushed();
+            segmentReady.notify_one();
+        });
+
+        deliveryThread = std::thread([&]() {
+            setCurrentThreadName("rw-upload");
+            std::unique_lock<std::mutex> lock(segmentMutex);
+            while (true) {
+                segmentReady.wait(lock, [&] { return encodingDone || !finishedSegments.empty(); });
+                if (finishedSegments.empty()) {
+                    return;
+                }
+                std::string path = finishedSegments.front().first;
+                segmentCounters.popped(finishedSegments.front().second);
+                finishedSegments.pop_front();
+
+                lock.unlock();
+                segmentCallback(path);
+                lock.lock();
+            }
+        });
+    }
+
+    while (queue.pop(entry)) {
+        const Frame& frame = entry.buffer.frame();
+
+        if (!encoder.isOpen() && !encoderFailed) {
+            std::string path = segmentMs > 0 ? segmentFilePath(outputFile, segmentIndex) : outputFile;
+            if (encoderStarted) {
+                std::cerr << "Encoder output failed, stopping recording" << std::endl;
+                encoderFailed = true;
+            } else if (!encoder.open(path, frame.width, frame.height, recordingFrameRate, recordingCodec)) {
+                std::cerr << "Failed to start " << VideoEncoder::codecName(recordingCodec) << " encoder" << std::endl;
+                encoderFailed = true;
+            } else {
+                encoderStarted = true;
+                segmentStartMs = entry.timestampMs;
+            }
+        } else if (encoder.isOpen() && segmentMs > 0 && entry.timestampMs - segmentStartMs >= segmentMs) {
+            // Roll over; the encoder switches files at the keyframe it forces on this frame
+            if (encoder.startNewSegment(segmentFilePath(outputFile, segmentIndex + 1))) {
+                segmentIndex++;
+                segmentStartMs = entry.timestampMs;
+            }
+        }
+
+        if (encoder.isOpen()) {
+            ScopedLatency timing(PipelineStage::VideoEncode);
+            encoder.encodeFrame(frame, entry.timestampMs);
+        }
+
+        // Hand the buffer back to the pool before waiting for the next one
+        entry.buffer.reset();
+
+        EncoderStats stats = encoder.getStats();
+        std::lock_guard<std::mutex> lock(statsMutex);
+        stats.framesSkipped = recordingStats.framesSkipped;
+        stats.framesDropped = recordingStats.framesDropped;
+        recordingStats = stats;
+    }
+
+    encoder.close();
+
+    if (deliveryThread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(segmentMutex);
+            encodingDone = true;
+        }
+        segmentReady.notify_one();
+        deliveryThread.join();
+    }
+
+    EncoderStats stats = encoder.getStats();
+    std::lock_guard<std::mutex> lock(statsMutex);
+    stats.framesSkipped = recordingStats.framesSkipped;
+    stats.framesDropped = recordingStats.framesDropped;
+    recordingStats = stats;
+}
+#endif
+
+#if !defined(WITH_FFMPEG) && !defined(_WIN32)
+std::vector<std::string> ScreenCapture::externalEncoderArgs() const {
+    std::vector<std::string> args;
+    switch (recordingCodec) {
+        case VideoCodec::H264:
+            args = {"-c:v", "libx264", "-preset", "ultrafast", "-crf", "23", "-pix_fmt", "yuv420p"};
+            break;
+        case VideoCodec::VP9:
+            args = {"-c:v", "libvpx-vp9", "-deadline", "realtime", "-cpu-used", "8", "-crf", "35", "-b:v", "0",
+                    "-pix_fmt", "yuv420p"};
+            break;
+        case VideoCodec::AV1:
+            args = {"-c:v", "libsvtav1", "-preset", "10", "-crf", "35", "-pix_fmt", "yuv420p"};
+            break;
+    }
+
+    // In segmented mode let FFmpeg's segment muxer roll the files; the callback is only driven in-process
+    if (recordingSegmentSeconds > 0) {
+        std::string pattern = outputFile.substr(0, outputFile.find_last_of('.')) + "_%03d.mkv";
+        args.insert(args.end(), {"-f", "segment", "-segment_time", std::to_string(recordingSegmentSeconds),
+                                 "-reset_timestamps", "1", "-y", pattern});
+    } else {
+        args.insert(args.end(), {"-y", outputFile});
+    }
+    return args;
+}
+
+void ScreenCapture::pipeQueuedFrames(FrameQueue& queue, std::atomic<bool>& encoderFailed) {
+    setCurrentThreadName("rw-encode");
+    FFmpegProcess ffmpeg;
+    FrameQueue::Entry entry;
+    bool started = false;
+
+    while (queue.pop(entry)) {
+        const Frame& frame = entry.buffer.frame();
+
+        if (!started) {
+            // The child is sized from the first frame; the capture loop keeps that size for the whole recording
+            started = ffmpeg.start(frame.width, frame.height, recordingFrameRate, externalEncoderArgs());
+            if (!started) {
+                encoderFailed = true;
+            }
+        }
+
+        double writeMs = 0.0;
+        if (started && !encoderFailed) {
+            auto writeStart = std::chrono::steady_clock::now();
+            if (!ffmpeg.writeFrame(frame, entry.timestampMs)) {
+                std::cerr << "ffmpeg stopped accepting frames, stopping recording" << std::endl;
+                encoderFailed = true;
+            }
+            writeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - writeStart).count();
+            PipelineLatency::stage(PipelineStage::VideoEncode).record(static_cast<uint64_t>(writeMs * 1e6));
+        }
+
+        // Hand the buffer back to the pool before waiting for the next one
+        entry.buffer.reset();
+
+        if (!encoderFailed) {
+            // Time spent blocked on the pipe is ffmpeg's encode time as seen from here
+            std::lock_guard<std::mutex> lock(statsMutex);
+            recordingStats.framesEncoded++;
+            recordingStats.bytesWritten = ffmpeg.getBytesWritten();
+            recordingStats.lastEncodeMs = writeMs;
+            recordingStats.totalEncodeMs += writeMs;
+        }
+    }
+
+    if (started) {
+        int exitCode = ffmpeg.stop();
+        if (exitCode == 0) {
+            std::cout << "ffmpeg finished writing " << outputFile << std::endl;
+        } else {
+            std::cerr << "ffmpeg exited with status " << exitCode << " while writing " << outputFile << std::endl;
+        }
+    }
+}
 #endif
 
-    // Execute the FFmpeg command as a subprocess using Win32 API to have better control
 #ifdef _WIN32
+void ScreenCapture::startFFmpegScreenCapture() {
+    // Build the FFmpeg command for direct screen capture
+    // In segmented mode let FFmpeg's segment muxer roll the files; the callback is only driven in-process
+    std::string outputArgs = "-y \"" + outputFile + "\"";
+    if (recordingSegmentSeconds > 0) {
+        std::string pattern = outputFile.substr(0, outputFile.find_last_of('.')) + "_%03d.mkv";
+        outputArgs = "-f segment -segment_time " + std::to_string(recordingSegmentSeconds) +
+                     " -reset_timestamps 1 -y \"" + pattern + "\"";
+    }
+
+    std::string ffmpegCmd = "ffmpeg -f gdigrab -i desktop -c:v libx264 -crf 23 -preset ultrafast " + outputArgs;
+
+    // Execute the FFmpeg command as a subprocess using Win32 API to have better control
     STARTUPINFOW si;
     PROCESS_INFORMATION pi;
 
@@ -205,15 +718,18 @@ void ScreenCapture::startFFmpegScreenCapture() {
 
     // Don't close handles immediately - we need them to control the process
     // We'll close them in stopRecording
-#else
-    // On Linux/Mac, we would use fork/exec or similar
-    // For now, use system() which is blocking - not ideal but works for this implementation
-    system(ffmpegCmd.c_str());
-#endif
 }
+#endif
 
 #ifdef _WIN32
-bool ScreenCapture::captureFrameWindows(const std::string& filePath) {
+bool ScreenCapture::grabFrameWindows(Frame& frame, uint8_t* pixels, size_t capacity) {
+    ScopedLatency timing(PipelineStage::Grab);
+
+    if (static_cast<size_t>(screenWidth) * screenHeight * 4 > capacity) {
+        std::cerr << "Frame buffer too small for screen" << std::endl;
+        return false;
+    }
+
     HDC hScreen = GetDC(NULL);
     if (!hScreen) {
         std::cerr << "Failed to get screen DC" << std::endl;
@@ -221,405 +737,444 @@ bool ScreenCapture::captureFrameWindows(const std::string& filePath) {
     }
 
     HDC hDC = CreateCompatibleDC(hScreen);
-    if (!hDC) {
-        std::cerr << "Failed to create compatible DC" << std::endl;
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
-
     HBITMAP hBitmap = CreateCompatibleBitmap(hScreen, screenWidth, screenHeight);
-    if (!hBitmap) {
-        std::cerr << "Failed to create compatible bitmap" << std::endl;
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
-
     HGDIOBJ old_obj = SelectObject(hDC, hBitmap);
-    if (!old_obj) {
-        std::cerr << "Failed to select bitmap object" << std::endl;
-        DeleteObject(hBitmap);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
 
     BOOL result = BitBlt(hDC, 0, 0, screenWidth, screenHeight, hScreen, 0, 0, SRCCOPY);
-    if (!result) {
-        std::cerr << "Failed to perform BitBlt" << std::endl;
-        SelectObject(hDC, old_obj);
-        DeleteObject(hBitmap);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
 
-    // Save to BMP file using the same approach as the captureScreenWindows function
     BITMAPINFO bmi = {0};
     bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
     bmi.bmiHeader.biWidth = screenWidth;
     bmi.bmiHeader.biHeight = -screenHeight; // Negative for top-down bitmap
     bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 24;
+    bmi.bmiHeader.biBitCount = 32;
     bmi.bmiHeader.biCompression = BI_RGB;
 
-    std::vector<uint8_t> pixels(screenWidth * screenHeight * 3);
-    int scanlineSize = ((24 * screenWidth + 31) / 32) * 4; // Calculate actual scanline size
-    int pixelsGot = GetDIBits(hDC, hBitmap, 0, screenHeight, pixels.data(), (BITMAPINFO*)&bmi, DIB_RGB_COLORS);
-    if (pixelsGot <= 0) {
-        std::cerr << "Failed to get DIBits" << std::endl;
-        SelectObject(hDC, old_obj);
-        DeleteObject(hBitmap);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
-
-    // Create and write the BMP file manually
-    std::ofstream file(filePath, std::ios::binary);
-    if (file.is_open()) {
-        // BMP Header (14 bytes)
-        file.put('B'); file.put('M'); // Signature
-
-        // File size: header + (width * height * 3 bytes per pixel)
-        int headersSize = 54; // Size of all headers
-        int totalFileSize = headersSize + (screenWidth * screenHeight * 3);
-        file.write(reinterpret_cast<const char*>(&totalFileSize), 4); // File size
-
-        int reserved = 0;
-        file.write(reinterpret_cast<const char*>(&reserved), 2); // Reserved
-        file.write(reinterpret_cast<const char*>(&reserved), 2); // Reserved
-
-        int dataOffset = headersSize;
-        file.write(reinterpret_cast<const char*>(&dataOffset), 4); // Data offset
-
-        // DIB Header (40 bytes - BITMAPINFOHEADER)
-        int headerSize = 40;
-        file.write(reinterpret_cast<const char*>(&headerSize), 4); // Header size
-        file.write(reinterpret_cast<const char*>(&screenWidth), 4); // Width
-        file.write(reinterpret_cast<const char*>(&screenHeight), 4); // Height
-        file.put(1); file.put(0); // Planes
-        file.put(24); file.put(0); // Bits per pixel
-        int compression = 0; // BI_RGB
-        file.write(reinterpret_cast<const char*>(&compression), 4); // Compression
-        int imageSize = screenWidth * screenHeight * 3;
-        file.write(reinterpret_cast<const char*>(&imageSize), 4); // Image size
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Horizontal resolution
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Vertical resolution
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Colors used
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Important colors
-
-        // Write pixel data (RGB values, bottom to top due to BMP format)
-        for(int y = screenHeight - 1; y >= 0; y--) {
-            for(int x = 0; x < screenWidth; x++) {
-                int pixelIndex = (y * screenWidth + x) * 3;
-                // Write BGR (BMP format requires BGR order)
-                file.put(pixels[pixelIndex + 2]); // Blue
-                file.put(pixels[pixelIndex + 1]); // Green
-                file.put(pixels[pixelIndex]);     // Red
-            }
-        }
-
-        file.close();
-    } else {
-        std::cerr << "Failed to create file: " << filePath << std::endl;
-        SelectObject(hDC, old_obj);
-        DeleteObject(hBitmap);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        return false;
-    }
+    int linesGot = result ? GetDIBits(hDC, hBitmap, 0, screenHeight, pixels, &bmi, DIB_RGB_COLORS) : 0;
 
     SelectObject(hDC, old_obj);
     DeleteObject(hBitmap);
     DeleteDC(hDC);
     ReleaseDC(NULL, hScreen);
 
+    if (linesGot <= 0) {
+        std::cerr << "Failed to grab screen pixels" << std::endl;
+        return false;
+    }
+
+    frame.data = pixels;
+    frame.width = screenWidth;
+    frame.height = screenHeight;
+    frame.stride = screenWidth * 4;
+    frame.format = PixelFormat::BGRA;
     return true;
 }
 #endif
 
-#ifdef __linux__
-bool ScreenCapture::captureFrameLinux(const std::string& filePath) {
-    // Placeholder implementation for Linux
-    // In a real implementation, you might use X11 capture libraries
-    // or call external utilities like scrot
-    std::cout << "Linux frame capture to: " << filePath << std::endl;
-    // This would be implemented using X11 screen capture
-    return false; // Placeholder
+void ScreenCapture::setScreenshotCallback(std::function<void(const std::string&)> callback) {
+    screenshotCallback = callback;
 }
-#endif
 
-#ifdef __APPLE__
-bool ScreenCapture::captureFrameMac(const std::string& filePath) {
-    // Placeholder implementation for macOS
-    // In a real implementation, you might use CGDisplay API
-    std::cout << "macOS frame capture to: " << filePath << std::endl;
-    // This would be implemented using macOS screen capture APIs
-    return false; // Placeholder
+void ScreenCapture::setScreenshotFormat(ImageFormat format) {
+    screenshotFormat = format;
 }
-#endif
 
+void ScreenCapture::setQualityTier(ScreenshotQuality tier, int jpegQuality) {
+    if (tier == ScreenshotQuality::High) {
+        highJpegQuality = jpegQuality;
+    } else if (tier == ScreenshotQuality::Low) {
+        lowJpegQuality = jpegQuality;
+    }
+}
 
-void ScreenCapture::setScreenshotCallback(std::function<void(const std::string&)> callback) {
-    screenshotCallback = callback;
+void ScreenCapture::setDuplicateDetection(bool enabled, int maxDistance, size_t historySize) {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    duplicateDetection = enabled;
+    duplicateMaxDistance = maxDistance;
+    duplicateHistorySize = historySize > 0 ? historySize : 1;
+    if (!enabled) {
+        recentScreenshots.clear();
+    }
+}
+
+std::string ScreenCapture::getLastDuplicateOf() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastDuplicateOf;
 }
 
-// Additional platform-specific implementation functions go here
-// (captureScreenWindows, captureScreenLinux, captureScreenMac)
+void ScreenCapture::setThumbnailFactors(const std::vector<int>& factors) {
+    thumbnailFactors.clear();
+    for (int factor : factors) {
+        if (factor > 1 && factor <= ImageEncoder::kMaxDownscaleFactor) {
+            thumbnailFactors.push_back(factor);
+        }
+    }
+}
 
-#ifdef _WIN32
-std::string ScreenCapture::captureScreenWindows() {
-    int width, height;
-    HDC hScreen;
+void ScreenCapture::setMonitorOutputMode(MonitorOutputMode mode) {
+    monitorOutputMode = mode;
+}
 
-#ifdef WITH_FFMPEG
-    width = screenWidth;
-    height = screenHeight;
-    hScreen = GetDC(NULL);
+std::vector<std::string> ScreenCapture::getLastScreenshotPaths() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastScreenshotPaths;
+}
+
+std::vector<std::string> ScreenCapture::getLastThumbnailPaths() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return lastThumbnailPaths;
+}
+
+ScreenshotStats ScreenCapture::getScreenshotStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return screenshotStats;
+}
+
+void ScreenCapture::setPngOptions(int compressionLevel, int threads) {
+    pngOptions.compressionLevel = compressionLevel;
+    pngOptions.threads = threads;
+}
+
+void ScreenCapture::setRecordingCodec(VideoCodec codec) {
+    recordingCodec = codec;
+}
+
+void ScreenCapture::setSkipUnchangedFrames(bool enabled) {
+    skipUnchangedFrames = enabled;
+}
+
+void ScreenCapture::setFrameCallback(std::function<void(const Frame&, const DirtyTileMap&)> callback) {
+    frameCallback = callback;
+}
+
+void ScreenCapture::setChangeDrivenCapture(bool enabled, double threshold) {
+#ifdef __linux__
+    changeDrivenCapture = enabled;
+    changeDrivenThreshold = std::max(0.0, threshold);
 #else
-    hScreen = GetDC(NULL);
-    width = GetDeviceCaps(hScreen, HORZRES);
-    height = GetDeviceCaps(hScreen, VERTRES);
+    (void)enabled;
+    (void)threshold;
 #endif
+}
 
-    HDC hDC = CreateCompatibleDC(hScreen);
-    HBITMAP hBitmap = CreateCompatibleBitmap(hScreen, width, height);
-    HGDIOBJ old_obj = SelectObject(hDC, hBitmap);
+int ScreenCapture::addScreenChangeListener(double threshold, std::function<void(double)> callback) {
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock(captureMutex);
+    if (!ensureDamageTracker()) {
+        return -1;
+    }
+    return damageTracker->addListener(threshold, callback);
+#else
+    (void)threshold;
+    (void)callback;
+    return -1;
+#endif
+}
 
-    BitBlt(hDC, 0, 0, width, height, hScreen, 0, 0, SRCCOPY);
+void ScreenCapture::removeScreenChangeListener(int id) {
+#ifdef __linux__
+    std::lock_guard<std::mutex> lock(captureMutex);
+    if (damageTracker) {
+        damageTracker->removeListener(id);
+    }
+#else
+    (void)id;
+#endif
+}
 
-    // Generate filename with timestamp - now using PNG
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
+#ifdef __linux__
+// Call with captureMutex held
+bool ScreenCapture::ensureDamageTracker() {
+    if (!damageTracker) {
+        damageTracker = std::make_unique<DamageTracker>();
+        damageBaseline = false;
+        if (damageTracker->open()) {
+            std::cout << "XDamage change tracking enabled" << std::endl;
+        }
+    }
+    return damageTracker->isOpen();
+}
+#endif
 
-    std::stringstream filename;
-    filename << "screenshot_" << time_t << "_" << ms.count() << ".png";
+void ScreenCapture::setAdaptiveFrameRate(bool enabled, const AdaptiveFrameRateSettings& settings) {
+    adaptiveSettings = settings;
+    adaptiveSettings.quietFrameRate = std::max(settings.quietFrameRate, kMinAdaptiveFrameRate);
+    adaptiveSettings.idleFrameRate = std::max(settings.idleFrameRate, kMinAdaptiveFrameRate);
+    adaptiveFrameRate = enabled;
+}
 
-    // Actually save the bitmap to a file in the current directory
-    std::string filepath = filename.str();
+double ScreenCapture::chooseFrameRate(UserActivity& activity, double dirtyFraction, bool& locked) const {
+    locked = activity.isScreenLocked();
+    if (locked) {
+        return 0.0;
+    }
 
-#ifdef WITH_FFMPEG
-    // If we have FFmpeg, we can potentially convert to PNG using libav* functions
-    // But on Windows, it's more common to use GDI+ for PNG encoding
-    // For now, save as PNG using GDI+
-    Gdiplus::Bitmap* bitmap = new Gdiplus::Bitmap(width, height, PixelFormat24bppRGB);
+    const double fullRate = recordingFrameRate;
+    const double quietRate = std::min(adaptiveSettings.quietFrameRate, fullRate);
+    bool screenChanging = dirtyFraction >= adaptiveSettings.changeThreshold;
+    int64_t idleMs = activity.getIdleTimeMs();
 
-    // Get the bitmap bits
-    BITMAPINFO bmi = {0};
-    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = width;
-    bmi.bmiHeader.biHeight = -height; // Negative for top-down bitmap
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 24;
-    bmi.bmiHeader.biCompression = BI_RGB;
+    if (idleMs >= static_cast<int64_t>(adaptiveSettings.idleAfterSeconds) * 1000) {
+        // Nobody at the keyboard; something playing on screen still gets a few frames
+        return screenChanging ? quietRate : std::min(adaptiveSettings.idleFrameRate, fullRate);
+    }
+    if (idleMs < adaptiveSettings.activeInputWindowMs || screenChanging) {
+        return fullRate;
+    }
+    return quietRate;
+}
 
-    std::vector<uint8_t> pixels(width * height * 3);
-    int scanlineSize = ((24 * width + 31) / 32) * 4; // Calculate actual scanline size
-    GetDIBits(hDC, hBitmap, 0, height, pixels.data(), (BITMAPINFO*)&bmi, DIB_RGB_COLORS);
+void ScreenCapture::setRecordingSegmentDuration(int seconds) {
+    recordingSegmentSeconds = seconds > 0 ? seconds : 0;
+}
 
-    // Copy pixel data to bitmap
-    for(int y = 0; y < height; y++) {
-        for(int x = 0; x < width; x++) {
-            int pixelIndex = (y * width + x) * 3;
-            bitmap->SetPixel(x, y, Gdiplus::Color(pixels[pixelIndex + 2], pixels[pixelIndex + 1], pixels[pixelIndex])); // BGR to RGB
-        }
+void ScreenCapture::setSegmentCallback(std::function<void(const std::string&)> callback) {
+    segmentCallback = callback;
+}
+
+void ScreenCapture::setRecordingFrameRate(int framesPerSecond) {
+    if (framesPerSecond > 0) {
+        recordingFrameRate = framesPerSecond;
     }
+}
 
-    // Define PNG encoder
-    CLSID pngEncoder;
-    GetEncoderClsid(L"image/png", &pngEncoder);
+EncoderStats ScreenCapture::getRecordingStats() const {
+    std::lock_guard<std::mutex> lock(statsMutex);
+    return recordingStats;
+}
 
-    // Save as PNG
-    Gdiplus::Status status = bitmap->Save(filepath.c_str(), &pngEncoder, NULL);
+double ScreenCapture::getLastGrabLatencyMs() const {
+#ifdef __linux__
+    if (monitorCapture) {
+        return monitorCapture->getLastGrabLatencyMs();
+    }
+#endif
+    return 0.0;
+}
 
-    delete bitmap;
+std::string ScreenCapture::saveScreenshot(const Frame& frame, ScreenshotQuality quality, bool skipDuplicates,
+                                          const std::string& nameSuffix) {
+    ImageFormat format = screenshotFormat;
+    int jpegQuality = highJpegQuality;
+    if (quality != ScreenshotQuality::Lossless && ImageEncoder::isJpegAvailable()) {
+        format = ImageFormat::JPEG;
+        jpegQuality = quality == ScreenshotQuality::High ? highJpegQuality : lowJpegQuality;
+    }
 
-    if (status != Gdiplus::Ok) {
-        std::cerr << "Failed to save PNG screenshot: " << filepath << std::endl;
-        SelectObject(hDC, old_obj);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        DeleteObject(hBitmap);
-        return "";
+    // setDuplicateDetection may run on another thread; read the setting once for this screenshot
+    bool detectDuplicates;
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        detectDuplicates = duplicateDetection && skipDuplicates;
     }
-#else
-    // For simplicity in the non-FFMPEG case, save as BMP but we'll update to use libpng in a real implementation
-    // For now, keep the existing BMP code but change the extension
-    // Get the BITMAPINFO structure
-    BITMAPINFO bmi = {0};
-    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-    bmi.bmiHeader.biWidth = width;
-    bmi.bmiHeader.biHeight = -height; // Negative for top-down bitmap
-    bmi.bmiHeader.biPlanes = 1;
-    bmi.bmiHeader.biBitCount = 24;
-    bmi.bmiHeader.biCompression = BI_RGB;
 
-    // Get bitmap bits
-    std::vector<uint8_t> pixels(width * height * 3);
-    int scanlineSize = ((24 * width + 31) / 32) * 4; // Calculate actual scanline size
-    std::vector<uint8_t> scanline(scanlineSize);
-    GetDIBits(hDC, hBitmap, 0, height, pixels.data(), (BITMAPINFO*)&bmi, DIB_RGB_COLORS);
-
-    // Create and write the BMP file manually
-    std::ofstream file(filepath, std::ios::binary);
-    if (file.is_open()) {
-        // BMP Header (14 bytes)
-        file.put('B'); file.put('M'); // Signature
-
-        // File size: header + (width * height * 3 bytes per pixel)
-        int headersSize = 54; // Size of all headers
-        int totalFileSize = headersSize + (width * height * 3);
-        file.write(reinterpret_cast<const char*>(&totalFileSize), 4); // File size
-
-        int reserved = 0;
-        file.write(reinterpret_cast<const char*>(&reserved), 2); // Reserved
-        file.write(reinterpret_cast<const char*>(&reserved), 2); // Reserved
-
-        int dataOffset = headersSize;
-        file.write(reinterpret_cast<const char*>(&dataOffset), 4); // Data offset
-
-        // DIB Header (40 bytes - BITMAPINFOHEADER)
-        int headerSize = 40;
-        file.write(reinterpret_cast<const char*>(&headerSize), 4); // Header size
-        file.write(reinterpret_cast<const char*>(&width), 4); // Width
-        file.write(reinterpret_cast<const char*>(&height), 4); // Height
-        file.put(1); file.put(0); // Planes
-        file.put(24); file.put(0); // Bits per pixel
-        int compression = 0; // BI_RGB
-        file.write(reinterpret_cast<const char*>(&compression), 4); // Compression
-        int imageSize = width * height * 3;
-        file.write(reinterpret_cast<const char*>(&imageSize), 4); // Image size
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Horizontal resolution
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Vertical resolution
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Colors used
-        file.write(reinterpret_cast<const char*>(&reserved), 4); // Important colors
-
-        // Write pixel data (RGB values, bottom to top due to BMP format)
-        for(int y = height - 1; y >= 0; y--) {
-            for(int x = 0; x < width; x++) {
-                int pixelIndex = (y * width + x) * 3;
-                // Write BGR (BMP format requires BGR order)
-                file.put(pixels[pixelIndex + 2]); // Blue
-                file.put(pixels[pixelIndex + 1]); // Green
-                file.put(pixels[pixelIndex]);     // Red
+    // Hash before encoding so a duplicate costs neither the encode nor the upload
+    uint64_t hash = 0;
+    if (detectDuplicates) {
+        auto hashStart = std::chrono::steady_clock::now();
+        hash = PerceptualHash::dHash(frame);
+        PipelineLatency::stage(PipelineStage::Hash).recordSince(hashStart);
+
+        std::lock_guard<std::mutex> lock(statsMutex);
+        for (const auto& recent : recentScreenshots) {
+            int distance = PerceptualHash::distance(hash, recent.hash);
+            if (recent.width == frame.width && recent.height == frame.height && distance <= duplicateMaxDistance) {
+                screenshotStats.duplicatesSkipped++;
+                screenshotStats.bytesSaved += recent.bytes;
+                lastDuplicateOf = recent.path;
+                std::cout << "Screenshot matches " << recent.path << " (distance " << distance
+                          << "), skipped; " << screenshotStats.bytesSaved << " bytes saved so far" << std::endl;
+                return "";
             }
         }
+    }
 
-        file.close();
-        // Note: The file is actually saved as BMP even though extension says PNG
-        // In a full implementation, we would convert to proper PNG format
-    } else {
-        std::cerr << "Failed to create screenshot file: " << filepath << std::endl;
-        SelectObject(hDC, old_obj);
-        DeleteDC(hDC);
-        ReleaseDC(NULL, hScreen);
-        DeleteObject(hBitmap);
+    // Generate filename with timestamp
+    auto now = std::chrono::system_clock::now();
+    auto time_t = std::chrono::system_clock::to_time_t(now);
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now.time_since_epoch()) % 1000;
+
+    std::stringstream filename;
+    filename << "screenshot_" << time_t << "_" << ms.count() << nameSuffix;
+    std::string basePath = filename.str();
+    std::string filepath = basePath + ImageEncoder::extensionFor(format);
+
+    // Thumbnails go first so they are on disk (and uploadable) before the full image
+    double thumbnailMs = 0.0;
+    std::vector<std::string> thumbnailPaths = saveThumbnails(frame, basePath, format, jpegQuality, thumbnailMs);
+    if (!thumbnailFactors.empty()) {
+        PipelineLatency::stage(PipelineStage::Thumbnail).record(static_cast<uint64_t>(thumbnailMs * 1e6));
+    }
+
+    auto encodeStart = std::chrono::steady_clock::now();
+    std::vector<uint8_t> encoded;
+    bool encodedOk = ImageEncoder::encode(frame, format, encoded, pngOptions, jpegQuality);
+    double encodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - encodeStart).count();
+    PipelineLatency::stage(PipelineStage::Encode).record(static_cast<uint64_t>(encodeMs * 1e6));
+
+    auto writeStart = std::chrono::steady_clock::now();
+    if (!encodedOk || !ImageEncoder::writeFile(filepath, encoded)) {
+        std::cerr << "Failed to save screenshot: " << filepath << std::endl;
         return "";
     }
-#endif
+    PipelineLatency::stage(PipelineStage::Write).recordSince(writeStart);
+
+    {
+        std::lock_guard<std::mutex> lock(statsMutex);
+        screenshotStats.count++;
+        screenshotStats.totalBytes += encoded.size();
+        screenshotStats.totalEncodeMs += encodeMs;
+        screenshotStats.lastBytes = encoded.size();
+        screenshotStats.lastEncodeMs = encodeMs;
+        screenshotStats.lastThumbnailMs = thumbnailMs;
+        lastThumbnailPaths.insert(lastThumbnailPaths.end(), thumbnailPaths.begin(), thumbnailPaths.end());
+        lastScreenshotPaths.push_back(filepath);
+
+        if (detectDuplicates && duplicateDetection) {
+            recentScreenshots.push_front({hash, frame.width, frame.height, encoded.size(), filepath});
+            while (recentScreenshots.size() > duplicateHistorySize) {
+                recentScreenshots.pop_back();
+            }
+        }
+    }
 
-    std::cout << "Saved screenshot: " << filepath << std::endl;
+    std::cout << "Saved screenshot: " << filepath << " (" << encoded.size() << " bytes, encoded in "
+              << encodeMs << " ms)" << std::endl;
 
     // Call callback if set
     if (screenshotCallback) {
         screenshotCallback(filepath);
     }
 
-    SelectObject(hDC, old_obj);
-    DeleteDC(hDC);
-    ReleaseDC(NULL, hScreen);
-    DeleteObject(hBitmap);
-
     return filepath;
 }
 
-// Helper function to get the encoder CLSID for GDI+
-int GetEncoderClsid(const WCHAR* format, CLSID* pClsid) {
-    UINT num = 0;
-    UINT size = 0;
-
-    Gdiplus::GetImageEncodersSize(&num, &size);
-    if (size == 0)
-        return -1; // Failure
+std::vector<std::string> ScreenCapture::saveThumbnails(const Frame& frame, const std::string& basePath,
+                                                      ImageFormat format, int jpegQuality, double& elapsedMs) {
+    std::vector<std::string> paths;
+    elapsedMs = 0.0;
+    if (thumbnailFactors.empty()) {
+        return paths;
+    }
 
-    Gdiplus::ImageCodecInfo* pImageCodecInfo = (Gdiplus::ImageCodecInfo*)malloc(size);
-    if (pImageCodecInfo == NULL)
-        return -1; // Failure
+    double megapixels = static_cast<double>(frame.width) * frame.height / 1e6;
+    std::vector<uint8_t> pixels;
+    std::vector<uint8_t> encoded;
 
-    GetImageEncoders(num, size, pImageCodecInfo);
+    // Largest factor first: the smallest thumbnail is the one browsed most
+    std::vector<int> factors = thumbnailFactors;
+    std::sort(factors.rbegin(), factors.rend());
 
-    for (UINT i = 0; i < num; ++i) {
-        if (wcscmp(pImageCodecInfo[i].MimeType, format) == 0) {
-            *pClsid = pImageCodecInfo[i].Clsid;
-            free(pImageCodecInfo);
-            return i; // Success
+    for (int factor : factors) {
+        auto start = std::chrono::steady_clock::now();
+        Frame thumbnail;
+        if (!ImageEncoder::downscale(frame, factor, pixels, thumbnail)) {
+            continue;
+        }
+        auto scaled = std::chrono::steady_clock::now();
+        double scaleMs = std::chrono::duration<double, std::milli>(scaled - start).count();
+
+        std::string path = basePath + "_thumb" + std::to_string(factor) + ImageEncoder::extensionFor(format);
+        if (!ImageEncoder::encode(thumbnail, format, encoded, pngOptions, jpegQuality) ||
+            !ImageEncoder::writeFile(path, encoded)) {
+            std::cerr << "Failed to save thumbnail: " << path << std::endl;
+            continue;
         }
-    }
-
-    free(pImageCodecInfo);
-    return -1; // Failure
-}
-#endif
 
-void ScreenCapture::createTempFrameDirectory() {
-    // Create temporary directory for frame storage
-    std::filesystem::create_directories(tempFrameDir);
-}
+        elapsedMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        paths.push_back(path);
 
-void ScreenCapture::cleanupTempFiles() {
-    // Remove all temporary frame files
-    for (const auto& frameFile : capturedFrameFiles) {
-        std::filesystem::remove(frameFile);
+        std::cout << "Saved thumbnail 1/" << factor << ": " << path << " (" << encoded.size() << " bytes, downscaled in "
+                  << scaleMs << " ms, " << (megapixels > 0 ? scaleMs / megapixels : 0.0) << " ms/MP)" << std::endl;
     }
 
-    // Remove the temporary directory
-    std::filesystem::remove_all(tempFrameDir);
+    return paths;
 }
 
-void ScreenCapture::encodeVideoWithExternalFFmpeg() {
-    if (capturedFrameFiles.empty()) {
-        return;
+#ifdef _WIN32
+std::string ScreenCapture::captureScreenWindows(ScreenshotQuality quality, bool skipDuplicates) {
+    // Shares the recording pool; a screenshot waits briefly for a buffer rather than allocating one
+    PooledFrame buffer = ensureFramePool() ? framePool.acquire(kScreenshotBufferWait) : PooledFrame();
+    if (!buffer) {
+        std::cerr << "No free frame buffer for screenshot" << std::endl;
+        return "";
     }
 
-    // Build the FFmpeg command to create the video from captured frames
-    std::string ffmpegCmd = "ffmpeg -y -framerate 30 -i \"" + tempFrameDir + "/frame_%06d.bmp\" -c:v libx264 -pix_fmt yuv420p -preset medium -crf 23 \"" + outputFile + "\"";
-
-    // Execute the command
-    int result = system(ffmpegCmd.c_str());
-
-    if (result == 0) {
-        std::cout << "Successfully created video: " << outputFile << std::endl;
-    } else {
-        std::cerr << "Failed to create video using FFmpeg" << std::endl;
+    if (!grabFrame(buffer)) {
+        return "";
     }
+
+    return saveScreenshot(buffer.frame(), quality, skipDuplicates);
 }
+#endif
 
 #ifdef __linux__
-std::string ScreenCapture::captureScreenLinux() {
-    // Placeholder for Linux implementation
-    auto now = std::chrono::system_clock::now();
-    auto time_t = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
+std::string ScreenCapture::captureScreenLinux(ScreenshotQuality quality, bool skipDuplicates) {
+    // Only the grab and the copy out of the monitor images hold captureMutex; hashing, thumbnails,
+    // encoding and the file write run after it is released, so the recording loop isn't held up.
+    // Screenshots still run one at a time since they share stitchBuffer.
+    std::lock_guard<std::mutex> screenshotLock(screenshotMutex);
+    std::vector<MonitorInfo> monitors;
+    int width = 0;
+    int height = 0;
+    {
+        std::lock_guard<std::mutex> lock(captureMutex);
+        if (!monitorCapture) {
+            std::cerr << "Failed to capture screen (Linux)" << std::endl;
+            return "";
+        }
+        monitorCapture->refreshIfChanged();
+        if (!monitorCapture->grabAll(monitorFrames)) {
+            std::cerr << "Failed to capture screen (Linux)" << std::endl;
+            return "";
+        }
 
-    std::stringstream filename;
-    filename << "screenshot_" << time_t << "_" << ms.count() << ".png";
+        std::cout << "Grabbed " << monitorFrames.size() << " monitor(s) (Linux) in "
+                  << monitorCapture->getLastGrabLatencyMs() << " ms (avg "
+                  << monitorCapture->getAverageGrabLatencyMs() << " ms)" << std::endl;
 
-    std::cout << "Captured screenshot (Linux): " << filename.str() << std::endl;
+        monitors = monitorCapture->getMonitors();
+        width = monitorCapture->getWidth();
+        height = monitorCapture->getHeight();
+        stitchBuffer.resize(static_cast<size_t>(width) * height * 4);
+        monitorCapture->stitch(monitorFrames, stitchBuffer.data(), width, height, width * 4);
+    }
 
-    if (screenshotCallback) {
-        screenshotCallback(filename.str());
+    Frame stitched;
+    stitched.data = stitchBuffer.data();
+    stitched.width = width;
+    stitched.height = height;
+    stitched.stride = width * 4;
+    stitched.format = PixelFormat::BGRA;
+
+    if (monitorOutputMode == MonitorOutputMode::PerMonitor && monitors.size() > 1) {
+        // Each monitor is its own region of the stitched copy
+        // Return the primary monitor's file; getLastScreenshotPaths() lists all of them
+        std::string primaryPath;
+        for (const MonitorInfo& monitor : monitors) {
+            Frame region = stitched;
+            region.data = stitchBuffer.data() + static_cast<size_t>(stitched.stride) * monitor.y +
+                          static_cast<size_t>(monitor.x) * 4;
+            region.width = std::min(monitor.width, width - monitor.x);
+            region.height = std::min(monitor.height, height - monitor.y);
+            if (region.width <= 0 || region.height <= 0) {
+                continue;
+            }
+            std::string path = saveScreenshot(region, quality, skipDuplicates, "_" + monitor.name);
+            if (!path.empty() && (primaryPath.empty() || monitor.primary)) {
+                primaryPath = path;
+            }
+        }
+        return primaryPath;
     }
 
-    return filename.str();
+    return saveScreenshot(stitched, quality, skipDuplicates);
 }
 #endif
 
 #ifdef __APPLE__
-std::string ScreenCapture::captureScreenMac() {
+std::string ScreenCapture::captureScreenMac(ScreenshotQuality) {
     // Placeholder for macOS implementation
     auto now = std::chrono::system_clock::now();
     auto time_t = std::chrono::system_clock::to_time_t(now);
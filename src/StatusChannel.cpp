@@ -0,0 +1,95 @@
+#include "StatusChannel.h"
+#include "UiNotifier.h"
+
+StatusChannel::StatusChannel(size_t capacity) : enqueuePosition(0), dequeuePosition(0), dropped(0) {
+    size_t size = 2;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+
+    // A cell is free for the producer whose position equals its sequence
+    for (size_t i = 0; i < size; i++) {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool StatusChannel::post(StatusEvent event) {
+    // A full ring gives up its oldest event, so the newest status always gets through
+    while (!tryPush(event)) {
+        StatusEvent oldest;
+        if (tryTake(oldest)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    UiNotifier::requestRedraw();
+    return true;
+}
+
+bool StatusChannel::tryPush(StatusEvent& event) {
+    size_t position = enqueuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[position & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            // Claim the slot; on failure `position` is reloaded and we retry
+            if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The slot a lap back hasn't been taken yet: full
+            return false;
+        } else {
+            position = enqueuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->event = std::move(event);
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+}
+
+bool StatusChannel::tryTake(StatusEvent& event) {
+    size_t position = dequeuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+        cell = &cells[position & mask];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+        if (difference == 0) {
+            // The consumer and producers evicting the oldest event race for it
+            if (dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // Not written yet: empty
+            return false;
+        } else {
+            position = dequeuePosition.load(std::memory_order_relaxed);
+        }
+    }
+
+    event = std::move(cell->event);
+    // Hand the slot back to producers one lap later
+    cell->sequence.store(position + mask + 1, std::memory_order_release);
+    return true;
+}
+
+bool StatusChannel::post(StatusKind kind, const std::string& text, float progress) {
+    StatusEvent event;
+    event.kind = kind;
+    event.text = text;
+    event.progress = progress;
+    return post(std::move(event));
+}
+
+bool StatusChannel::poll(StatusEvent& event) {
+    return tryTake(event);
+}
+
+uint64_t StatusChannel::getDroppedCount() const {
+    return dropped.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,127 @@
+#include "TelemetrySampler.h"
+#include "UserActivity.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#elif __linux__
+#include <unistd.h>
+#include <cstdio>
+#endif
+
+#include <ctime>
+#include <atomic>
+
+namespace {
+uint64_t residentSetBytes() {
+#ifdef __linux__
+    // Second field of statm is the resident page count
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    unsigned long long sizePages = 0;
+    unsigned long long residentPages = 0;
+    int fields = std::fscanf(file, "%llu %llu", &sizePages, &residentPages);
+    std::fclose(file);
+    return fields == 2 ? residentPages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// CPU time used by all our threads
+double processCpuSeconds() {
+#ifdef _WIN32
+    // std::clock is wall time on Windows
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER kernelTime = {{kernel.dwLowDateTime, kernel.dwHighDateTime}};
+    ULARGE_INTEGER userTime = {{user.dwLowDateTime, user.dwHighDateTime}};
+    return (kernelTime.QuadPart + userTime.QuadPart) / 1e7;
+#else
+    return static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+#endif
+}
+
+double perSecond(unsigned long long current, unsigned long long previous, double seconds) {
+    // Counters reset when an interface goes away; skip that interval instead of reporting garbage
+    return current >= previous && seconds > 0.0 ? (current - previous) / seconds : 0.0;
+}
+}
+
+TelemetrySampler::TelemetrySampler()
+    : snapshot(std::make_shared<TelemetrySnapshot>()), firstSampleTask(0), periodicTask(0), lastCpuSeconds(0.0) {}
+
+TelemetrySampler::~TelemetrySampler() {
+    stop();
+}
+
+void TelemetrySampler::start(std::chrono::milliseconds interval) {
+    stop();
+    firstSampleTask = Scheduler::shared().scheduleOnce(std::chrono::milliseconds(0), [this]() { sample(); });
+    periodicTask = Scheduler::shared().schedulePeriodic(interval, [this]() { sample(); });
+}
+
+void TelemetrySampler::stop() {
+    // Wait out a sample in progress; it uses this object
+    Scheduler::shared().cancel(firstSampleTask, true);
+    Scheduler::shared().cancel(periodicTask, true);
+    firstSampleTask = 0;
+    periodicTask = 0;
+}
+
+std::shared_ptr<const TelemetrySnapshot> TelemetrySampler::latest() const {
+    return std::atomic_load_explicit(&snapshot, std::memory_order_acquire);
+}
+
+const TimeSeries& TelemetrySampler::history(TelemetryMetric metric) const {
+    return series[static_cast<int>(metric)];
+}
+
+const char* TelemetrySampler::metricName(TelemetryMetric metric) {
+    switch (metric) {
+        case TelemetryMetric::SendRate: return "Sent";
+        case TelemetryMetric::ReceiveRate: return "Received";
+        case TelemetryMetric::ProcessCpu: return "Agent CPU";
+        default: return "Unknown";
+    }
+}
+
+void TelemetrySampler::sample() {
+    // Created here so an X connection is only opened on the sampler thread
+    if (!activity) {
+        activity = std::make_unique<UserActivity>();
+        network = std::make_unique<NetworkMonitor>();
+    }
+
+    std::shared_ptr<const TelemetrySnapshot> previous = latest();
+    auto next = std::make_shared<TelemetrySnapshot>();
+    next->sequence = previous->sequence + 1;
+    next->sampledAt = std::chrono::steady_clock::now();
+
+    next->network = network->getNetworkUsage();
+    next->idleMs = activity->getIdleTimeMs();
+    next->screenLocked = activity->isScreenLocked();
+    next->residentBytes = residentSetBytes();
+
+    double cpuSeconds = processCpuSeconds();
+    if (previous->sequence > 0) {
+        double seconds = std::chrono::duration<double>(next->sampledAt - previous->sampledAt).count();
+        next->sendBytesPerSecond = perSecond(next->network.bytesSent, previous->network.bytesSent, seconds);
+        next->receiveBytesPerSecond = perSecond(next->network.bytesReceived, previous->network.bytesReceived, seconds);
+        if (seconds > 0.0) {
+            next->processCpuPercent = 100.0 * (cpuSeconds - lastCpuSeconds) / seconds;
+        }
+
+        // Rates need two samples, so history starts with the second one
+        series[static_cast<int>(TelemetryMetric::SendRate)].add(next->sendBytesPerSecond, next->sampledAt);
+        series[static_cast<int>(TelemetryMetric::ReceiveRate)].add(next->receiveBytesPerSecond, next->sampledAt);
+        series[static_cast<int>(TelemetryMetric::ProcessCpu)].add(next->processCpuPercent, next->sampledAt);
+    }
+    lastCpuSeconds = cpuSeconds;
+
+    std::atomic_store_explicit(&snapshot, std::shared_ptr<const TelemetrySnapshot>(std::move(next)),
+                               std::memory_order_release);
+}
@@ -0,0 +1,17 @@
+#include "ThreadName.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <cstring>
+#endif
+
+void setCurrentThreadName(const char* name) {
+#ifdef __linux__
+    char truncated[16];
+    std::strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = '\0';
+    pthread_setname_np(pthread_self(), truncated);
+#else
+    (void)name;
+#endif
+}
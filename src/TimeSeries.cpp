@@ -0,0 +1,75 @@
+#include "TimeSeries.h"
+
+#include <algorithm>
+
+namespace {
+const size_t kSecondBuckets = 600; // 10 minutes
+const size_t kMinuteBuckets = 1440; // 24 hours
+}
+
+TimeSeries::TimeSeries() {
+    seconds.bucketDuration = std::chrono::seconds(1);
+    seconds.buckets.resize(kSecondBuckets);
+    minutes.bucketDuration = std::chrono::seconds(60);
+    minutes.buckets.resize(kMinuteBuckets);
+}
+
+size_t TimeSeries::capacity(SeriesResolution resolution) {
+    return resolution == SeriesResolution::Second ? kSecondBuckets : kMinuteBuckets;
+}
+
+int64_t TimeSeries::slotOf(const Ring& ring, std::chrono::steady_clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::seconds>(time.time_since_epoch()).count() /
+           ring.bucketDuration.count();
+}
+
+const TimeSeries::Ring& TimeSeries::ring(SeriesResolution resolution) const {
+    return resolution == SeriesResolution::Second ? seconds : minutes;
+}
+
+void TimeSeries::add(double value, std::chrono::steady_clock::time_point time) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Ring* target : {&seconds, &minutes}) {
+        int64_t slot = slotOf(*target, time);
+        Bucket& bucket = target->buckets[static_cast<size_t>(slot) % target->buckets.size()];
+        if (bucket.slot != slot) {
+            // Left over from a previous lap (or never used): start the bucket afresh
+            bucket = Bucket();
+            bucket.slot = slot;
+            bucket.min = bucket.max = static_cast<float>(value);
+        }
+        bucket.min = std::min(bucket.min, static_cast<float>(value));
+        bucket.max = std::max(bucket.max, static_cast<float>(value));
+        bucket.sum += value;
+        bucket.count++;
+    }
+}
+
+size_t TimeSeries::read(SeriesResolution resolution, SeriesAggregate aggregate, std::vector<float>& values,
+                        std::chrono::steady_clock::time_point now) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Ring& source = ring(resolution);
+    const size_t size = source.buckets.size();
+    values.assign(size, 0.0f);
+
+    int64_t newest = slotOf(source, now);
+    size_t filled = 0;
+    for (size_t i = 0; i < size; i++) {
+        int64_t slot = newest - static_cast<int64_t>(size - 1 - i);
+        if (slot < 0) {
+            continue;
+        }
+        const Bucket& bucket = source.buckets[static_cast<size_t>(slot) % size];
+        if (bucket.slot != slot || bucket.count == 0) {
+            continue;
+        }
+
+        switch (aggregate) {
+            case SeriesAggregate::Min: values[i] = bucket.min; break;
+            case SeriesAggregate::Max: values[i] = bucket.max; break;
+            case SeriesAggregate::Average: values[i] = static_cast<float>(bucket.sum / bucket.count); break;
+        }
+        filled++;
+    }
+    return filled;
+}
@@ -0,0 +1,27 @@
+#include "UiNotifier.h"
+
+#include <atomic>
+
+namespace {
+std::atomic<void (*)()> redrawHandler(nullptr);
+std::atomic<bool> redrawPending(false);
+}
+
+void UiNotifier::setHandler(void (*handler)()) {
+    redrawHandler.store(handler, std::memory_order_release);
+}
+
+void UiNotifier::requestRedraw() {
+    // Only the first request after the UI thread last looked needs to wake it
+    if (redrawPending.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    void (*handler)() = redrawHandler.load(std::memory_order_acquire);
+    if (handler) {
+        handler();
+    }
+}
+
+bool UiNotifier::takeRequest() {
+    return redrawPending.exchange(false, std::memory_order_acq_rel);
+}
@@ -4,9 +4,13 @@
 #include <windows.h>
 #include <winuser.h>
 #elif __linux__
+#include "X11ErrorHandler.h"
 #include <X11/Xlib.h>
 #include <X11/extensions/record.h>
 #include <X11/keysym.h>
+#ifdef HAVE_XSS
+#include <X11/extensions/scrnsaver.h>
+#endif
 #elif __APPLE__
 #include <IOKit/IOKitLib.h>
 #include <IOKit/hidsystem/IOHIDLib.h>
@@ -17,20 +21,26 @@
 #include <thread>
 
 UserActivity::UserActivity() {
+#ifdef __linux__
+    display = nullptr;
+#endif
     resetIdleTimer();
 }
 
-UserActivity::~UserActivity() = default;
+UserActivity::~UserActivity() {
+#ifdef __linux__
+    if (display) {
+        X11ErrorHandler::forget(display);
+        XCloseDisplay(display);
+    }
+#endif
+}
 
 bool UserActivity::isUserIdle(int idleThresholdSeconds) {
 #ifdef _WIN32
     return isUserIdleWindows(idleThresholdSeconds);
 #else
-    // For other platforms, use the timer-based approach
-    auto now = std::chrono::steady_clock::now();
-    auto idleDuration = std::chrono::duration_cast<std::chrono::seconds>(now - lastActivityTime);
-
-    return idleDuration.count() > idleThresholdSeconds;
+    return getIdleTimeMs() / 1000 > idleThresholdSeconds;
 #endif
 }
 
@@ -38,10 +48,63 @@ int UserActivity::getIdleTimeSeconds() {
 #ifdef _WIN32
     return getIdleTimeSecondsWindows();
 #else
-    auto now = std::chrono::steady_clock::now();
-    auto idleDuration = std::chrono::duration_cast<std::chrono::seconds>(now - lastActivityTime);
+    return static_cast<int>(getIdleTimeMs() / 1000);
+#endif
+}
 
-    return static_cast<int>(idleDuration.count());
+int64_t UserActivity::getIdleTimeMs() {
+#ifdef _WIN32
+    LASTINPUTINFO lii;
+    lii.cbSize = sizeof(LASTINPUTINFO);
+    if (GetLastInputInfo(&lii)) {
+        return static_cast<int64_t>(GetTickCount() - lii.dwTime);
+    }
+#elif defined(__linux__) && defined(HAVE_XSS)
+    // The X server tracks input for every client, not just our window
+    if (!display) {
+        X11ErrorHandler::install();
+        display = XOpenDisplay(nullptr);
+    }
+    int eventBase = 0;
+    int errorBase = 0;
+    if (display && XScreenSaverQueryExtension(display, &eventBase, &errorBase)) {
+        XScreenSaverInfo info;
+        if (XScreenSaverQueryInfo(display, DefaultRootWindow(display), &info)) {
+            return static_cast<int64_t>(info.idle);
+        }
+    }
+#endif
+    // Fall back to the timer reset through resetIdleTimer()
+    auto idleDuration = std::chrono::steady_clock::now() - lastActivityTime;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(idleDuration).count();
+}
+
+bool UserActivity::isScreenLocked() {
+#ifdef _WIN32
+    // The input desktop is the secure Winlogon desktop while locked, and we can't switch to it
+    HDESK desktop = OpenInputDesktop(0, FALSE, DESKTOP_SWITCHDESKTOP);
+    if (!desktop) {
+        return true;
+    }
+    BOOL switched = SwitchDesktop(desktop);
+    CloseDesktop(desktop);
+    return !switched;
+#elif defined(__linux__) && defined(HAVE_XSS)
+    if (!display) {
+        X11ErrorHandler::install();
+        display = XOpenDisplay(nullptr);
+    }
+    int eventBase = 0;
+    int errorBase = 0;
+    if (display && XScreenSaverQueryExtension(display, &eventBase, &errorBase)) {
+        XScreenSaverInfo info;
+        if (XScreenSaverQueryInfo(display, DefaultRootWindow(display), &info)) {
+            return info.state == ScreenSaverOn;
+        }
+    }
+    return false;
+#else
+    return false;
 #endif
 }
 
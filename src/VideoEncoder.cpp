@@ -0,0 +1,433 @@
+#include "VideoEncoder.h"
+#include "ImageEncoder.h"
+#include "LatencyHistogram.h"
+
+#include <iostream>
+#include <chrono>
+
+#ifdef WITH_FFMPEG
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/imgutils.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+const char* VideoEncoder::codecName(VideoCodec codec) {
+    switch (codec) {
+        case VideoCodec::H264: return "H.264";
+        case VideoCodec::VP9: return "VP9";
+        case VideoCodec::AV1: return "AV1";
+    }
+    return "unknown";
+}
+
+#ifdef WITH_FFMPEG
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace {
+// CPU time consumed by the whole process (encoder worker threads included)
+double processCpuMs() {
+#ifdef _WIN32
+    FILETIME creationTime, exitTime, kernelTime, userTime;
+    if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return 0.0;
+    }
+    ULARGE_INTEGER kernel, user;
+    kernel.LowPart = kernelTime.dwLowDateTime;
+    kernel.HighPart = kernelTime.dwHighDateTime;
+    user.LowPart = userTime.dwLowDateTime;
+    user.HighPart = userTime.dwHighDateTime;
+    return (kernel.QuadPart + user.QuadPart) / 10000.0; // 100ns units
+#else
+    timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+}
+
+class VideoEncoder::Impl {
+public:
+    AVFormatContext* formatContext = nullptr;
+    AVCodecContext* codecContext = nullptr;
+    AVStream* stream = nullptr;
+    AVFrame* frame = nullptr;
+    AVPacket* packet = nullptr;
+    SwsContext* swsContext = nullptr;
+    int64_t lastPts = -1;
+    EncoderStats stats;
+
+    // Segmented output: packets keep going to the current file until the forced keyframe arrives
+    std::string currentPath;
+    std::string pendingSegmentPath;
+    int64_t segmentStartPts = -1;
+    bool keyframeRequested = false;
+    std::function<void(const std::string&)> segmentCallback;
+
+    // A failed segment switch leaves the codec, frame and packet without a muxer, where
+    // isOpen() is false and ~VideoEncoder skips close()
+    ~Impl() {
+        release();
+    }
+
+    const AVCodec* findEncoder(VideoCodec codec) {
+        // Prefer the well-known software encoders, then anything registered for the codec id
+        const char* preferred[3] = {nullptr, nullptr, nullptr};
+        AVCodecID codecId = AV_CODEC_ID_H264;
+        switch (codec) {
+            case VideoCodec::H264:
+                preferred[0] = "libx264";
+                codecId = AV_CODEC_ID_H264;
+                break;
+            case VideoCodec::VP9:
+                preferred[0] = "libvpx-vp9";
+                codecId = AV_CODEC_ID_VP9;
+                break;
+            case VideoCodec::AV1:
+                preferred[0] = "libsvtav1";
+                preferred[1] = "libaom-av1";
+                codecId = AV_CODEC_ID_AV1;
+                break;
+        }
+
+        for (const char* name : preferred) {
+            if (!name) break;
+            if (const AVCodec* found = avcodec_find_encoder_by_name(name)) {
+                return found;
+            }
+        }
+        return avcodec_find_encoder(codecId);
+    }
+
+    void applyRealtimeOptions(VideoCodec codec) {
+        // Favour speed: this runs alongside the user's normal work
+        switch (codec) {
+            case VideoCodec::H264:
+                av_opt_set(codecContext->priv_data, "preset", "ultrafast", 0);
+                av_opt_set(codecContext->priv_data, "crf", "23", 0);
+                break;
+            case VideoCodec::VP9:
+                av_opt_set(codecContext->priv_data, "deadline", "realtime", 0);
+                av_opt_set(codecContext->priv_data, "cpu-used", "8", 0);
+                av_opt_set(codecContext->priv_data, "crf", "35", 0);
+                break;
+            case VideoCodec::AV1:
+                av_opt_set(codecContext->priv_data, "preset", "10", 0);   // libsvtav1
+                av_opt_set(codecContext->priv_data, "cpu-used", "8", 0); // libaom-av1
+                av_opt_set(codecContext->priv_data, "crf", "35", 0);
+                break;
+        }
+    }
+
+    // Create a container for `path` carrying the already-open encoder's stream
+    bool openMuxer(const std::string& path) {
+        if (avformat_alloc_output_context2(&formatContext, nullptr, nullptr, path.c_str()) < 0 || !formatContext) {
+            std::cerr << "Could not create output context for " << path << std::endl;
+            formatContext = nullptr;
+            return false;
+        }
+
+        stream = avformat_new_stream(formatContext, nullptr);
+        if (!stream) {
+            freeMuxer();
+            return false;
+        }
+        stream->time_base = codecContext->time_base;
+        avcodec_parameters_from_context(stream->codecpar, codecContext);
+
+        if (!(formatContext->oformat->flags & AVFMT_NOFILE)) {
+            if (avio_open(&formatContext->pb, path.c_str(), AVIO_FLAG_WRITE) < 0) {
+                std::cerr << "Could not open output file: " << path << std::endl;
+                freeMuxer();
+                return false;
+            }
+        }
+
+        if (avformat_write_header(formatContext, nullptr) < 0) {
+            std::cerr << "Could not write container header" << std::endl;
+            freeMuxer();
+            return false;
+        }
+
+        currentPath = path;
+        return true;
+    }
+
+    bool closeMuxer() {
+        bool ok = av_write_trailer(formatContext) >= 0;
+        if (!ok) {
+            std::cerr << "Could not write container trailer" << std::endl;
+        }
+        freeMuxer();
+
+        if (ok && segmentCallback) {
+            segmentCallback(currentPath);
+        }
+        return ok;
+    }
+
+    void freeMuxer() {
+        if (formatContext) {
+            if (!(formatContext->oformat->flags & AVFMT_NOFILE) && formatContext->pb) {
+                avio_closep(&formatContext->pb);
+            }
+            avformat_free_context(formatContext);
+            formatContext = nullptr;
+        }
+        stream = nullptr;
+    }
+
+    bool writePackets() {
+        while (true) {
+            int ret = avcodec_receive_packet(codecContext, packet);
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                return true;
+            }
+            if (ret < 0) {
+                std::cerr << "Error receiving packet from encoder" << std::endl;
+                return false;
+            }
+
+            // Switch files on the forced keyframe so the new segment starts decodable
+            if (!pendingSegmentPath.empty() && (packet->flags & AV_PKT_FLAG_KEY) && packet->pts >= segmentStartPts) {
+                std::string nextPath = pendingSegmentPath;
+                pendingSegmentPath.clear();
+                closeMuxer();
+                if (!openMuxer(nextPath)) {
+                    av_packet_unref(packet);
+                    return false;
+                }
+            }
+
+            av_packet_rescale_ts(packet, codecContext->time_base, stream->time_base);
+            packet->stream_index = stream->index;
+            stats.bytesWritten += packet->size;
+
+            if (av_interleaved_write_frame(formatContext, packet) < 0) {
+                std::cerr << "Error writing encoded packet" << std::endl;
+                av_packet_unref(packet);
+                return false;
+            }
+        }
+    }
+
+    void release() {
+        if (swsContext) {
+            sws_freeContext(swsContext);
+            swsContext = nullptr;
+        }
+        if (frame) {
+            av_frame_free(&frame);
+        }
+        if (packet) {
+            av_packet_free(&packet);
+        }
+        if (codecContext) {
+            avcodec_free_context(&codecContext);
+        }
+        freeMuxer();
+        pendingSegmentPath.clear();
+        keyframeRequested = false;
+    }
+};
+
+VideoEncoder::VideoEncoder() : pImpl(std::make_unique<Impl>()) {}
+
+VideoEncoder::~VideoEncoder() {
+    if (isOpen()) {
+        close();
+    }
+}
+
+bool VideoEncoder::open(const std::string& outputPath, int width, int height, int frameRate, VideoCodec codec) {
+    if (isOpen()) {
+        std::cerr << "Encoder is already open" << std::endl;
+        return false;
+    }
+
+    const AVCodec* encoder = pImpl->findEncoder(codec);
+    if (!encoder) {
+        std::cerr << "No " << codecName(codec) << " encoder available in this FFmpeg build" << std::endl;
+        return false;
+    }
+
+    const AVOutputFormat* outputFormat = av_guess_format(nullptr, outputPath.c_str(), nullptr);
+    if (!outputFormat) {
+        std::cerr << "Could not pick a container for " << outputPath << std::endl;
+        return false;
+    }
+
+    pImpl->codecContext = avcodec_alloc_context3(encoder);
+    if (!pImpl->codecContext) {
+        pImpl->release();
+        return false;
+    }
+
+    // 4:2:0 subsampling needs even dimensions; drop the odd row/column
+    pImpl->codecContext->width = width & ~1;
+    pImpl->codecContext->height = height & ~1;
+    pImpl->codecContext->pix_fmt = AV_PIX_FMT_YUV420P;
+    // Millisecond timestamps so dropped or delayed frames keep correct timing
+    pImpl->codecContext->time_base = AVRational{1, 1000};
+    pImpl->codecContext->framerate = AVRational{frameRate, 1};
+    pImpl->codecContext->gop_size = frameRate * 2;
+    if (outputFormat->flags & AVFMT_GLOBALHEADER) {
+        pImpl->codecContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+    }
+    pImpl->applyRealtimeOptions(codec);
+
+    if (avcodec_open2(pImpl->codecContext, encoder, nullptr) < 0) {
+        std::cerr << "Could not open " << encoder->name << " encoder" << std::endl;
+        pImpl->release();
+        return false;
+    }
+
+    if (!pImpl->openMuxer(outputPath)) {
+        pImpl->release();
+        return false;
+    }
+
+    pImpl->frame = av_frame_alloc();
+    pImpl->packet = av_packet_alloc();
+    if (!pImpl->frame || !pImpl->packet) {
+        pImpl->release();
+        return false;
+    }
+    pImpl->frame->format = pImpl->codecContext->pix_fmt;
+    pImpl->frame->width = pImpl->codecContext->width;
+    pImpl->frame->height = pImpl->codecContext->height;
+    if (av_frame_get_buffer(pImpl->frame, 0) < 0) {
+        pImpl->release();
+        return false;
+    }
+
+    pImpl->lastPts = -1;
+    pImpl->stats = EncoderStats();
+
+    std::cout << "Encoding " << pImpl->codecContext->width << "x" << pImpl->codecContext->height
+              << " with " << encoder->name << " to " << outputPath << std::endl;
+    return true;
+}
+
+bool VideoEncoder::encodeFrame(const Frame& frame, int64_t timestampMs) {
+    if (!isOpen()) {
+        return false;
+    }
+
+    // Timestamps must be strictly increasing
+    if (timestampMs <= pImpl->lastPts) {
+        timestampMs = pImpl->lastPts + 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    double cpuStart = processCpuMs();
+
+    // The encoder may still reference the previous frame's buffers
+    if (av_frame_make_writable(pImpl->frame) < 0) {
+        return false;
+    }
+
+    auto convertStart = std::chrono::steady_clock::now();
+    if (frame.format == PixelFormat::BGRA) {
+        // Captured frames take the SIMD converter straight into the encoder's planes
+        Frame view = frame;
+        view.width = pImpl->codecContext->width;
+        view.height = pImpl->codecContext->height;
+        if (!ImageEncoder::convertToYuv420(view, YuvLayout::I420,
+                                           pImpl->frame->data[0], pImpl->frame->linesize[0],
+                                           pImpl->frame->data[1], pImpl->frame->linesize[1],
+                                           pImpl->frame->data[2], pImpl->frame->linesize[2])) {
+            return false;
+        }
+    } else {
+        AVPixelFormat sourceFormat = frame.format == PixelFormat::BGR ? AV_PIX_FMT_BGR24 : AV_PIX_FMT_RGB24;
+        pImpl->swsContext = sws_getCachedContext(pImpl->swsContext,
+            pImpl->codecContext->width, pImpl->codecContext->height, sourceFormat,
+            pImpl->codecContext->width, pImpl->codecContext->height, AV_PIX_FMT_YUV420P,
+            SWS_BILINEAR, nullptr, nullptr, nullptr);
+        if (!pImpl->swsContext) {
+            std::cerr << "Could not create colour conversion context" << std::endl;
+            return false;
+        }
+
+        const uint8_t* sourceData[1] = {frame.data};
+        int sourceStride[1] = {frame.stride};
+        sws_scale(pImpl->swsContext, sourceData, sourceStride, 0, pImpl->codecContext->height,
+                  pImpl->frame->data, pImpl->frame->linesize);
+    }
+    PipelineLatency::stage(PipelineStage::Convert).recordSince(convertStart);
+
+    pImpl->frame->pts = timestampMs;
+    pImpl->lastPts = timestampMs;
+
+    if (pImpl->keyframeRequested) {
+        pImpl->frame->pict_type = AV_PICTURE_TYPE_I;
+        pImpl->segmentStartPts = timestampMs;
+        pImpl->keyframeRequested = false;
+    }
+
+    bool ok = avcodec_send_frame(pImpl->codecContext, pImpl->frame) >= 0 && pImpl->writePackets();
+    pImpl->frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    pImpl->stats.lastEncodeMs = elapsedMs;
+    pImpl->stats.totalEncodeMs += elapsedMs;
+    pImpl->stats.totalCpuMs += processCpuMs() - cpuStart;
+    pImpl->stats.framesEncoded++;
+
+    return ok;
+}
+
+bool VideoEncoder::close() {
+    if (!isOpen()) {
+        // Still holding an encoder here means the last segment switch failed
+        bool failedSwitch = pImpl->codecContext != nullptr;
+        pImpl->release();
+        return !failedSwitch;
+    }
+
+    // Drain delayed frames before writing the trailer
+    bool ok = avcodec_send_frame(pImpl->codecContext, nullptr) >= 0 && pImpl->writePackets();
+    if (pImpl->formatContext && !pImpl->closeMuxer()) {
+        ok = false;
+    }
+
+    pImpl->release();
+    return ok;
+}
+
+bool VideoEncoder::startNewSegment(const std::string& nextPath) {
+    if (!isOpen()) {
+        return false;
+    }
+    if (!pImpl->pendingSegmentPath.empty()) {
+        std::cerr << "Previous segment switch still pending" << std::endl;
+        return false;
+    }
+
+    pImpl->pendingSegmentPath = nextPath;
+    pImpl->keyframeRequested = true;
+    return true;
+}
+
+void VideoEncoder::setSegmentCallback(std::function<void(const std::string&)> callback) {
+    pImpl->segmentCallback = callback;
+}
+
+bool VideoEncoder::isOpen() const {
+    return pImpl->codecContext != nullptr && pImpl->formatContext != nullptr;
+}
+
+EncoderStats VideoEncoder::getStats() const {
+    return pImpl->stats;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "X11ErrorHandler.h"
+
+#ifdef __linux__
+
+#include <X11/Xlib.h>
+
+#include <iostream>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+std::once_flag installFlag;
+std::mutex countsMutex;
+std::unordered_map<Display*, uint64_t> errorCounts;
+
+int handleError(Display* display, XErrorEvent* event) {
+    // Only local lookups here: the handler must not send requests
+    char description[128];
+    XGetErrorText(display, event->error_code, description, sizeof(description));
+    std::cerr << "X11 error: " << description << " (request " << static_cast<int>(event->request_code) << "."
+              << static_cast<int>(event->minor_code) << ", resource 0x" << std::hex << event->resourceid
+              << std::dec << ")" << std::endl;
+
+    std::lock_guard<std::mutex> lock(countsMutex);
+    errorCounts[display]++;
+    return 0;
+}
+}
+
+void X11ErrorHandler::install() {
+    std::call_once(installFlag, []() {
+        // Capture, damage tracking and the UI each use their own connection from their own
+        // thread, but Xlib's global state (and this handler) is shared between them
+        if (!XInitThreads()) {
+            std::cerr << "XInitThreads failed" << std::endl;
+        }
+        XSetErrorHandler(handleError);
+    });
+}
+
+uint64_t X11ErrorHandler::getErrorCount(Display* display) {
+    std::lock_guard<std::mutex> lock(countsMutex);
+    auto it = errorCounts.find(display);
+    return it == errorCounts.end() ? 0 : it->second;
+}
+
+void X11ErrorHandler::forget(Display* display) {
+    std::lock_guard<std::mutex> lock(countsMutex);
+    errorCounts.erase(display);
+}
+
+#endif
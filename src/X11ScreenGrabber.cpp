@@ -0,0 +1,282 @@
+#include "X11ScreenGrabber.h"
+
+#ifdef __linux__
+
+#include "X11ErrorHandler.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XShm.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+class X11ScreenGrabber::Impl {
+public:
+    Display* display = nullptr;
+    Window root = 0;
+    int originX = 0;
+    int originY = 0;
+    int width = 0;
+    int height = 0;
+
+    bool useSharedMemory = true;
+    bool shmActive = false;
+    XShmSegmentInfo shmInfo = {};
+    XImage* image = nullptr;
+
+    double lastLatencyMs = 0.0;
+    double totalLatencyMs = 0.0;
+    unsigned long long grabCount = 0;
+
+    bool createSharedImage() {
+        int screen = DefaultScreen(display);
+        image = XShmCreateImage(display, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                                ZPixmap, nullptr, &shmInfo, width, height);
+        if (!image) {
+            return false;
+        }
+
+        shmInfo.shmid = shmget(IPC_PRIVATE, image->bytes_per_line * image->height, IPC_CREAT | 0600);
+        if (shmInfo.shmid < 0) {
+            XDestroyImage(image);
+            image = nullptr;
+            return false;
+        }
+
+        shmInfo.shmaddr = image->data = static_cast<char*>(shmat(shmInfo.shmid, nullptr, 0));
+        if (shmInfo.shmaddr == reinterpret_cast<char*>(-1)) {
+            shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+            image->data = nullptr;
+            XDestroyImage(image);
+            image = nullptr;
+            return false;
+        }
+        shmInfo.readOnly = False;
+
+        // XShmAttach reports failure asynchronously; the sync brings any error in
+        uint64_t errorsBefore = X11ErrorHandler::getErrorCount(display);
+        XShmAttach(display, &shmInfo);
+        XSync(display, False);
+        bool attachFailed = X11ErrorHandler::getErrorCount(display) != errorsBefore;
+
+        // Mark for removal now; the segment lives until both sides detach
+        shmctl(shmInfo.shmid, IPC_RMID, nullptr);
+
+        if (attachFailed) {
+            shmdt(shmInfo.shmaddr);
+            image->data = nullptr;
+            XDestroyImage(image);
+            image = nullptr;
+            return false;
+        }
+
+        shmActive = true;
+        return true;
+    }
+
+    void destroyImage() {
+        if (!image) {
+            return;
+        }
+        if (shmActive) {
+            XShmDetach(display, &shmInfo);
+            XSync(display, False);
+            image->data = nullptr; // Not owned by Xlib
+            XDestroyImage(image);
+            shmdt(shmInfo.shmaddr);
+            shmActive = false;
+        } else {
+            XDestroyImage(image);
+        }
+        image = nullptr;
+    }
+
+    // Fails instead of exiting when the server rejects the request, e.g. a region that no
+    // longer fits the root window while a monitor is being unplugged
+    bool grabImage(int firstRow, int rowCount) {
+        uint64_t errorsBefore = X11ErrorHandler::getErrorCount(display);
+        bool ok = requestImage(firstRow, rowCount);
+        return ok && X11ErrorHandler::getErrorCount(display) == errorsBefore;
+    }
+
+    bool requestImage(int firstRow, int rowCount) {
+        if (shmActive) {
+            if (firstRow == 0 && rowCount == height) {
+                return XShmGetImage(display, root, image, originX, originY, AllPlanes);
+            }
+
+            // A band image over the same segment: the server writes those rows in place,
+            // using the full image's stride since the width is the same
+            int screen = DefaultScreen(display);
+            XImage* band = XShmCreateImage(display, DefaultVisual(display, screen), DefaultDepth(display, screen),
+                                           ZPixmap, image->data + static_cast<size_t>(firstRow) * image->bytes_per_line,
+                                           &shmInfo, width, rowCount);
+            if (!band) {
+                return false;
+            }
+            bool ok = XShmGetImage(display, root, band, originX, originY + firstRow, AllPlanes);
+            band->data = nullptr; // Part of the shared segment
+            XDestroyImage(band);
+            return ok;
+        }
+
+        // Plain path: the first grab allocates, later grabs reuse the same XImage
+        if (!image) {
+            image = XGetImage(display, root, originX, originY, width, height, AllPlanes, ZPixmap);
+            return image != nullptr;
+        }
+        return XGetSubImage(display, root, originX, originY + firstRow, width, rowCount, AllPlanes, ZPixmap,
+                            image, 0, firstRow) != nullptr;
+    }
+};
+
+X11ScreenGrabber::X11ScreenGrabber() : pImpl(std::make_unique<Impl>()) {}
+
+X11ScreenGrabber::~X11ScreenGrabber() {
+    close();
+}
+
+bool X11ScreenGrabber::open(const char* displayName) {
+    return open(displayName, 0, 0, 0, 0);
+}
+
+bool X11ScreenGrabber::open(const char* displayName, int x, int y, int width, int height) {
+    if (pImpl->display) {
+        return true;
+    }
+
+    X11ErrorHandler::install();
+    pImpl->display = XOpenDisplay(displayName);
+    if (!pImpl->display) {
+        std::cerr << "Failed to open X display" << std::endl;
+        return false;
+    }
+
+    pImpl->root = DefaultRootWindow(pImpl->display);
+
+    XWindowAttributes attributes;
+    XGetWindowAttributes(pImpl->display, pImpl->root, &attributes);
+
+    // A zero-sized region means the whole root window; otherwise clip the region to it
+    if (width <= 0 || height <= 0) {
+        x = 0;
+        y = 0;
+        width = attributes.width;
+        height = attributes.height;
+    }
+    pImpl->originX = std::max(0, std::min(x, attributes.width - 1));
+    pImpl->originY = std::max(0, std::min(y, attributes.height - 1));
+    pImpl->width = std::min(width, attributes.width - pImpl->originX);
+    pImpl->height = std::min(height, attributes.height - pImpl->originY);
+
+    if (pImpl->useSharedMemory && XShmQueryExtension(pImpl->display)) {
+        if (!pImpl->createSharedImage()) {
+            std::cerr << "MIT-SHM setup failed, falling back to XGetImage" << std::endl;
+        }
+    }
+
+    return true;
+}
+
+void X11ScreenGrabber::close() {
+    if (!pImpl->display) {
+        return;
+    }
+
+    pImpl->destroyImage();
+    X11ErrorHandler::forget(pImpl->display);
+    XCloseDisplay(pImpl->display);
+    pImpl->display = nullptr;
+}
+
+bool X11ScreenGrabber::isOpen() const {
+    return pImpl->display != nullptr;
+}
+
+void X11ScreenGrabber::setUseSharedMemory(bool enabled) {
+    if (pImpl->useSharedMemory == enabled) {
+        return;
+    }
+
+    pImpl->useSharedMemory = enabled;
+
+    // Rebuild the capture buffer for the new path
+    if (pImpl->display) {
+        pImpl->destroyImage();
+        if (enabled && XShmQueryExtension(pImpl->display)) {
+            pImpl->createSharedImage();
+        }
+    }
+}
+
+bool X11ScreenGrabber::isUsingSharedMemory() const {
+    return pImpl->shmActive;
+}
+
+bool X11ScreenGrabber::grab(Frame& frame) {
+    return grabRows(0, pImpl->height, frame);
+}
+
+bool X11ScreenGrabber::grabRows(int firstRow, int rowCount, Frame& frame) {
+    if (!pImpl->display) {
+        return false;
+    }
+
+    firstRow = std::max(0, firstRow);
+    rowCount = std::min(rowCount, pImpl->height - firstRow);
+    if (rowCount <= 0) {
+        return false;
+    }
+    // Nothing to update yet: the whole buffer has to be filled once
+    if (!pImpl->image) {
+        firstRow = 0;
+        rowCount = pImpl->height;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok = pImpl->grabImage(firstRow, rowCount);
+    auto end = std::chrono::steady_clock::now();
+
+    if (!ok || !pImpl->image) {
+        std::cerr << "Failed to grab X11 root window" << std::endl;
+        return false;
+    }
+
+    if (pImpl->image->bits_per_pixel != 32) {
+        std::cerr << "Unsupported X11 pixel depth: " << pImpl->image->bits_per_pixel << std::endl;
+        return false;
+    }
+
+    pImpl->lastLatencyMs = std::chrono::duration<double, std::milli>(end - start).count();
+    pImpl->totalLatencyMs += pImpl->lastLatencyMs;
+    pImpl->grabCount++;
+
+    frame.data = reinterpret_cast<const uint8_t*>(pImpl->image->data);
+    frame.width = pImpl->width;
+    frame.height = pImpl->height;
+    frame.stride = pImpl->image->bytes_per_line;
+    frame.format = PixelFormat::BGRA;
+    return true;
+}
+
+int X11ScreenGrabber::getWidth() const {
+    return pImpl->width;
+}
+
+int X11ScreenGrabber::getHeight() const {
+    return pImpl->height;
+}
+
+double X11ScreenGrabber::getLastGrabLatencyMs() const {
+    return pImpl->lastLatencyMs;
+}
+
+double X11ScreenGrabber::getAverageGrabLatencyMs() const {
+    return pImpl->grabCount ? pImpl->totalLatencyMs / pImpl->grabCount : 0.0;
+}
+
+#endif
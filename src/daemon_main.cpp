@@ -0,0 +1,52 @@
+#include "RemoteWorkerDaemon.h"
+#include "X11ErrorHandler.h"
+
+#include <unistd.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+namespace {
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--socket PATH] [--user USER_ID [--start]]\n"
+              << "  --socket PATH     control socket (default $XDG_RUNTIME_DIR/remote-worker.sock)\n"
+              << "  --user USER_ID    log in at startup instead of waiting for a login command\n"
+              << "  --start           start monitoring once that login succeeds\n"
+              << "Commands are sent one per line on the socket, e.g. echo status | nc -U PATH" << std::endl;
+}
+
+std::string defaultSocketPath() {
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/remote-worker.sock";
+    }
+    return "/tmp/remote-worker-" + std::to_string(getuid()) + ".sock";
+}
+}
+
+int main(int argc, char** argv) {
+    RemoteWorkerDaemon::Options options;
+    options.socketPath = defaultSocketPath();
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            options.socketPath = argv[++i];
+        } else if (std::strcmp(argv[i], "--user") == 0 && i + 1 < argc) {
+            options.userId = argv[++i];
+        } else if (std::strcmp(argv[i], "--start") == 0) {
+            options.startMonitoring = true;
+        } else {
+            printUsage(argv[0]);
+            return std::strcmp(argv[i], "--help") == 0 ? 0 : 2;
+        }
+    }
+
+#ifdef __linux__
+    X11ErrorHandler::install();
+#endif
+
+    RemoteWorkerDaemon daemon(options);
+    return daemon.run();
+}
@@ -1,4 +1,5 @@
 #include "RemoteWorkerApp.h"
+#include "X11ErrorHandler.h"
 
 #include "imgui.h"
 #include "backends/imgui_impl_glfw.h"
@@ -18,6 +19,11 @@
 #include <memory>
 
 int main(int, char**) {
+#ifdef __linux__
+    // Before GLFW opens its display
+    X11ErrorHandler::install();
+#endif
+
     RemoteWorkerApp app;
     app.run();
     return 0;
@@ -0,0 +1,149 @@
+// Process CPU while recording an idle and a busy desktop, with recording grabbing on a timer
+// and driven by XDamage. The busy desktop is a window this program repaints 60 times a second;
+// the painter thread's own CPU is subtracted. Encoding runs in-process with libav*, otherwise
+// in an ffmpeg child whose CPU is not counted.
+// Needs an X server, so CTest doesn't run it: xvfb-run -s "-screen 0 1920x1080x24" tests/CaptureCpuBenchmark
+// Usage: CaptureCpuBenchmark [--seconds N]
+
+#include "ScreenCapture.h"
+#include "TestSupport.h"
+
+#include <X11/Xlib.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace {
+
+int seconds = 10;
+
+double processCpuSeconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec +
+           (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+double threadCpuSeconds() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+// Repaints a window with a new colour every frame from its own connection
+class BusyPainter {
+public:
+    bool start() {
+        display = XOpenDisplay(nullptr);
+        if (!display) {
+            return false;
+        }
+        int screen = DefaultScreen(display);
+        window = XCreateSimpleWindow(display, RootWindow(display, screen), 0, 0, 800, 600, 0, 0, 0);
+        XMapWindow(display, window);
+        XSync(display, False);
+        running = true;
+        thread = std::thread([this, screen]() {
+            double cpuStart = threadCpuSeconds();
+            GC gc = DefaultGC(display, screen);
+            for (unsigned long frame = 0; running; frame++) {
+                XSetForeground(display, gc, (frame * 0x10307) & 0xFFFFFF);
+                XFillRectangle(display, window, gc, 0, 0, 800, 600);
+                XFlush(display);
+                std::this_thread::sleep_for(std::chrono::milliseconds(16));
+            }
+            cpuSeconds = threadCpuSeconds() - cpuStart;
+        });
+        return true;
+    }
+
+    // CPU spent painting, to take out of the process total
+    double stop() {
+        running = false;
+        thread.join();
+        XDestroyWindow(display, window);
+        XCloseDisplay(display);
+        display = nullptr;
+        return cpuSeconds;
+    }
+
+private:
+    Display* display = nullptr;
+    Window window = 0;
+    std::atomic<bool> running{false};
+    std::thread thread;
+    double cpuSeconds = 0.0;
+};
+
+// Percent of one core used by the recording, or a negative value if it produced no frames
+double measure(bool changeDriven, bool busy) {
+    std::string output = std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp") +
+                         "/capture_cpu_benchmark.mkv";
+    ScreenCapture capture;
+    capture.setChangeDrivenCapture(changeDriven);
+
+    BusyPainter painter;
+    if (busy && !painter.start()) {
+        return -1.0;
+    }
+    if (!capture.startRecording(output)) {
+        if (busy) {
+            painter.stop();
+        }
+        return -1.0;
+    }
+
+    // Let the recording settle before measuring
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    double cpuStart = processCpuSeconds();
+    auto wallStart = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    double cpu = processCpuSeconds() - cpuStart;
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+    EncoderStats stats = capture.getRecordingStats();
+    capture.stopRecording();
+    if (busy) {
+        cpu -= painter.stop();
+    }
+    std::remove(output.c_str());
+
+    std::printf("  %-13s %-5s %6.1f%% CPU  %6llu frames encoded, %6llu skipped\n",
+                changeDriven ? "change-driven" : "polling", busy ? "busy" : "idle", 100.0 * cpu / wall,
+                static_cast<unsigned long long>(stats.framesEncoded),
+                static_cast<unsigned long long>(stats.framesSkipped));
+    return stats.framesEncoded > 0 ? 100.0 * cpu / wall : -1.0;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--seconds") == 0) {
+        seconds = std::max(1, std::atoi(argv[2]));
+    }
+    if (!std::getenv("DISPLAY")) {
+        std::printf("CaptureCpuBenchmark: no X display (run it under xvfb-run), skipped\n");
+        return test::kSkipped;
+    }
+
+    std::printf("Recording CPU over %d s at the default frame rate:\n", seconds);
+    bool recorded = true;
+    for (bool changeDriven : {false, true}) {
+        for (bool busy : {false, true}) {
+            recorded = measure(changeDriven, busy) >= 0.0 && recorded;
+        }
+    }
+    if (!recorded) {
+        std::printf("CaptureCpuBenchmark: a recording produced no frames (no encoder?)\n");
+        return 1;
+    }
+    return 0;
+}
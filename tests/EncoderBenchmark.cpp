@@ -0,0 +1,118 @@
+// Throughput of the pixel conversion and image encoding paths on a synthetic 1080p desktop, and PNG wall
+// time against thread count on a 4K one.
+// Usage: EncoderBenchmark [--quick]
+// Run with REMOTE_WORKER_SIMD=scalar or ssse3 to compare against the default kernels.
+
+#include "ImageEncoder.h"
+#include "TestSupport.h"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int runs = 10;
+
+double gigabytesPerSecond(size_t bytes, double ms) {
+    return ms > 0.0 ? bytes / (ms * 1e6) : 0.0;
+}
+
+void benchmarkConvertPixels(const Frame& frame) {
+    size_t pixels = static_cast<size_t>(frame.width) * frame.height;
+    std::vector<uint8_t> packed(pixels * 3);
+    std::vector<uint8_t> swapped(pixels * 3);
+
+    double toBgr = test::bestOfMs(runs, [&]() {
+        ImageEncoder::convertPixels(frame.data, PixelFormat::BGRA, packed.data(), PixelFormat::BGR, pixels);
+    });
+    double toRgb = test::bestOfMs(runs, [&]() {
+        ImageEncoder::convertPixels(frame.data, PixelFormat::BGRA, packed.data(), PixelFormat::RGB, pixels);
+    });
+    double swap = test::bestOfMs(runs, [&]() {
+        ImageEncoder::convertPixels(packed.data(), PixelFormat::BGR, swapped.data(), PixelFormat::RGB, pixels);
+    });
+
+    // Throughput counts bytes read
+    std::printf("  BGRA->BGR   %7.3f ms  %6.2f GB/s\n", toBgr, gigabytesPerSecond(pixels * 4, toBgr));
+    std::printf("  BGRA->RGB   %7.3f ms  %6.2f GB/s\n", toRgb, gigabytesPerSecond(pixels * 4, toRgb));
+    std::printf("  BGR->RGB    %7.3f ms  %6.2f GB/s\n", swap, gigabytesPerSecond(pixels * 3, swap));
+}
+
+void benchmarkYuv(const Frame& frame) {
+    std::vector<uint8_t> yuv;
+    size_t bytes = static_cast<size_t>(frame.width) * frame.height * 4;
+    double i420 = test::bestOfMs(runs, [&]() { ImageEncoder::convertToYuv420(frame, YuvLayout::I420, yuv); });
+    double nv12 = test::bestOfMs(runs, [&]() { ImageEncoder::convertToYuv420(frame, YuvLayout::NV12, yuv); });
+    std::printf("  BGRA->I420  %7.3f ms  %6.2f GB/s\n", i420, gigabytesPerSecond(bytes, i420));
+    std::printf("  BGRA->NV12  %7.3f ms  %6.2f GB/s\n", nv12, gigabytesPerSecond(bytes, nv12));
+}
+
+void benchmarkEncoders(const Frame& frame) {
+    std::vector<uint8_t> output;
+    struct Case {
+        const char* name;
+        ImageFormat format;
+    };
+    const Case cases[] = {{"BMP", ImageFormat::BMP}, {"QOI", ImageFormat::QOI}, {"PNG", ImageFormat::PNG}};
+    for (const Case& c : cases) {
+        double ms = test::bestOfMs(runs, [&]() { ImageEncoder::encode(frame, c.format, output); });
+        std::printf("  %-10s  %7.3f ms  %8zu bytes\n", c.name, ms, output.size());
+    }
+    if (ImageEncoder::isJpegAvailable()) {
+        double ms = test::bestOfMs(runs, [&]() { ImageEncoder::encode(frame, ImageFormat::JPEG, output); });
+        std::printf("  %-10s  %7.3f ms  %8zu bytes\n", "JPEG q85", ms, output.size());
+    }
+}
+
+void benchmarkPngThreads(const Frame& frame) {
+    // Powers of two up to the core count, and at least up to 4 so small machines show the overhead
+    int cores = static_cast<int>(std::thread::hardware_concurrency());
+    std::vector<int> threadCounts;
+    for (int threads = 1; threads < cores || threads <= 4; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (cores > threadCounts.back()) {
+        threadCounts.push_back(cores);
+    }
+
+    std::vector<uint8_t> output;
+    for (int level : {1, 6}) {
+        double singleThreadMs = 0.0;
+        for (int threads : threadCounts) {
+            PngOptions options;
+            options.compressionLevel = level;
+            options.threads = threads;
+            double ms = test::bestOfMs(runs, [&]() { ImageEncoder::encodePng(frame, output, options); });
+            if (threads == 1) {
+                singleThreadMs = ms;
+            }
+            std::printf("  level %d, %2d thread(s)  %8.2f ms  %5.2fx  %8zu bytes\n", level, threads, ms,
+                        ms > 0.0 ? singleThreadMs / ms : 0.0, output.size());
+        }
+    }
+}
+
+}
+
+int main(int argc, char** argv) {
+    // --quick keeps the CTest smoke run short
+    if (argc > 1 && std::strcmp(argv[1], "--quick") == 0) {
+        runs = 1;
+    }
+
+    test::TestImage desktop = test::makeDesktopImage(1920, 1080);
+    std::printf("1920x1080 desktop, %s kernels, best of %d\n", ImageEncoder::simdLevel(), runs);
+
+    std::printf("Pixel conversion:\n");
+    benchmarkConvertPixels(desktop.frame);
+    benchmarkYuv(desktop.frame);
+
+    std::printf("Encode (default settings):\n");
+    benchmarkEncoders(desktop.frame);
+
+    test::TestImage uhd = test::makeDesktopImage(3840, 2160);
+    std::printf("PNG wall time vs threads (3840x2160, %u hardware threads):\n", std::thread::hardware_concurrency());
+    benchmarkPngThreads(uhd.frame);
+    return 0;
+}
@@ -0,0 +1,112 @@
+// Checks how FFmpegProcess lays captured frames onto ffmpeg's constant-rate input: gaps are
+// filled with repeats, frames sharing a slot are dropped, and a long gap is cut short.
+// A shell script named ffmpeg stands in for the real binary and saves what it is sent.
+// Usage: FFmpegProcessTest
+
+#include "FFmpegProcess.h"
+#include "TestSupport.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+const int kWidth = 64;
+const int kHeight = 48;
+const int kFrameRate = 15;
+const uint64_t kFrameBytes = kWidth * kHeight * 3 / 2;
+
+std::string directory;
+
+// Puts an ffmpeg that copies stdin to a file first on PATH
+bool installFakeFfmpeg() {
+    std::string base = std::string(std::getenv("TMPDIR") ? std::getenv("TMPDIR") : "/tmp") + "/ffmpeg_test_XXXXXX";
+    if (!mkdtemp(&base[0])) {
+        return false;
+    }
+    directory = base;
+    std::string script = directory + "/ffmpeg";
+    FILE* file = std::fopen(script.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "#!/bin/sh\nexec cat > '%s/input.yuv'\n", directory.c_str());
+    std::fclose(file);
+    chmod(script.c_str(), 0755);
+
+    const char* path = std::getenv("PATH");
+    std::string newPath = directory + ":" + (path ? path : "/usr/bin:/bin");
+    return setenv("PATH", newPath.c_str(), 1) == 0;
+}
+
+uint64_t receivedBytes() {
+    struct stat info;
+    if (stat((directory + "/input.yuv").c_str(), &info) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(info.st_size);
+}
+
+void testSlots() {
+    test::TestImage image = test::makeNoiseImage(kWidth, kHeight, 1);
+    FFmpegProcess ffmpeg;
+    CHECK(ffmpeg.start(kWidth, kHeight, kFrameRate, {"out.mkv"}));
+
+    // 200 ms at 15 fps is three slots on: two repeats, then the frame
+    CHECK(ffmpeg.writeFrame(image.frame, 1000));
+    CHECK(ffmpeg.writeFrame(image.frame, 1200));
+    CHECK(ffmpeg.getFramesWritten() == 4);
+
+    // Same slot as the last frame: dropped
+    CHECK(ffmpeg.writeFrame(image.frame, 1210));
+    CHECK(ffmpeg.getFramesWritten() == 4);
+
+    // An hour later, as after unlocking the screen: no more than the default 2 s of repeats
+    // before the frame, and the rest of the hour is cut from the timeline
+    CHECK(ffmpeg.writeFrame(image.frame, 1200 + 3600 * 1000));
+    CHECK(ffmpeg.getFramesWritten() == 4 + 2 * kFrameRate + 1);
+    CHECK(ffmpeg.getSlotsCollapsed() == (3600 * 1000 + 200) * kFrameRate / 1000 - (4 + 2 * kFrameRate));
+
+    // Frames after the cut keep their spacing
+    CHECK(ffmpeg.writeFrame(image.frame, 1200 + 3601 * 1000));
+    CHECK(ffmpeg.getFramesWritten() == 4 + 3 * kFrameRate + 1);
+
+    CHECK(ffmpeg.stop() == 0);
+    CHECK(receivedBytes() == ffmpeg.getFramesWritten() * kFrameBytes);
+}
+
+void testMaxGap() {
+    test::TestImage image = test::makeNoiseImage(kWidth, kHeight, 2);
+    FFmpegProcess ffmpeg;
+    ffmpeg.setMaxGap(std::chrono::milliseconds(500));
+    CHECK(ffmpeg.start(kWidth, kHeight, kFrameRate, {"out.mkv"}));
+
+    // The idle rate's five-second gap becomes half a second
+    CHECK(ffmpeg.writeFrame(image.frame, 0));
+    CHECK(ffmpeg.writeFrame(image.frame, 5000));
+    CHECK(ffmpeg.getFramesWritten() == 1 + kFrameRate / 2 + 1);
+
+    CHECK(ffmpeg.stop() == 0);
+    CHECK(receivedBytes() == ffmpeg.getFramesWritten() * kFrameBytes);
+}
+
+}
+
+int main() {
+    if (!installFakeFfmpeg()) {
+        std::printf("FFmpegProcessTest: could not set up a stand-in ffmpeg, skipped\n");
+        return test::kSkipped;
+    }
+
+    testSlots();
+    testMaxGap();
+
+    std::remove((directory + "/input.yuv").c_str());
+    std::remove((directory + "/ffmpeg").c_str());
+    rmdir(directory.c_str());
+    return test::finish("FFmpegProcessTest");
+}
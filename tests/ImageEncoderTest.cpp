@@ -0,0 +1,402 @@
+// Round-trips the image encoders and checks the pixel kernels against plain C++.
+// Usage: ImageEncoderTest [--expect-simd scalar|ssse3|avx2]
+// CTest runs it once per SIMD level with REMOTE_WORKER_SIMD set, so every kernel is covered.
+
+#include "ImageEncoder.h"
+#include "QoiCodec.h"
+#include "TestSupport.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef WITH_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+uint32_t read32BE(const uint8_t* data) {
+    return (static_cast<uint32_t>(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3];
+}
+
+uint32_t read32LE(const uint8_t* data) {
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+uint32_t crc32Of(const uint8_t* data, size_t size) {
+    static uint32_t table[256];
+    static bool built = false;
+    if (!built) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        built = true;
+    }
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// Tightly packed RGB of a frame, the reference every decoder is compared against
+std::vector<uint8_t> referenceRgb(const Frame& frame) {
+    std::vector<uint8_t> rgb(static_cast<size_t>(frame.width) * frame.height * 3);
+    for (int y = 0; y < frame.height; y++) {
+        const uint8_t* src = frame.data + static_cast<size_t>(y) * frame.stride;
+        uint8_t* dst = rgb.data() + static_cast<size_t>(y) * frame.width * 3;
+        for (int x = 0; x < frame.width; x++) {
+            dst[x * 3] = src[x * 4 + 2];
+            dst[x * 3 + 1] = src[x * 4 + 1];
+            dst[x * 3 + 2] = src[x * 4];
+        }
+    }
+    return rgb;
+}
+
+bool inflateZlib(const std::vector<uint8_t>& stream, size_t expectedSize, std::vector<uint8_t>& output) {
+    output.resize(expectedSize);
+#ifdef WITH_ZLIB
+    uLongf size = static_cast<uLongf>(expectedSize);
+    return uncompress(output.data(), &size, stream.data(), static_cast<uLong>(stream.size())) == Z_OK &&
+           size == expectedSize;
+#else
+    // Built without zlib the encoder only writes stored blocks
+    if (stream.size() < 6 || ((stream[0] << 8) | stream[1]) % 31 != 0) {
+        return false;
+    }
+    size_t in = 2;
+    size_t out = 0;
+    bool last = false;
+    while (!last) {
+        if (in + 5 > stream.size() || (stream[in] & 0x06) != 0) {
+            return false;
+        }
+        last = (stream[in] & 1) != 0;
+        size_t length = stream[in + 1] | (stream[in + 2] << 8);
+        size_t complement = stream[in + 3] | (stream[in + 4] << 8);
+        in += 5;
+        if ((length ^ 0xFFFF) != complement || in + length > stream.size() || out + length > expectedSize) {
+            return false;
+        }
+        std::memcpy(output.data() + out, stream.data() + in, length);
+        in += length;
+        out += length;
+    }
+
+    uint32_t a = 1;
+    uint32_t b = 0;
+    for (uint8_t byte : output) {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    return out == expectedSize && in + 4 == stream.size() && read32BE(stream.data() + in) == ((b << 16) | a);
+#endif
+}
+
+uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = p > a ? p - a : a - p;
+    int pb = p > b ? p - b : b - p;
+    int pc = p > c ? p - c : c - p;
+    return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+// Minimal decoder for the 8-bit RGB PNGs the encoder writes; verifies every CRC
+bool decodePng(const std::vector<uint8_t>& file, std::vector<uint8_t>& rgb, int& width, int& height) {
+    static const uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    if (file.size() < 8 || std::memcmp(file.data(), signature, 8) != 0) {
+        return false;
+    }
+
+    std::vector<uint8_t> compressed;
+    bool sawHeader = false;
+    bool sawEnd = false;
+    size_t offset = 8;
+    while (offset + 12 <= file.size() && !sawEnd) {
+        uint32_t length = read32BE(&file[offset]);
+        if (offset + 12 + length > file.size()) {
+            return false;
+        }
+        const uint8_t* type = &file[offset + 4];
+        const uint8_t* data = type + 4;
+        if (crc32Of(type, length + 4) != read32BE(data + length)) {
+            std::fprintf(stderr, "bad CRC in %.4s chunk\n", reinterpret_cast<const char*>(type));
+            return false;
+        }
+
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            width = static_cast<int>(read32BE(data));
+            height = static_cast<int>(read32BE(data + 4));
+            // 8-bit truecolour, no interlace
+            if (data[8] != 8 || data[9] != 2 || data[12] != 0) {
+                return false;
+            }
+            sawHeader = true;
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            compressed.insert(compressed.end(), data, data + length);
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            sawEnd = true;
+        }
+        offset += 12 + length;
+    }
+    if (!sawHeader || !sawEnd) {
+        return false;
+    }
+
+    size_t rowBytes = static_cast<size_t>(width) * 3;
+    std::vector<uint8_t> filtered;
+    if (!inflateZlib(compressed, (rowBytes + 1) * height, filtered)) {
+        return false;
+    }
+
+    rgb.assign(rowBytes * height, 0);
+    for (int y = 0; y < height; y++) {
+        uint8_t filter = filtered[y * (rowBytes + 1)];
+        const uint8_t* in = &filtered[y * (rowBytes + 1) + 1];
+        uint8_t* row = &rgb[y * rowBytes];
+        const uint8_t* previous = y > 0 ? row - rowBytes : nullptr;
+        for (size_t i = 0; i < rowBytes; i++) {
+            int left = i >= 3 ? row[i - 3] : 0;
+            int up = previous ? previous[i] : 0;
+            int upLeft = previous && i >= 3 ? previous[i - 3] : 0;
+            int predicted;
+            switch (filter) {
+                case 0: predicted = 0; break;
+                case 1: predicted = left; break;
+                case 2: predicted = up; break;
+                case 3: predicted = (left + up) / 2; break;
+                case 4: predicted = paeth(left, up, upLeft); break;
+                default: return false;
+            }
+            row[i] = static_cast<uint8_t>(in[i] + predicted);
+        }
+    }
+    return true;
+}
+
+// 24-bit bottom-up BMP as encodeBmp writes it
+bool decodeBmp(const std::vector<uint8_t>& file, std::vector<uint8_t>& rgb, int& width, int& height) {
+    if (file.size() < 54 || file[0] != 'B' || file[1] != 'M' || read32LE(&file[2]) != file.size()) {
+        return false;
+    }
+    uint32_t pixelOffset = read32LE(&file[10]);
+    width = static_cast<int>(read32LE(&file[18]));
+    height = static_cast<int>(read32LE(&file[22]));
+    if (file[28] != 24 || width <= 0 || height <= 0) {
+        return false;
+    }
+
+    size_t rowSize = (static_cast<size_t>(width) * 3 + 3) & ~static_cast<size_t>(3);
+    if (pixelOffset + rowSize * height > file.size()) {
+        return false;
+    }
+    rgb.resize(static_cast<size_t>(width) * height * 3);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* src = &file[pixelOffset + rowSize * (height - 1 - y)];
+        uint8_t* dst = &rgb[static_cast<size_t>(y) * width * 3];
+        for (int x = 0; x < width; x++) {
+            dst[x * 3] = src[x * 3 + 2];
+            dst[x * 3 + 1] = src[x * 3 + 1];
+            dst[x * 3 + 2] = src[x * 3];
+        }
+    }
+    return true;
+}
+
+void testConvertPixels() {
+    // Lengths around the 16- and 32-byte vector steps, where the SIMD loops hand over to scalar
+    const size_t counts[] = {0, 1, 3, 5, 15, 16, 17, 31, 32, 33, 63, 64, 65, 1000, 1001};
+    const size_t guard = 64;
+    test::TestImage image = test::makeNoiseImage(1001, 1, 7);
+    const uint8_t* bgra = image.pixels.data();
+
+    for (size_t count : counts) {
+        std::vector<uint8_t> bgr(count * 3 + guard, 0xCD);
+        std::vector<uint8_t> rgb(count * 3 + guard, 0xCD);
+        std::vector<uint8_t> swapped(count * 3 + guard, 0xCD);
+        CHECK(ImageEncoder::convertPixels(bgra, PixelFormat::BGRA, bgr.data(), PixelFormat::BGR, count));
+        CHECK(ImageEncoder::convertPixels(bgra, PixelFormat::BGRA, rgb.data(), PixelFormat::RGB, count));
+        CHECK(ImageEncoder::convertPixels(bgr.data(), PixelFormat::BGR, swapped.data(), PixelFormat::RGB, count));
+
+        int mismatches = 0;
+        for (size_t i = 0; i < count; i++) {
+            for (int c = 0; c < 3; c++) {
+                mismatches += bgr[i * 3 + c] != bgra[i * 4 + c];
+                mismatches += rgb[i * 3 + c] != bgra[i * 4 + 2 - c];
+                mismatches += swapped[i * 3 + c] != rgb[i * 3 + c];
+            }
+        }
+        CHECK(mismatches == 0);
+
+        // Vector stores must not run past the requested pixels
+        for (size_t i = count * 3; i < count * 3 + guard; i++) {
+            CHECK(bgr[i] == 0xCD && rgb[i] == 0xCD && swapped[i] == 0xCD);
+        }
+    }
+
+    std::vector<uint8_t> bgraOut(8);
+    CHECK(!ImageEncoder::convertPixels(bgra, PixelFormat::RGB, bgraOut.data(), PixelFormat::BGRA, 2));
+}
+
+void testDownscale() {
+    test::TestImage image = test::makeNoiseImage(203, 117, 11, 12);
+    std::vector<uint8_t> bgrPixels(static_cast<size_t>(image.frame.width) * image.frame.height * 3);
+    for (int y = 0; y < image.frame.height; y++) {
+        ImageEncoder::convertPixels(image.frame.data + static_cast<size_t>(y) * image.frame.stride, PixelFormat::BGRA,
+                                    &bgrPixels[static_cast<size_t>(y) * image.frame.width * 3], PixelFormat::BGR,
+                                    image.frame.width);
+    }
+    Frame bgrFrame = image.frame;
+    bgrFrame.data = bgrPixels.data();
+    bgrFrame.stride = image.frame.width * 3;
+    bgrFrame.format = PixelFormat::BGR;
+
+    for (const Frame& source : {image.frame, bgrFrame}) {
+        int bpp = source.format == PixelFormat::BGRA ? 4 : 3;
+        for (int factor : {1, 2, 3, 4, 8, 16}) {
+            std::vector<uint8_t> pixels;
+            Frame scaled;
+            CHECK(ImageEncoder::downscale(source, factor, pixels, scaled));
+            CHECK(scaled.width == source.width / factor && scaled.height == source.height / factor);
+            CHECK(scaled.format == source.format);
+
+            uint32_t area = static_cast<uint32_t>(factor) * factor;
+            uint32_t reciprocal = (65536 + area / 2) / area;
+            int mismatches = 0;
+            for (int y = 0; y < scaled.height; y++) {
+                for (int x = 0; x < scaled.width; x++) {
+                    for (int c = 0; c < bpp; c++) {
+                        uint32_t sum = 0;
+                        for (int dy = 0; dy < factor; dy++) {
+                            for (int dx = 0; dx < factor; dx++) {
+                                sum += source.data[static_cast<size_t>(y * factor + dy) * source.stride +
+                                                   (x * factor + dx) * bpp + c];
+                            }
+                        }
+                        uint8_t expected = static_cast<uint8_t>((sum * reciprocal + 32768) >> 16);
+                        mismatches += scaled.data[static_cast<size_t>(y) * scaled.stride + x * bpp + c] != expected;
+                    }
+                }
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+
+    std::vector<uint8_t> pixels;
+    Frame scaled;
+    CHECK(!ImageEncoder::downscale(image.frame, 0, pixels, scaled));
+    CHECK(!ImageEncoder::downscale(image.frame, ImageEncoder::kMaxDownscaleFactor + 1, pixels, scaled));
+}
+
+void testBmpRoundTrip() {
+    // Odd widths exercise the 4-byte row padding
+    for (int width : {1, 2, 3, 4, 5, 317}) {
+        test::TestImage image = test::makeNoiseImage(width, 41, width, 8);
+        std::vector<uint8_t> file;
+        CHECK(ImageEncoder::encodeBmp(image.frame, file));
+
+        std::vector<uint8_t> rgb;
+        int decodedWidth = 0;
+        int decodedHeight = 0;
+        CHECK(decodeBmp(file, rgb, decodedWidth, decodedHeight));
+        CHECK(decodedWidth == width && decodedHeight == 41);
+        CHECK(rgb == referenceRgb(image.frame));
+    }
+}
+
+void testPngRoundTrip() {
+    test::TestImage noise = test::makeNoiseImage(317, 203, 3, 20);
+    test::TestImage desktop = test::makeDesktopImage(640, 400);
+    test::TestImage tiny = test::makeNoiseImage(1, 1, 5);
+
+    for (const test::TestImage* image : {&noise, &desktop, &tiny}) {
+        std::vector<uint8_t> expected = referenceRgb(image->frame);
+        for (int level : {0, 1, 6, 9}) {
+            PngOptions options;
+            options.compressionLevel = level;
+            options.threads = 1;
+
+            std::vector<uint8_t> file;
+            CHECK(ImageEncoder::encodePng(image->frame, file, options));
+
+            std::vector<uint8_t> rgb;
+            int width = 0;
+            int height = 0;
+            CHECK(decodePng(file, rgb, width, height));
+            CHECK(width == image->frame.width && height == image->frame.height);
+            CHECK(rgb == expected);
+        }
+    }
+
+    // Bands deflated on separate threads must join into one valid stream with the right Adler-32
+    test::TestImage tall = test::makeNoiseImage(129, 1000, 13, 4);
+    for (const test::TestImage* image : {&tall, &desktop}) {
+        std::vector<uint8_t> expected = referenceRgb(image->frame);
+        for (int threads : {2, 3, 4, 7, 16}) {
+            for (int level : {1, 6, 9}) {
+                PngOptions options;
+                options.compressionLevel = level;
+                options.threads = threads;
+
+                std::vector<uint8_t> file;
+                CHECK(ImageEncoder::encodePng(image->frame, file, options));
+
+                std::vector<uint8_t> rgb;
+                int width = 0;
+                int height = 0;
+                CHECK(decodePng(file, rgb, width, height));
+                CHECK(rgb == expected);
+            }
+        }
+    }
+}
+
+void testQoiRoundTrip() {
+    test::TestImage noise = test::makeNoiseImage(317, 203, 9, 4);
+    test::TestImage desktop = test::makeDesktopImage(640, 400);
+
+    for (const test::TestImage* image : {&noise, &desktop}) {
+        std::vector<uint8_t> file;
+        CHECK(ImageEncoder::encode(image->frame, ImageFormat::QOI, file));
+
+        std::vector<uint8_t> rgb;
+        int width = 0;
+        int height = 0;
+        CHECK(QoiCodec::decode(file.data(), file.size(), rgb, width, height));
+        CHECK(width == image->frame.width && height == image->frame.height);
+        CHECK(rgb == referenceRgb(image->frame));
+    }
+
+    // Truncated input must be rejected rather than read past the end
+    std::vector<uint8_t> file;
+    CHECK(QoiCodec::encode(noise.frame, file));
+    std::vector<uint8_t> rgb;
+    int width = 0;
+    int height = 0;
+    CHECK(!QoiCodec::decode(file.data(), 10, rgb, width, height));
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--expect-simd") == 0 &&
+        std::strcmp(argv[2], ImageEncoder::simdLevel()) != 0) {
+        std::printf("ImageEncoderTest: %s kernels not available on this CPU (using %s), skipped\n", argv[2],
+                    ImageEncoder::simdLevel());
+        return test::kSkipped;
+    }
+    std::printf("ImageEncoderTest: %s kernels\n", ImageEncoder::simdLevel());
+
+    testConvertPixels();
+    testDownscale();
+    testBmpRoundTrip();
+    testPngRoundTrip();
+    testQoiRoundTrip();
+    return test::finish("ImageEncoderTest");
+}
@@ -0,0 +1,73 @@
+// Cost of LatencyHistogram::record from one thread and from several recording into the same
+// histogram, as the pipeline stages do, plus recordSince with its clock read.
+// Usage: LatencyHistogramBenchmark [--quick]
+
+#include "LatencyHistogram.h"
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+int runs = 10;
+int records = 1000000;
+
+// Spread over a few powers of two so the writes don't all hit one bucket
+uint64_t sampleNs(int i) {
+    return 1000 + static_cast<uint64_t>(i % 4096) * 977;
+}
+
+void report(const char* name, double ms, int count) {
+    std::printf("  %-28s %7.1f ns/record\n", name, ms * 1e6 / count);
+}
+
+}
+
+int main(int argc, char** argv) {
+    // --quick keeps the CTest smoke run short
+    if (argc > 1 && std::strcmp(argv[1], "--quick") == 0) {
+        runs = 2;
+        records = 100000;
+    }
+
+    std::printf("LatencyHistogram::record, %d records:\n", records);
+    LatencyHistogram histogram;
+    double single = test::bestOfMs(runs, [&]() {
+        for (int i = 0; i < records; i++) {
+            histogram.record(sampleNs(i));
+        }
+    });
+    report("one thread", single, records);
+
+    double since = test::bestOfMs(runs, [&]() {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < records; i++) {
+            histogram.recordSince(start);
+        }
+    });
+    report("recordSince, one thread", since, records);
+
+    // Wall time over every thread's records; on more than one core, contention on the shared
+    // buckets shows up as a higher cost than one thread's
+    unsigned threads = std::max(2u, std::min(4u, std::thread::hardware_concurrency()));
+    double shared = test::bestOfMs(runs, [&]() {
+        std::vector<std::thread> workers;
+        for (unsigned t = 0; t < threads; t++) {
+            workers.emplace_back([&histogram]() {
+                for (int i = 0; i < records; i++) {
+                    histogram.record(sampleNs(i));
+                }
+            });
+        }
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    });
+    char name[64];
+    std::snprintf(name, sizeof(name), "%u threads, one histogram", threads);
+    report(name, shared, records * static_cast<int>(threads));
+    return 0;
+}
@@ -0,0 +1,140 @@
+// Checks LatencyHistogram's bucket mapping and percentiles: known distributions against exact
+// percentiles of the same samples, the edge of the one-bucket-per-nanosecond range, values past
+// the top bucket, and an empty histogram.
+// Usage: LatencyHistogramTest
+
+#include "LatencyHistogram.h"
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// The header promises ~3%: 32 linear buckets per power of two
+const double kTolerance = 0.03;
+
+double nsToMs(double nanoseconds) {
+    return nanoseconds / 1e6;
+}
+
+// The sample summary() picks: the first whose rank reaches the rounded percentile
+double exactPercentileMs(std::vector<uint64_t> samples, double percentile) {
+    std::sort(samples.begin(), samples.end());
+    size_t rank = static_cast<size_t>(percentile * samples.size() + 0.5);
+    return nsToMs(static_cast<double>(samples[std::max<size_t>(rank, 1) - 1]));
+}
+
+bool withinTolerance(double actual, double expected) {
+    return std::abs(actual - expected) <= kTolerance * expected;
+}
+
+void checkDistribution(const char* name, const std::vector<uint64_t>& samples) {
+    LatencyHistogram histogram;
+    for (uint64_t sample : samples) {
+        histogram.record(sample);
+    }
+    LatencySummary summary = histogram.summary();
+
+    double p50 = exactPercentileMs(samples, 0.50);
+    double p90 = exactPercentileMs(samples, 0.90);
+    double p99 = exactPercentileMs(samples, 0.99);
+    std::printf("  %-12s p50 %.6f/%.6f  p90 %.6f/%.6f  p99 %.6f/%.6f ms (histogram/exact)\n", name,
+                summary.p50Ms, p50, summary.p90Ms, p90, summary.p99Ms, p99);
+
+    CHECK(summary.count == samples.size());
+    CHECK(withinTolerance(summary.p50Ms, p50));
+    CHECK(withinTolerance(summary.p90Ms, p90));
+    CHECK(withinTolerance(summary.p99Ms, p99));
+    CHECK(summary.maxMs == nsToMs(static_cast<double>(*std::max_element(samples.begin(), samples.end()))));
+}
+
+void testKnownDistributions() {
+    const int count = 100000;
+    uint32_t state = 12345;
+    auto random = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return (state >> 8) / static_cast<double>(1 << 24);
+    };
+
+    // Evenly spread over 1 us .. 1 ms
+    std::vector<uint64_t> uniform;
+    for (int i = 0; i < count; i++) {
+        uniform.push_back(static_cast<uint64_t>(1000 + random() * 999000));
+    }
+    checkDistribution("uniform", uniform);
+
+    // Log-uniform over 100 ns .. 10 s, so every power of two in between sees samples
+    std::vector<uint64_t> logUniform;
+    for (int i = 0; i < count; i++) {
+        logUniform.push_back(static_cast<uint64_t>(100.0 * std::pow(1e8, random())));
+    }
+    checkDistribution("log-uniform", logUniform);
+
+    // A long tail, like a grab that usually takes 2 ms
+    std::vector<uint64_t> exponential;
+    for (int i = 0; i < count; i++) {
+        exponential.push_back(static_cast<uint64_t>(-std::log(1.0 - random()) * 2e6));
+    }
+    checkDistribution("exponential", exponential);
+}
+
+// Below 32 ns each value has its own bucket; from 32 on, buckets are 2^shift wide
+void testSubBucketBoundary() {
+    const uint64_t exact[] = {0, 1, 30, 31, 32, 33, 63};
+    for (uint64_t value : exact) {
+        LatencyHistogram histogram;
+        histogram.record(value);
+        CHECK(histogram.summary().p50Ms == nsToMs(static_cast<double>(value)));
+    }
+
+    // 64 and 65 share the first two-wide bucket and report its midpoint
+    LatencyHistogram histogram;
+    histogram.record(64);
+    histogram.record(65);
+    CHECK(histogram.summary().p50Ms == nsToMs(64.5));
+}
+
+// Past 2^40 ns (~18 minutes) everything lands in the last bucket; max still reports the sample
+void testClampedAboveRange() {
+    const double topBucketLowestNs = static_cast<double>(63ull << 34);
+    const double rangeNs = static_cast<double>(1ull << 40);
+    for (uint64_t value : {1ull << 40, 1ull << 41, 1ull << 62}) {
+        LatencyHistogram histogram;
+        histogram.record(value);
+        LatencySummary summary = histogram.summary();
+        CHECK(summary.count == 1);
+        CHECK(summary.p50Ms >= nsToMs(topBucketLowestNs));
+        CHECK(summary.p99Ms < nsToMs(rangeNs));
+        CHECK(summary.maxMs == nsToMs(static_cast<double>(value)));
+    }
+}
+
+void testEmpty() {
+    LatencyHistogram histogram;
+    LatencySummary summary = histogram.summary();
+    CHECK(summary.count == 0);
+    CHECK(summary.meanMs == 0.0);
+    CHECK(summary.p50Ms == 0.0);
+    CHECK(summary.p99Ms == 0.0);
+    CHECK(summary.maxMs == 0.0);
+
+    // reset() gets back to the same state
+    histogram.record(1000);
+    histogram.reset();
+    summary = histogram.summary();
+    CHECK(summary.count == 0);
+    CHECK(summary.p50Ms == 0.0);
+    CHECK(summary.maxMs == 0.0);
+}
+
+}
+
+int main() {
+    testKnownDistributions();
+    testSubBucketBoundary();
+    testClampedAboveRange();
+    testEmpty();
+    return test::finish("LatencyHistogramTest");
+}
@@ -0,0 +1,100 @@
+// Hammers StatusChannel from several producers while one consumer drains it. Built with
+// -fsanitize=thread, so a data race fails the test as well as a lost or reordered event.
+// Usage: StatusChannelStressTest
+
+#include "StatusChannel.h"
+#include "TestSupport.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kProducers = 4;
+const int kEventsPerProducer = 20000;
+
+// Producer index and event number travel in the text, like a real status line would
+StatusEvent makeEvent(int producer, int number) {
+    StatusEvent event;
+    event.kind = StatusKind::Progress;
+    event.text = std::to_string(producer) + ":" + std::to_string(number);
+    event.progress = static_cast<float>(number) / kEventsPerProducer;
+    return event;
+}
+
+// A small ring, so it overflows constantly and producers evict while the consumer polls.
+// Once they are done, one more thread posts a final error, as a job reporting failure would.
+void testConcurrentPosts() {
+    StatusChannel channel(8);
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; p++) {
+        producers.emplace_back([&channel, p]() {
+            for (int i = 0; i < kEventsPerProducer; i++) {
+                channel.post(makeEvent(p, i));
+            }
+        });
+    }
+    std::thread finisher([&channel, &producers]() {
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        channel.post(StatusKind::Error, "finished");
+    });
+
+    std::vector<int> last(kProducers, -1);
+    bool ordered = true;
+    uint64_t received = 0;
+    StatusEvent event;
+    while (true) {
+        if (!channel.poll(event)) {
+            std::this_thread::yield();
+            continue;
+        }
+        received++;
+        if (event.kind == StatusKind::Error) {
+            break;
+        }
+        size_t colon = event.text.find(':');
+        int producer = std::stoi(event.text.substr(0, colon));
+        int number = std::stoi(event.text.substr(colon + 1));
+        // Events may be dropped, but each producer's arrive in order
+        if (number <= last[producer]) {
+            ordered = false;
+        }
+        last[producer] = number;
+    }
+    finisher.join();
+
+    std::printf("  %llu of %d events received, %llu dropped\n", static_cast<unsigned long long>(received),
+                kProducers * kEventsPerProducer + 1, static_cast<unsigned long long>(channel.getDroppedCount()));
+    CHECK(ordered);
+    // The final error is never the one dropped, and nothing is left behind it
+    CHECK(event.text == "finished");
+    CHECK(!channel.poll(event));
+    CHECK(received + channel.getDroppedCount() == static_cast<uint64_t>(kProducers) * kEventsPerProducer + 1);
+}
+
+// Single-threaded: a full ring keeps the newest events, oldest first
+void testOverflowKeepsNewest() {
+    StatusChannel channel(4);
+    for (int i = 0; i < 10; i++) {
+        channel.post(StatusKind::Info, std::to_string(i));
+    }
+    CHECK(channel.getDroppedCount() == 6);
+
+    StatusEvent event;
+    for (int expected = 6; expected < 10; expected++) {
+        CHECK(channel.poll(event));
+        CHECK(event.text == std::to_string(expected));
+    }
+    CHECK(!channel.poll(event));
+}
+
+}
+
+int main() {
+    testOverflowKeepsNewest();
+    testConcurrentPosts();
+    return test::finish("StatusChannelStressTest");
+}
@@ -0,0 +1,90 @@
+// UI-thread CPU spent on the dashboard's telemetry readings per frame: building a UserActivity
+// and a NetworkMonitor every frame, as render() used to, against reading TelemetrySampler's
+// latest snapshot. Thread CPU time is measured, so the sampler's own work doesn't count.
+// Run it inside an X session to include the per-frame XOpenDisplay of the old path.
+// Usage: TelemetryBenchmark [--quick]
+
+#include "TelemetrySampler.h"
+#include "UserActivity.h"
+#include "NetworkMonitor.h"
+#include "TestSupport.h"
+
+#include <time.h>
+
+#include <cstring>
+#include <thread>
+
+namespace {
+
+int frames = 2000;
+
+double threadCpuMs() {
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// Stands in for the ImGui::Text calls, so both paths format the same lines
+char line[256];
+
+void renderPerFrameMonitors() {
+    UserActivity userActivity;
+    bool isIdle = userActivity.isUserIdle(300);
+    std::snprintf(line, sizeof(line), "User Status: %s", isIdle ? "Idle" : "Active");
+
+    NetworkMonitor networkMonitor;
+    NetworkUsage usage = networkMonitor.getNetworkUsage();
+    std::snprintf(line, sizeof(line), "Network Usage - Sent: %llu bytes, Received: %llu bytes",
+                  static_cast<unsigned long long>(usage.bytesSent),
+                  static_cast<unsigned long long>(usage.bytesReceived));
+}
+
+void renderSnapshot(const TelemetrySampler& telemetry) {
+    std::shared_ptr<const TelemetrySnapshot> sample = telemetry.latest();
+    bool isIdle = sample->idleMs / 1000 > 300;
+    std::snprintf(line, sizeof(line), "User Status: %s", sample->screenLocked ? "Locked" : isIdle ? "Idle" : "Active");
+    std::snprintf(line, sizeof(line), "Network Usage - Sent: %llu bytes, Received: %llu bytes",
+                  static_cast<unsigned long long>(sample->network.bytesSent),
+                  static_cast<unsigned long long>(sample->network.bytesReceived));
+    std::snprintf(line, sizeof(line), "Agent: %.1f%% CPU, %.1f MB resident", sample->processCpuPercent,
+                  sample->residentBytes / (1024.0 * 1024.0));
+}
+
+template <typename Render>
+double cpuMsPerFrame(Render render) {
+    double start = threadCpuMs();
+    for (int i = 0; i < frames; i++) {
+        render();
+    }
+    return (threadCpuMs() - start) / frames;
+}
+
+void report(const char* name, double msPerFrame) {
+    // At 60 fps a frame is 16.7 ms
+    std::printf("  %-22s %9.3f us/frame  %6.2f%% of one core at 60 fps\n", name, msPerFrame * 1e3,
+                msPerFrame * 60.0 / 10.0);
+}
+
+}
+
+int main(int argc, char** argv) {
+    // --quick keeps the CTest smoke run short
+    if (argc > 1 && std::strcmp(argv[1], "--quick") == 0) {
+        frames = 100;
+    }
+
+    TelemetrySampler telemetry;
+    telemetry.start(std::chrono::seconds(1));
+    // Let the first sample land so the snapshot path reads real values
+    for (int i = 0; i < 100 && telemetry.latest()->sequence == 0; i++) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    std::printf("UI-thread CPU for the telemetry lines, %d frames:\n", frames);
+    double before = cpuMsPerFrame(renderPerFrameMonitors);
+    double after = cpuMsPerFrame([&]() { renderSnapshot(telemetry); });
+    report("per-frame monitors", before);
+    report("sampler snapshot", after);
+    telemetry.stop();
+    return 0;
+}
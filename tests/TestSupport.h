@@ -0,0 +1,103 @@
+#pragma once
+
+// Shared helpers for the test and benchmark executables. There is no test framework:
+// each test is a plain program that reports failed checks and exits non-zero, and
+// exits with kSkipped (CTest's SKIP_RETURN_CODE) when it can't run on this machine.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "Frame.h"
+
+namespace test {
+
+const int kSkipped = 77;
+
+inline int& failureCount() {
+    static int count = 0;
+    return count;
+}
+
+#define CHECK(condition)                                                                   \
+    do {                                                                                   \
+        if (!(condition)) {                                                                \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            test::failureCount()++;                                                        \
+        }                                                                                  \
+    } while (0)
+
+// Exit code for main()
+inline int finish(const char* name) {
+    if (failureCount() > 0) {
+        std::printf("%s: %d check(s) failed\n", name, failureCount());
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+// Owns the pixels behind a Frame
+struct TestImage {
+    std::vector<uint8_t> pixels;
+    Frame frame;
+};
+
+// Deterministic noise; rowPadding adds unused bytes per row like an SHM image's stride
+inline TestImage makeNoiseImage(int width, int height, uint32_t seed, int rowPadding = 0) {
+    TestImage image;
+    int stride = width * 4 + rowPadding;
+    image.pixels.resize(static_cast<size_t>(stride) * height);
+    uint32_t state = seed * 2654435761u + 1;
+    for (uint8_t& byte : image.pixels) {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<uint8_t>(state >> 24);
+    }
+    image.frame.data = image.pixels.data();
+    image.frame.width = width;
+    image.frame.height = height;
+    image.frame.stride = stride;
+    image.frame.format = PixelFormat::BGRA;
+    return image;
+}
+
+// Screen-like content: flat window backgrounds, a gradient and rows of "text"
+inline TestImage makeDesktopImage(int width, int height) {
+    TestImage image;
+    image.pixels.resize(static_cast<size_t>(width) * height * 4);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+            bool text = y % 20 < 12 && x % 9 < 6 && (x * 7 + y * 13) % 5 < 2;
+            int window = (x / 400 + y / 300) % 3;
+            pixel[0] = text ? 20 : window == 0 ? 240 : window == 1 ? 200 : 60;
+            pixel[1] = text ? 20 : window == 0 ? 240 : window == 1 ? 220 : static_cast<uint8_t>(60 + y / 20);
+            pixel[2] = text ? 20 : window == 0 ? 240 : window == 1 ? 250 : 90;
+            pixel[3] = 255;
+        }
+    }
+    image.frame.data = image.pixels.data();
+    image.frame.width = width;
+    image.frame.height = height;
+    image.frame.stride = width * 4;
+    image.frame.format = PixelFormat::BGRA;
+    return image;
+}
+
+// Fastest of `runs` calls, in milliseconds
+template <typename Function>
+double bestOfMs(int runs, Function function) {
+    double best = 0.0;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        function();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i == 0 || ms < best) {
+            best = ms;
+        }
+    }
+    return best;
+}
+
+}
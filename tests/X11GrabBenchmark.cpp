@@ -0,0 +1,80 @@
+// Full-screen grabs with MIT-SHM (XShmGetImage into a shared segment) against plain XGetImage,
+// which copies every frame through the X socket. Wall time and this process's CPU per grab;
+// the X server's side of the copy is not counted.
+// Needs an X server, so CTest doesn't run it: xvfb-run -s "-screen 0 1920x1080x24" tests/X11GrabBenchmark
+// Usage: X11GrabBenchmark [--frames N]
+
+#include "X11ScreenGrabber.h"
+#include "TestSupport.h"
+
+#include <time.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+int frames = 200;
+
+double processCpuMs() {
+    timespec now;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+    return now.tv_sec * 1e3 + now.tv_nsec / 1e6;
+}
+
+// False if the grabber could not be opened or a grab failed
+bool measure(bool sharedMemory) {
+    X11ScreenGrabber grabber;
+    grabber.setUseSharedMemory(sharedMemory);
+    if (!grabber.open()) {
+        return false;
+    }
+    if (sharedMemory && !grabber.isUsingSharedMemory()) {
+        std::printf("  MIT-SHM not available on this display, shared-memory run skipped\n");
+        return true;
+    }
+
+    Frame frame;
+    // The first grab allocates the buffer; keep it out of the numbers
+    if (!grabber.grab(frame)) {
+        return false;
+    }
+    double cpuStart = processCpuMs();
+    auto wallStart = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) {
+        if (!grabber.grab(frame)) {
+            return false;
+        }
+    }
+    double wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - wallStart).count();
+    double cpuMs = processCpuMs() - cpuStart;
+
+    double megabytes = static_cast<double>(frame.stride) * frame.height / (1024.0 * 1024.0);
+    std::printf("  %-9s %dx%d  %7.3f ms/grab  %7.3f ms CPU/grab  %8.1f MB/s\n", sharedMemory ? "MIT-SHM" : "XGetImage",
+                frame.width, frame.height, wallMs / frames, cpuMs / frames, megabytes * frames * 1e3 / wallMs);
+    return true;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--frames") == 0) {
+        frames = std::max(1, std::atoi(argv[2]));
+    }
+    if (!std::getenv("DISPLAY")) {
+        std::printf("X11GrabBenchmark: no X display (run it under xvfb-run), skipped\n");
+        return test::kSkipped;
+    }
+
+    std::printf("Root window grabs, %d frames each:\n", frames);
+    bool grabbed = measure(true);
+    grabbed = measure(false) && grabbed;
+    if (!grabbed) {
+        std::printf("X11GrabBenchmark: grabbing the root window failed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,268 @@
+// Checks the BGRA -> YUV 4:2:0 conversion: bit-exact against plain C++ doing the same fixed-point
+// math, within rounding of the BT.601 definition, and, with FFmpeg, against libswscale.
+// Usage: YuvConversionTest [--expect-simd scalar|ssse3|avx2]
+// CTest runs it once per SIMD level with REMOTE_WORKER_SIMD set, so every kernel is covered.
+
+#include "ImageEncoder.h"
+#include "TestSupport.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifdef WITH_FFMPEG
+extern "C" {
+#include <libavutil/pixfmt.h>
+#include <libswscale/swscale.h>
+}
+#endif
+
+namespace {
+
+// Tightly packed I420 planes; NV12 output is split into U and V for comparison
+struct Planes {
+    int chromaWidth = 0;
+    int chromaHeight = 0;
+    std::vector<uint8_t> y;
+    std::vector<uint8_t> u;
+    std::vector<uint8_t> v;
+};
+
+Planes allocatePlanes(int width, int height) {
+    Planes planes;
+    planes.chromaWidth = (width + 1) / 2;
+    planes.chromaHeight = (height + 1) / 2;
+    planes.y.resize(static_cast<size_t>(width) * height);
+    planes.u.resize(static_cast<size_t>(planes.chromaWidth) * planes.chromaHeight);
+    planes.v.resize(planes.u.size());
+    return planes;
+}
+
+const uint8_t* pixelAt(const Frame& frame, int x, int y) {
+    return frame.data + static_cast<size_t>(y) * frame.stride + x * 4;
+}
+
+// The kernels' math written out per pixel: 8.8 fixed-point luma, chroma from each 2x2 sum
+// with an odd last column or row paired with itself
+Planes referenceYuv(const Frame& frame) {
+    Planes planes = allocatePlanes(frame.width, frame.height);
+    for (int y = 0; y < frame.height; y++) {
+        for (int x = 0; x < frame.width; x++) {
+            const uint8_t* p = pixelAt(frame, x, y);
+            planes.y[static_cast<size_t>(y) * frame.width + x] =
+                static_cast<uint8_t>(((25 * p[0] + 129 * p[1] + 66 * p[2] + 128) >> 8) + 16);
+        }
+    }
+
+    const int bias = 512 + (128 << 10);
+    for (int cy = 0; cy < planes.chromaHeight; cy++) {
+        for (int cx = 0; cx < planes.chromaWidth; cx++) {
+            int x0 = cx * 2;
+            int y0 = cy * 2;
+            int x1 = std::min(x0 + 1, frame.width - 1);
+            int y1 = std::min(y0 + 1, frame.height - 1);
+            int sum[3] = {0, 0, 0};
+            for (const uint8_t* p : {pixelAt(frame, x0, y0), pixelAt(frame, x1, y0),
+                                     pixelAt(frame, x0, y1), pixelAt(frame, x1, y1)}) {
+                sum[0] += p[0];
+                sum[1] += p[1];
+                sum[2] += p[2];
+            }
+            size_t index = static_cast<size_t>(cy) * planes.chromaWidth + cx;
+            planes.u[index] = static_cast<uint8_t>((112 * sum[0] - 74 * sum[1] - 38 * sum[2] + bias) >> 10);
+            planes.v[index] = static_cast<uint8_t>((-18 * sum[0] - 94 * sum[1] + 112 * sum[2] + bias) >> 10);
+        }
+    }
+    return planes;
+}
+
+// Runs the packed overload and unpacks its output
+Planes convert(const Frame& frame, YuvLayout layout) {
+    Planes planes = allocatePlanes(frame.width, frame.height);
+    std::vector<uint8_t> output;
+    CHECK(ImageEncoder::convertToYuv420(frame, layout, output));
+    CHECK(output.size() == planes.y.size() + planes.u.size() * 2);
+    if (output.size() != planes.y.size() + planes.u.size() * 2) {
+        return planes;
+    }
+
+    const uint8_t* chroma = output.data() + planes.y.size();
+    std::memcpy(planes.y.data(), output.data(), planes.y.size());
+    if (layout == YuvLayout::I420) {
+        std::memcpy(planes.u.data(), chroma, planes.u.size());
+        std::memcpy(planes.v.data(), chroma + planes.u.size(), planes.v.size());
+    } else {
+        for (size_t i = 0; i < planes.u.size(); i++) {
+            planes.u[i] = chroma[i * 2];
+            planes.v[i] = chroma[i * 2 + 1];
+        }
+    }
+    return planes;
+}
+
+void testMatchesReference() {
+    // Widths around the 8- and 16-pixel SIMD steps, odd sizes, and padded strides
+    const int sizes[][2] = {{1, 1}, {2, 2}, {3, 3}, {7, 5}, {15, 7}, {16, 4}, {17, 9},
+                            {31, 17}, {33, 8}, {64, 4}, {127, 33}, {1920, 3}};
+    uint32_t seed = 1;
+    for (const auto& size : sizes) {
+        for (int rowPadding : {0, 12}) {
+            test::TestImage image = test::makeNoiseImage(size[0], size[1], seed++, rowPadding);
+            Planes expected = referenceYuv(image.frame);
+            for (YuvLayout layout : {YuvLayout::I420, YuvLayout::NV12}) {
+                Planes actual = convert(image.frame, layout);
+                bool same = actual.y == expected.y && actual.u == expected.u && actual.v == expected.v;
+                if (!same) {
+                    std::fprintf(stderr, "%dx%d padding %d %s differs from the reference\n", size[0], size[1],
+                                 rowPadding, layout == YuvLayout::I420 ? "I420" : "NV12");
+                }
+                CHECK(same);
+            }
+        }
+    }
+}
+
+// The plane overload must stay within each row's width and leave the stride padding alone
+void testStridedPlanes() {
+    const int width = 37;
+    const int height = 11;
+    const int chromaWidth = (width + 1) / 2;
+    const int chromaHeight = (height + 1) / 2;
+    const uint8_t guard = 0xEE;
+    test::TestImage image = test::makeNoiseImage(width, height, 99);
+    Planes expected = referenceYuv(image.frame);
+
+    const int yStride = width + 5;
+    const int uStride = chromaWidth + 3;
+    const int vStride = chromaWidth + 7;
+    std::vector<uint8_t> y(static_cast<size_t>(yStride) * height, guard);
+    std::vector<uint8_t> u(static_cast<size_t>(uStride) * chromaHeight, guard);
+    std::vector<uint8_t> v(static_cast<size_t>(vStride) * chromaHeight, guard);
+    CHECK(ImageEncoder::convertToYuv420(image.frame, YuvLayout::I420, y.data(), yStride, u.data(), uStride,
+                                        v.data(), vStride));
+
+    for (int row = 0; row < height; row++) {
+        CHECK(std::memcmp(&y[static_cast<size_t>(row) * yStride], &expected.y[static_cast<size_t>(row) * width],
+                          width) == 0);
+        for (int x = width; x < yStride; x++) {
+            CHECK(y[static_cast<size_t>(row) * yStride + x] == guard);
+        }
+    }
+    for (int row = 0; row < chromaHeight; row++) {
+        size_t expectedRow = static_cast<size_t>(row) * chromaWidth;
+        CHECK(std::memcmp(&u[static_cast<size_t>(row) * uStride], &expected.u[expectedRow], chromaWidth) == 0);
+        CHECK(std::memcmp(&v[static_cast<size_t>(row) * vStride], &expected.v[expectedRow], chromaWidth) == 0);
+        for (int x = chromaWidth; x < uStride; x++) {
+            CHECK(u[static_cast<size_t>(row) * uStride + x] == guard);
+        }
+        for (int x = chromaWidth; x < vStride; x++) {
+            CHECK(v[static_cast<size_t>(row) * vStride + x] == guard);
+        }
+    }
+}
+
+// Solid colours against limited-range BT.601 in floating point; fixed point may be one step off
+void testBt601() {
+    const uint8_t colours[][3] = {{0, 0, 0},     {255, 255, 255}, {255, 0, 0},   {0, 255, 0},
+                                  {0, 0, 255},   {255, 255, 0},   {0, 255, 255}, {255, 0, 255},
+                                  {128, 128, 128}, {16, 200, 90}, {240, 30, 170}};
+    for (const auto& rgb : colours) {
+        test::TestImage image = test::makeNoiseImage(4, 4, 0);
+        for (size_t i = 0; i < image.pixels.size(); i += 4) {
+            image.pixels[i] = rgb[2];
+            image.pixels[i + 1] = rgb[1];
+            image.pixels[i + 2] = rgb[0];
+        }
+        double r = rgb[0];
+        double g = rgb[1];
+        double b = rgb[2];
+        int expectedY = static_cast<int>(std::lround(16.0 + (65.481 * r + 128.553 * g + 24.966 * b) / 255.0));
+        int expectedU = static_cast<int>(std::lround(128.0 + (-37.797 * r - 74.203 * g + 112.0 * b) / 255.0));
+        int expectedV = static_cast<int>(std::lround(128.0 + (112.0 * r - 93.786 * g - 18.214 * b) / 255.0));
+
+        Planes actual = convert(image.frame, YuvLayout::I420);
+        CHECK(std::abs(actual.y[0] - expectedY) <= 1);
+        CHECK(std::abs(actual.u[0] - expectedU) <= 1);
+        CHECK(std::abs(actual.v[0] - expectedV) <= 1);
+    }
+}
+
+#ifdef WITH_FFMPEG
+int maxDifference(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    if (a.size() != b.size()) {
+        return 256;
+    }
+    int worst = 0;
+    for (size_t i = 0; i < a.size(); i++) {
+        worst = std::max(worst, std::abs(a[i] - b[i]));
+    }
+    return worst;
+}
+
+// A smooth image, so differences in how the two sides filter chroma stay within rounding
+test::TestImage makeGradientImage(int width, int height) {
+    test::TestImage image = test::makeNoiseImage(width, height, 0);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint8_t* pixel = &image.pixels[(static_cast<size_t>(y) * width + x) * 4];
+            pixel[0] = static_cast<uint8_t>(x * 255 / (width - 1));
+            pixel[1] = static_cast<uint8_t>(y * 255 / (height - 1));
+            pixel[2] = static_cast<uint8_t>(255 - (x + y) * 255 / (width + height - 2));
+            pixel[3] = 255;
+        }
+    }
+    return image;
+}
+
+// The recorder used to go through libswscale; what the encoder sees should not change
+void testAgainstSwscale() {
+    const int width = 320;
+    const int height = 240;
+    test::TestImage image = makeGradientImage(width, height);
+    Planes ours = convert(image.frame, YuvLayout::I420);
+
+    SwsContext* context = sws_getContext(width, height, AV_PIX_FMT_BGRA, width, height, AV_PIX_FMT_YUV420P,
+                                         SWS_BILINEAR | SWS_ACCURATE_RND, nullptr, nullptr, nullptr);
+    CHECK(context != nullptr);
+    if (!context) {
+        return;
+    }
+    Planes theirs = allocatePlanes(width, height);
+    const uint8_t* source[1] = {image.frame.data};
+    int sourceStride[1] = {image.frame.stride};
+    uint8_t* destination[3] = {theirs.y.data(), theirs.u.data(), theirs.v.data()};
+    int destinationStride[3] = {width, theirs.chromaWidth, theirs.chromaWidth};
+    sws_scale(context, source, sourceStride, 0, height, destination, destinationStride);
+    sws_freeContext(context);
+
+    int lumaDifference = maxDifference(ours.y, theirs.y);
+    int chromaDifference = std::max(maxDifference(ours.u, theirs.u), maxDifference(ours.v, theirs.v));
+    std::printf("  libswscale: max difference %d (luma), %d (chroma)\n", lumaDifference, chromaDifference);
+    CHECK(lumaDifference <= 1);
+    CHECK(chromaDifference <= 2);
+}
+#endif
+
+}
+
+int main(int argc, char** argv) {
+    if (argc == 3 && std::strcmp(argv[1], "--expect-simd") == 0 &&
+        std::strcmp(argv[2], ImageEncoder::simdLevel()) != 0) {
+        std::printf("YuvConversionTest: %s kernels not available on this CPU (using %s), skipped\n", argv[2],
+                    ImageEncoder::simdLevel());
+        return test::kSkipped;
+    }
+    std::printf("YuvConversionTest: %s kernels\n", ImageEncoder::simdLevel());
+
+    testMatchesReference();
+    testStridedPlanes();
+    testBt601();
+#ifdef WITH_FFMPEG
+    testAgainstSwscale();
+#else
+    std::printf("  built without FFmpeg, libswscale comparison skipped\n");
+#endif
+    return test::finish("YuvConversionTest");
+}
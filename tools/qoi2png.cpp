@@ -0,0 +1,102 @@
+// Converts QOI screenshots written by the monitoring client into PNG.
+// Usage: qoi2png [-l level] [-t threads] input.qoi [more.qoi ...]
+// Each input is written next to itself with a .png extension.
+
+#include "QoiCodec.h"
+#include "ImageEncoder.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static bool readFile(const std::string& path, std::vector<uint8_t>& data) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static std::string pngPathFor(const std::string& input) {
+    size_t dot = input.find_last_of('.');
+    size_t slash = input.find_last_of("/\\");
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return input + ".png";
+    }
+    return input.substr(0, dot) + ".png";
+}
+
+int main(int argc, char** argv) {
+    PngOptions options;
+    std::vector<std::string> inputs;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-l") == 0 && i + 1 < argc) {
+            options.compressionLevel = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+
+    if (inputs.empty()) {
+        std::cerr << "Usage: qoi2png [-l level] [-t threads] input.qoi [more.qoi ...]" << std::endl;
+        return 1;
+    }
+
+    int failures = 0;
+    for (const auto& input : inputs) {
+        std::vector<uint8_t> qoiData;
+        if (!readFile(input, qoiData)) {
+            std::cerr << "Cannot read " << input << std::endl;
+            failures++;
+            continue;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        std::vector<uint8_t> rgb;
+        int width = 0, height = 0;
+        if (!QoiCodec::decode(qoiData.data(), qoiData.size(), rgb, width, height)) {
+            std::cerr << "Cannot decode " << input << std::endl;
+            failures++;
+            continue;
+        }
+
+        auto decoded = std::chrono::steady_clock::now();
+
+        Frame frame;
+        frame.data = rgb.data();
+        frame.width = width;
+        frame.height = height;
+        frame.stride = width * 3;
+        frame.format = PixelFormat::RGB;
+
+        std::vector<uint8_t> png;
+        std::string output = pngPathFor(input);
+        if (!ImageEncoder::encodePng(frame, png, options) || !ImageEncoder::writeFile(output, png)) {
+            std::cerr << "Cannot write " << output << std::endl;
+            failures++;
+            continue;
+        }
+
+        auto encoded = std::chrono::steady_clock::now();
+        double rawSize = static_cast<double>(width) * height * 3;
+
+        std::cout << input << " -> " << output << " (" << width << "x" << height << "): "
+                  << "QOI " << qoiData.size() << " bytes (" << rawSize / qoiData.size() << ":1), "
+                  << "PNG " << png.size() << " bytes (" << rawSize / png.size() << ":1), "
+                  << "decode " << std::chrono::duration<double, std::milli>(decoded - start).count() << " ms, "
+                  << "PNG encode " << std::chrono::duration<double, std::milli>(encoded - decoded).count() << " ms"
+                  << std::endl;
+    }
+
+    return failures == 0 ? 0 : 1;
+}